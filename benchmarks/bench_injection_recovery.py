@@ -0,0 +1,349 @@
+"""Injection-recovery benchmark measuring both throughput and sensitivity.
+
+Injects synthetic objects with ``FakeDataSet.insert_object`` over a grid of fluxes
+and velocities, runs the full search under a set of configurations and reports the
+recovery fraction versus injected flux alongside the wall time and peak memory of
+each configuration. A performance change should only be accepted if the recall
+holds, so the benchmark can compare every configuration to a baseline and fail
+when recall drops.
+
+Examples
+--------
+Compare the encodings of the psi/phi arrays against the float baseline::
+
+    python bench_injection_recovery.py --configs baseline encode_uint16 encode_uint8 \
+        --fluxes 50 100 200 400 --output recovery
+
+Use custom configurations (a JSON dictionary mapping names to parameter overrides)
+and fail if recall drops by more than 5% at any flux::
+
+    python bench_injection_recovery.py --config-file configs.json --max-recall-drop 0.05
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+from bench_search_scaling import StageRecorder, _peak_rss_mb, instrument_run_search
+
+# Named sets of configuration overrides.
+PRESETS = {
+    "baseline": {},
+    "encode_uint16": {"encode_num_bytes": 2},
+    "encode_uint8": {"encode_num_bytes": 1},
+    "gpu_filter": {"gpu_filter": True},
+    "reorder_candidates": {"reorder_candidates": True},
+}
+
+
+def make_injections(width, height, times, fluxes, velocities, per_cell, seed):
+    """Create the trajectories to inject. Every object stays inside the image
+    for the full time range.
+
+    Parameters
+    ----------
+    width : `int`
+        The width of the images in pixels.
+    height : `int`
+        The height of the images in pixels.
+    times : `list`
+        The observation times.
+    fluxes : `list`
+        The fluxes to inject.
+    velocities : `list`
+        A list of (vx, vy) pairs in pixels per day.
+    per_cell : `int`
+        The number of objects to inject for each (flux, velocity) pair.
+    seed : `int`
+        The seed for the starting positions.
+
+    Returns
+    -------
+    injections : `list` of `dict`
+        The trajectory parameters of each injected object.
+    """
+    rng = np.random.default_rng(seed)
+    dt = times[-1] - times[0]
+
+    injections = []
+    for flux in fluxes:
+        for vx, vy in velocities:
+            # Restrict the starting pixel so the end point is also on the image.
+            x_lo, x_hi = max(0.0, -vx * dt), min(width - 1.0, width - 1.0 - vx * dt)
+            y_lo, y_hi = max(0.0, -vy * dt), min(height - 1.0, height - 1.0 - vy * dt)
+            if x_lo >= x_hi or y_lo >= y_hi:
+                raise ValueError(f"Velocity ({vx}, {vy}) leaves the image within the time range.")
+            for _ in range(per_cell):
+                injections.append(
+                    {
+                        "x": int(rng.uniform(x_lo, x_hi)),
+                        "y": int(rng.uniform(y_lo, y_hi)),
+                        "vx": float(vx),
+                        "vy": float(vy),
+                        "flux": float(flux),
+                    }
+                )
+    return injections
+
+
+def match_injections(injections, found, dt, radius):
+    """Determine which injected objects were recovered. An object is recovered if
+    a result is within ``radius`` pixels of it at both the first and last time.
+
+    Parameters
+    ----------
+    injections : `list` of `dict`
+        The injected trajectories.
+    found : `numpy.ndarray`
+        An N x 4 array of the (x, y, vx, vy) of the results.
+    dt : `float`
+        The time between the first and last observations.
+    radius : `float`
+        The matching radius in pixels.
+
+    Returns
+    -------
+    recovered : `numpy.ndarray`
+        A Boolean array indicating whether each injected object was recovered.
+    """
+    recovered = np.full(len(injections), False)
+    if len(found) == 0:
+        return recovered
+
+    found_start = found[:, 0:2]
+    found_end = found[:, 0:2] + dt * found[:, 2:4]
+    for i, inj in enumerate(injections):
+        start = np.array([inj["x"], inj["y"]])
+        end = start + dt * np.array([inj["vx"], inj["vy"]])
+        d_start = np.linalg.norm(found_start - start, axis=1)
+        d_end = np.linalg.norm(found_end - end, axis=1)
+        recovered[i] = np.any((d_start <= radius) & (d_end <= radius))
+    return recovered
+
+
+def run_config(case):
+    """Inject the objects and run the search with one configuration in the current process.
+
+    Parameters
+    ----------
+    case : `dict`
+        The data set parameters, the injections and the configuration overrides.
+
+    Returns
+    -------
+    result : `dict`
+        The recovery and performance results.
+    """
+    from kbmod.configuration import SearchConfiguration
+    from kbmod.fake_data.fake_data_creator import FakeDataSet, create_fake_times
+    from kbmod.search import Trajectory
+    from kbmod.trajectory_generator import VelocityGridSearch
+
+    times = create_fake_times(case["num_times"], t0=57130.2)
+    ds = FakeDataSet(case["width"], case["height"], times, noise_level=case["noise_level"], use_seed=True)
+    for inj in case["injections"]:
+        trj = Trajectory()
+        trj.x = inj["x"]
+        trj.y = inj["y"]
+        trj.vx = inj["vx"]
+        trj.vy = inj["vy"]
+        trj.flux = inj["flux"]
+        ds.insert_object(trj)
+
+    config = SearchConfiguration()
+    config.set("num_obs", max(3, case["num_times"] // 2))
+    config.set("average_angle", 0.0)
+    config.set("ind_output_files", False)
+    config.set("num_cores", case["threads"])
+    for key, value in case["overrides"].items():
+        config.set(key, value)
+
+    max_vel = case["max_velocity"]
+    steps = case["velocity_steps"]
+    generator = VelocityGridSearch(steps, -max_vel, max_vel, steps, -max_vel, max_vel)
+
+    recorder = StageRecorder()
+    start = time.perf_counter()
+    with instrument_run_search(recorder) as runner_class:
+        results = runner_class().run_search(config, ds.stack, trj_generator=generator)
+    total_seconds = time.perf_counter() - start
+
+    found = np.array(
+        [[r.trajectory.x, r.trajectory.y, r.trajectory.vx, r.trajectory.vy] for r in results.results]
+    ).reshape(-1, 4)
+    recovered = match_injections(case["injections"], found, times[-1] - times[0], case["match_radius"])
+
+    return {
+        "name": case["name"],
+        "overrides": case["overrides"],
+        "total_seconds": total_seconds,
+        "peak_rss_mb": max([s["peak_rss_mb"] for s in recorder.stages.values()] + [_peak_rss_mb()]),
+        "stages": recorder.stages,
+        "num_results": int(results.num_results()),
+        "recovered": recovered.tolist(),
+    }
+
+
+def run_config_subprocess(case):
+    """Run a configuration in a fresh interpreter with OMP_NUM_THREADS set."""
+    env = dict(os.environ)
+    env["OMP_NUM_THREADS"] = str(case["threads"])
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        case_file = os.path.join(tmp_dir, "case.json")
+        out_file = os.path.join(tmp_dir, "result.json")
+        with open(case_file, "w") as f:
+            json.dump(case, f)
+
+        cmd = [sys.executable, os.path.abspath(__file__), "--worker", case_file, out_file]
+        proc = subprocess.run(cmd, env=env, capture_output=True, text=True)
+        if proc.returncode != 0 or not os.path.exists(out_file):
+            msg = proc.stderr.strip().splitlines()[-1] if proc.stderr.strip() else "failed"
+            return {"name": case["name"], "overrides": case["overrides"], "error": msg}
+        with open(out_file) as f:
+            return json.load(f)
+
+
+def recall_by_flux(injections, recovered):
+    """Compute the recovery fraction for each injected flux."""
+    fluxes = np.array([inj["flux"] for inj in injections])
+    recovered = np.array(recovered)
+    return {float(f): float(np.mean(recovered[fluxes == f])) for f in np.unique(fluxes)}
+
+
+def compare_to_baseline(results, max_recall_drop):
+    """Annotate each result with its speedup and recall change relative to the
+    first configuration. Returns the names of the regressed configurations:
+    those that failed to run and those whose recall at any flux dropped by more
+    than ``max_recall_drop``. Nothing is compared if the first one failed, which
+    is a regression itself when ``max_recall_drop`` is set."""
+    base = results[0]
+    if "error" in base:
+        return [base["name"]] if max_recall_drop is not None else []
+
+    failed = []
+    for res in results:
+        if "error" in res:
+            failed.append(res["name"])
+            continue
+        res["speedup"] = base["total_seconds"] / res["total_seconds"]
+        res["recall_delta"] = {f: res["recall"][f] - base["recall"][f] for f in base["recall"]}
+        if max_recall_drop is not None and min(res["recall_delta"].values()) < -max_recall_drop:
+            failed.append(res["name"])
+    return failed
+
+
+def print_table(results):
+    fluxes = next((list(r["recall"].keys()) for r in results if "recall" in r), [])
+    header = " Config               |  Time (s) | Speedup | RSS (MB) | " + " | ".join(
+        f"f={f:<6g}" for f in fluxes
+    )
+    print(header)
+    print("-" * len(header))
+    for res in results:
+        if "error" in res:
+            print(f" {res['name']:20s} | error: {res['error']}")
+            continue
+        recalls = " | ".join(f"{res['recall'][f]:8.3f}" for f in fluxes)
+        print(
+            f" {res['name']:20s} | {res['total_seconds']:9.3f} | {res.get('speedup', 1.0):7.2f} | "
+            f"{res['peak_rss_mb']:8.1f} | {recalls}"
+        )
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Injection-recovery throughput and recall benchmark.")
+    parser.add_argument("--width", type=int, default=256)
+    parser.add_argument("--height", type=int, default=256)
+    parser.add_argument("--num-times", type=int, default=20)
+    parser.add_argument("--noise-level", type=float, default=2.0)
+    parser.add_argument("--fluxes", nargs="+", type=float, default=[25.0, 50.0, 100.0, 200.0])
+    parser.add_argument(
+        "--velocities",
+        nargs="+",
+        default=["5,0", "0,5", "-4,3", "3,-4"],
+        help="Injected velocities as vx,vy pairs (pixels/day).",
+    )
+    parser.add_argument("--per-cell", type=int, default=5, help="Objects per (flux, velocity) pair.")
+    parser.add_argument("--velocity-steps", type=int, default=21, help="Search steps per velocity axis.")
+    parser.add_argument("--max-velocity", type=float, default=10.0, help="Search speed limit (pixels/day).")
+    parser.add_argument("--match-radius", type=float, default=2.0, help="Matching radius (pixels).")
+    parser.add_argument("--threads", type=int, default=1)
+    parser.add_argument("--seed", type=int, default=101)
+    parser.add_argument(
+        "--configs", nargs="+", default=["baseline"], help=f"Preset configurations: {', '.join(PRESETS)}."
+    )
+    parser.add_argument("--config-file", default=None, help="JSON file mapping names to config overrides.")
+    parser.add_argument(
+        "--max-recall-drop",
+        type=float,
+        default=None,
+        help="Exit with an error if recall at any flux drops by more than this vs. the first config.",
+    )
+    parser.add_argument("--output", default=None, help="Write the results to this JSON file.")
+    parser.add_argument("--worker", nargs=2, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker is not None:
+        with open(args.worker[0]) as f:
+            result = run_config(json.load(f))
+        with open(args.worker[1], "w") as f:
+            json.dump(result, f)
+        return
+
+    configs = {}
+    for name in args.configs:
+        if name not in PRESETS:
+            parser.error(f"Unknown configuration {name}")
+        configs[name] = PRESETS[name]
+    if args.config_file is not None:
+        with open(args.config_file) as f:
+            configs.update(json.load(f))
+
+    from kbmod.fake_data.fake_data_creator import create_fake_times
+
+    times = create_fake_times(args.num_times, t0=57130.2)
+    velocities = [tuple(float(v) for v in pair.split(",")) for pair in args.velocities]
+    injections = make_injections(
+        args.width, args.height, times, args.fluxes, velocities, args.per_cell, args.seed
+    )
+
+    base_case = {
+        "width": args.width,
+        "height": args.height,
+        "num_times": args.num_times,
+        "noise_level": args.noise_level,
+        "velocity_steps": args.velocity_steps,
+        "max_velocity": args.max_velocity,
+        "match_radius": args.match_radius,
+        "threads": args.threads,
+        "injections": injections,
+    }
+
+    results = []
+    for name, overrides in configs.items():
+        res = run_config_subprocess(dict(base_case, name=name, overrides=overrides))
+        if "error" not in res:
+            res["recall"] = recall_by_flux(injections, res["recovered"])
+        results.append(res)
+
+    failed = compare_to_baseline(results, args.max_recall_drop)
+    print_table(results)
+
+    if args.output is not None:
+        summary = {k: v for k, v in base_case.items() if k != "injections"}
+        with open(args.output, "w") as f:
+            json.dump({"setup": summary, "injections": injections, "results": results}, f, indent=2)
+
+    if failed:
+        print(f"Failed or recall dropped by more than {args.max_recall_drop} for: {', '.join(failed)}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,436 @@
+/*
+ * bench_search_core.cpp
+ *
+ * Standalone benchmarks for the C++ search core. Builds directly against the
+ * core sources (without pybind11) and times the main CPU and GPU paths on a
+ * synthetic image stack. Results are written as JSON so they can be tracked
+ * across releases.
+ *
+ * Build with: cmake -DBUILD_BENCHMARKS=ON ... && make bench_search_core
+ * Run with:   ./bench_search_core --width 512 --height 512 --times 20 \
+ *                 --velocities 1024 --threads 8 --output results.json
+ *
+ * Created on: October 17, 2026
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The core sources are compiled as a single unit, the same as in bindings.cpp.
+#include "logging.h"
+#include "common.h"
+#include "geom.h"
+
+#include "psf.cpp"
+#include "psf_grid.cpp"
+#include "raw_image.cpp"
+#include "layered_image.cpp"
+#include "image_stack.cpp"
+#include "stack_search.cpp"
+#include "stamp_creator.cpp"
+#include "kernel_testing_helpers.cpp"
+#include "psi_phi_array.cpp"
+#include "debug_timer.cpp"
+#include "instrumentation.cpp"
+#include "perf_counters.cpp"
+#include "memory_tracker.cpp"
+#include "huge_pages.cpp"
+#include "arena.cpp"
+#include "thread_pool.cpp"
+#include "trajectory_list.cpp"
+#include "trajectory_evaluator.cpp"
+#include "trajectory_generator.cpp"
+#include "multi_stack_search.cpp"
+#include "tan_wcs.cpp"
+
+namespace bench {
+
+struct BenchConfig {
+    int width = 256;
+    int height = 256;
+    int num_times = 20;
+    int num_velocities = 256;
+    int num_threads = 0;  // 0 = the thread pool's default
+    int repeats = 3;
+    int stamp_radius = 10;
+    std::string filter = "";
+    std::string output = "";
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<double> seconds;
+    double items = 0.0;  // The number of work items per run (for throughput).
+    std::string item_name = "";
+};
+
+// Run setup() (untimed) and func() (timed) repeats times.
+BenchResult time_benchmark(const std::string& name, int repeats, const std::function<void()>& setup,
+                           const std::function<void()>& func) {
+    BenchResult result;
+    result.name = name;
+    for (int r = 0; r < repeats; ++r) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    return result;
+}
+
+search::ImageStack make_synthetic_stack(const BenchConfig& cfg, const search::PSF& psf) {
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0, 1.0);
+
+    std::vector<search::LayeredImage> imgs;
+    for (int t = 0; t < cfg.num_times; ++t) {
+        search::RawImage sci(cfg.width, cfg.height, 0.0, 0.1 * t);
+        for (int y = 0; y < cfg.height; ++y) {
+            for (int x = 0; x < cfg.width; ++x) {
+                sci.set_pixel({y, x}, noise(rng));
+            }
+        }
+        search::RawImage var(cfg.width, cfg.height, 1.0, 0.1 * t);
+        search::RawImage msk(cfg.width, cfg.height, 0.0, 0.1 * t);
+        imgs.push_back(search::LayeredImage(sci, var, msk, psf));
+    }
+    return search::ImageStack(imgs);
+}
+
+std::vector<search::Trajectory> make_trajectories(const BenchConfig& cfg) {
+    std::vector<search::Trajectory> trjs(cfg.num_velocities);
+    std::mt19937 rng(101);
+    std::uniform_real_distribution<float> vel(-20.0, 20.0);
+    std::uniform_int_distribution<int> x_pos(0, cfg.width - 1);
+    std::uniform_int_distribution<int> y_pos(0, cfg.height - 1);
+    for (auto& trj : trjs) {
+        trj.x = x_pos(rng);
+        trj.y = y_pos(rng);
+        trj.vx = vel(rng);
+        trj.vy = vel(rng);
+    }
+    return trjs;
+}
+
+// Exactly num_velocities search candidates on a grid of velocities over
+// [-20, 20] x [-5, 5] pixels per day, filled one row of x velocities at a time.
+std::vector<search::Trajectory> make_candidates(const BenchConfig& cfg) {
+    const int vx_steps = std::ceil(std::sqrt((double)cfg.num_velocities));
+    const int vy_steps = (cfg.num_velocities + vx_steps - 1) / vx_steps;
+    std::vector<search::Trajectory> trjs(cfg.num_velocities);
+    for (int i = 0; i < cfg.num_velocities; ++i) {
+        const int vx_i = i % vx_steps;
+        const int vy_i = i / vx_steps;
+        trjs[i].vx = (vx_steps > 1) ? -20.0 + (40.0 * vx_i) / (vx_steps - 1) : 0.0;
+        trjs[i].vy = (vy_steps > 1) ? -5.0 + (10.0 * vy_i) / (vy_steps - 1) : 0.0;
+    }
+    return trjs;
+}
+
+std::string to_json(const BenchConfig& cfg, const std::vector<BenchResult>& results) {
+    std::ostringstream out;
+    out.precision(9);
+    out << "{\n  \"config\": {\"width\": " << cfg.width << ", \"height\": " << cfg.height
+        << ", \"num_times\": " << cfg.num_times << ", \"num_velocities\": " << cfg.num_velocities
+        << ", \"num_threads\": " << search::ThreadPool::instance().get_num_threads()
+        << ", \"repeats\": " << cfg.repeats << ", \"stamp_radius\": " << cfg.stamp_radius << "},\n";
+    out << "  \"has_gpu\": " << (search::HAVE_GPU ? "true" : "false") << ",\n";
+    out << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& res = results[i];
+        std::vector<double> sorted = res.seconds;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+        double median = sorted[sorted.size() / 2];
+
+        out << (i > 0 ? ",\n" : "\n") << "    {\"name\": \"" << res.name << "\", \"min_s\": " << sorted[0]
+            << ", \"median_s\": " << median << ", \"mean_s\": " << mean << ", \"max_s\": " << sorted.back();
+        if (res.items > 0.0) {
+            out << ", \"items\": " << res.items << ", \"item_name\": \"" << res.item_name
+                << "\", \"items_per_s\": " << res.items / sorted[0];
+        }
+        out << ", \"seconds\": [";
+        for (size_t j = 0; j < res.seconds.size(); ++j) out << (j > 0 ? ", " : "") << res.seconds[j];
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+void print_usage() {
+    std::cout << "Usage: bench_search_core [--width W] [--height H] [--times T] [--velocities V]\n"
+              << "                         [--threads N] [--repeats R] [--stamp-radius S]\n"
+              << "                         [--filter SUBSTRING] [--output FILE.json]\n";
+}
+
+bool parse_args(int argc, char** argv, BenchConfig& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        std::string val = argv[++i];
+        if (arg == "--width") {
+            cfg.width = std::stoi(val);
+        } else if (arg == "--height") {
+            cfg.height = std::stoi(val);
+        } else if (arg == "--times") {
+            cfg.num_times = std::stoi(val);
+        } else if (arg == "--velocities") {
+            cfg.num_velocities = std::stoi(val);
+        } else if (arg == "--threads") {
+            cfg.num_threads = std::stoi(val);
+        } else if (arg == "--repeats") {
+            cfg.repeats = std::stoi(val);
+        } else if (arg == "--stamp-radius") {
+            cfg.stamp_radius = std::stoi(val);
+        } else if (arg == "--filter") {
+            cfg.filter = val;
+        } else if (arg == "--output") {
+            cfg.output = val;
+        } else {
+            std::cerr << "Unknown argument " << arg << "\n";
+            return false;
+        }
+    }
+    if (cfg.width <= 0 || cfg.height <= 0 || cfg.num_times <= 0 || cfg.num_velocities <= 0 ||
+        cfg.repeats <= 0) {
+        std::cerr << "All sizes and counts must be positive.\n";
+        return false;
+    }
+    return true;
+}
+
+std::vector<BenchResult> run_benchmarks(const BenchConfig& cfg) {
+    std::vector<BenchResult> results;
+    auto enabled = [&cfg](const std::string& name) {
+        return cfg.filter.empty() || name.find(cfg.filter) != std::string::npos;
+    };
+    auto noop = []() {};
+    const double num_pixels = (double)cfg.width * cfg.height;
+
+    search::PSF psf(1.0);
+    search::ImageStack stack = make_synthetic_stack(cfg, psf);
+    std::vector<search::Trajectory> trjs = make_trajectories(cfg);
+
+    // --- PsiPhiArray creation for each encoding --------------------------
+    const std::vector<std::pair<std::string, int>> encodings = {{"float", -1}, {"uint16", 2}, {"uint8", 1}};
+    for (const auto& enc : encodings) {
+        std::string name = "fill_psi_phi_" + enc.first;
+        if (!enabled(name)) continue;
+
+        search::PsiPhiArray psi_phi;
+        BenchResult res = time_benchmark(
+                name, cfg.repeats, [&psi_phi]() { psi_phi.clear(); },
+                [&]() { search::fill_psi_phi_array_from_image_stack(psi_phi, stack, enc.second, false); });
+        res.items = num_pixels * cfg.num_times;
+        res.item_name = "pixels";
+        results.push_back(res);
+    }
+
+    // Three PSF variants built from the shared psi/phi planes.
+    if (enabled("fill_psi_phi_psf_variants")) {
+        const std::vector<search::PSF> psfs = {search::PSF(0.8), search::PSF(1.0), search::PSF(1.4)};
+        std::vector<search::PsiPhiArray> arrays(psfs.size());
+        std::vector<search::PsiPhiArray*> array_ptrs;
+        for (auto& arr : arrays) array_ptrs.push_back(&arr);
+
+        BenchResult res = time_benchmark(
+                "fill_psi_phi_psf_variants", cfg.repeats,
+                [&arrays]() {
+                    for (auto& arr : arrays) arr.clear();
+                },
+                [&]() { search::fill_psi_phi_arrays_for_psfs(array_ptrs, stack, psfs, -1, false); });
+        res.items = num_pixels * cfg.num_times * psfs.size();
+        res.item_name = "pixels";
+        results.push_back(res);
+    }
+
+    // --- Image operations ------------------------------------------------
+    if (enabled("convolve_cpu")) {
+        search::RawImage base = stack.get_single_image(0).get_science();
+        search::RawImage img;
+        BenchResult res = time_benchmark(
+                "convolve_cpu", cfg.repeats, [&]() { img = base; }, [&]() { img.convolve_cpu(psf); });
+        res.items = num_pixels;
+        res.item_name = "pixels";
+        results.push_back(res);
+    }
+
+    // A 4 x 4 grid of PSFs that widen toward the edges, interpolated per tile.
+    if (enabled("convolve_psf_grid")) {
+        std::vector<search::PSF> psfs;
+        for (int row = 0; row < 4; ++row) {
+            for (int col = 0; col < 4; ++col) psfs.push_back(search::PSF(0.8 + 0.1 * (row + col)));
+        }
+        const search::PSFGrid grid(cfg.width, cfg.height, 4, 4, psfs);
+        search::RawImage base = stack.get_single_image(0).get_science();
+        search::RawImage img;
+        BenchResult res = time_benchmark(
+                "convolve_psf_grid", cfg.repeats, [&]() { img = base; },
+                [&]() { img.convolve_psf_grid(grid); });
+        res.items = num_pixels;
+        res.item_name = "pixels";
+        results.push_back(res);
+    }
+
+    // The psi/phi encoding bounds of the stack's images with blocks combined in a
+    // fixed order (the default) and with the per-thread chunks.
+    for (bool deterministic : {true, false}) {
+        const std::string name = deterministic ? "scale_params_deterministic" : "scale_params_chunked";
+        if (!enabled(name)) continue;
+
+        std::vector<search::RawImage> imgs;
+        for (int t = 0; t < cfg.num_times; ++t) imgs.push_back(stack.get_single_image(t).get_science());
+        const bool original = search::ThreadPool::get_deterministic();
+        search::ThreadPool::set_deterministic(deterministic);
+        BenchResult res = time_benchmark(name, cfg.repeats, noop, [&]() {
+            search::compute_scale_params_from_image_vect(imgs, 1);
+        });
+        search::ThreadPool::set_deterministic(original);
+        res.items = num_pixels * cfg.num_times;
+        res.item_name = "pixels";
+        results.push_back(res);
+    }
+
+    if (enabled("create_median_image")) {
+        std::vector<search::RawImage> imgs;
+        for (int t = 0; t < cfg.num_times; ++t) imgs.push_back(stack.get_single_image(t).get_science());
+        BenchResult res = time_benchmark("create_median_image", cfg.repeats, noop,
+                                         [&]() { search::create_median_image(imgs); });
+        res.items = num_pixels * cfg.num_times;
+        res.item_name = "pixels";
+        results.push_back(res);
+    }
+
+    // --- Stamp coadds ----------------------------------------------------
+    const std::vector<std::pair<std::string, search::StampType>> stamp_types = {
+            {"sum", search::STAMP_SUM}, {"mean", search::STAMP_MEAN}, {"median", search::STAMP_MEDIAN}};
+    for (const auto& st : stamp_types) {
+        std::string name = "coadd_stamps_cpu_" + st.first;
+        if (!enabled(name)) continue;
+
+        search::StampParameters params;
+        params.radius = cfg.stamp_radius;
+        params.stamp_type = st.second;
+        params.do_filtering = false;
+        std::vector<std::vector<bool>> use_index(trjs.size(), std::vector<bool>());
+        BenchResult res = time_benchmark(name, cfg.repeats, noop, [&]() {
+            search::StampCreator::get_coadded_stamps_cpu(stack, trjs, use_index, params);
+        });
+        res.items = trjs.size();
+        res.item_name = "trajectories";
+        results.push_back(res);
+    }
+
+    // --- Trajectory evaluation on the CPU ---------------------------------
+    if (enabled("evaluate_trajectory")) {
+        search::StackSearch search_obj(stack);
+        search_obj.prepare_psi_phi();
+        BenchResult res = time_benchmark("evaluate_trajectory", cfg.repeats, noop, [&]() {
+            for (auto& trj : trjs) search_obj.evaluate_single_trajectory(trj);
+        });
+        res.items = trjs.size();
+        res.item_name = "trajectories";
+        results.push_back(res);
+    }
+
+    if (enabled("evaluate_trajectories")) {
+        search::StackSearch search_obj(stack);
+        search_obj.prepare_psi_phi();
+        BenchResult res = time_benchmark("evaluate_trajectories", cfg.repeats, noop,
+                                         [&]() { search_obj.evaluate_trajectories(trjs); });
+        res.items = trjs.size();
+        res.item_name = "trajectories";
+        results.push_back(res);
+    }
+
+    if (enabled("refine_results")) {
+        search::StackSearch search_obj(stack);
+        search_obj.prepare_psi_phi();
+        BenchResult res = time_benchmark(
+                "refine_results", cfg.repeats, [&]() { search_obj.set_results(trjs); },
+                [&]() { search_obj.refine_results(trjs.size(), 1.0, 0.05, 100); });
+        res.items = trjs.size();
+        res.item_name = "trajectories";
+        results.push_back(res);
+    }
+
+    // --- Search (on the GPU when there is one) ------------------------------
+    if (enabled("search")) {
+        search::StackSearch search_obj(stack);
+        search_obj.prepare_psi_phi();
+        std::vector<search::Trajectory> candidates = make_candidates(cfg);
+        BenchResult res = time_benchmark("search", cfg.repeats, noop,
+                                         [&]() { search_obj.search(candidates, cfg.num_times / 2); });
+        res.items = num_pixels * candidates.size();
+        res.item_name = "pixel_trajectories";
+        results.push_back(res);
+    }
+
+    // The same search split into four stacks of unequal height (like chips with
+    // different overlaps), searched together on the CPU.
+    if (enabled("search_stacks")) {
+        std::vector<std::unique_ptr<search::StackSearch>> searches;
+        std::vector<search::StackSearch*> search_ptrs;
+        const std::vector<int> row_bounds = {0, cfg.height / 2, (3 * cfg.height) / 4, (7 * cfg.height) / 8,
+                                             cfg.height};
+        for (size_t c = 0; c + 1 < row_bounds.size(); ++c) {
+            searches.emplace_back(new search::StackSearch(stack));
+            searches.back()->set_start_bounds_y(row_bounds[c], row_bounds[c + 1]);
+            searches.back()->prepare_psi_phi();
+            search_ptrs.push_back(searches.back().get());
+        }
+        std::vector<search::Trajectory> candidates = make_candidates(cfg);
+        BenchResult res = time_benchmark("search_stacks", cfg.repeats, noop, [&]() {
+            search::search_stacks(search_ptrs, candidates, cfg.num_times / 2);
+        });
+        res.items = num_pixels * candidates.size();
+        res.item_name = "pixel_trajectories";
+        results.push_back(res);
+    }
+
+    return results;
+}
+
+}  // namespace bench
+
+int main(int argc, char** argv) {
+    bench::BenchConfig cfg;
+    if (!bench::parse_args(argc, argv, cfg)) {
+        bench::print_usage();
+        return 1;
+    }
+    if (cfg.num_threads > 0) {
+        search::ThreadPool::instance().set_num_threads(cfg.num_threads);
+    }
+
+    std::vector<bench::BenchResult> results = bench::run_benchmarks(cfg);
+    std::string json = bench::to_json(cfg, results);
+
+    if (cfg.output.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(cfg.output);
+        if (!out) {
+            std::cerr << "Unable to open " << cfg.output << "\n";
+            return 1;
+        }
+        out << json;
+    }
+    return 0;
+}
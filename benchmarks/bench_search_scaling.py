@@ -0,0 +1,372 @@
+"""End-to-end scaling benchmark for ``SearchRunner.run_search`` on synthetic data.
+
+Generates fake stacks over a matrix of image sizes, numbers of times and velocity
+grid sizes, runs the full search with per-stage timing and reports throughput and
+peak RSS for each stage. Each case runs in its own subprocess so that the OpenMP
+thread count and the memory high-water mark are isolated.
+
+Examples
+--------
+Run a size matrix::
+
+    python bench_search_scaling.py --sizes 128x128 512x512 --num-times 10 50 \
+        --velocity-steps 8 16 --output scaling
+
+Produce strong and weak thread scaling curves (weak scaling grows the image
+height with the number of threads)::
+
+    python bench_search_scaling.py --sizes 256x256 --num-times 20 --velocity-steps 16 \
+        --threads 1 2 4 8 --scaling both --output threads
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import os
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+from contextlib import contextmanager
+
+STAGES = [
+    "masking",
+    "psi_phi",
+    "search",
+    "load_results",
+    "sigma_g",
+    "stamp_filter",
+    "clustering",
+]
+
+
+def _read_rss_kb(field):
+    """Read a memory field (in kB) from /proc/self/status. Returns None if unavailable."""
+    try:
+        with open("/proc/self/status") as f:
+            for line in f:
+                if line.startswith(field + ":"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return None
+
+
+def _reset_peak_rss():
+    """Reset the kernel's RSS high-water mark (Linux only). Returns True on success."""
+    try:
+        with open("/proc/self/clear_refs", "w") as f:
+            f.write("5")
+        return True
+    except OSError:
+        return False
+
+
+def _peak_rss_mb():
+    """Return the peak RSS of the current process in MB."""
+    hwm = _read_rss_kb("VmHWM")
+    if hwm is not None:
+        return hwm / 1024.0
+    # ru_maxrss is in kB on Linux and bytes on macOS.
+    maxrss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return maxrss / (1024.0 * 1024.0) if sys.platform == "darwin" else maxrss / 1024.0
+
+
+class StageRecorder:
+    """Accumulate the wall time and peak RSS of named stages.
+
+    Stages may nest (result loading includes the sigma-G filtering), so the
+    times are inclusive. When the high-water mark cannot be reset, the peak RSS
+    of a stage is the process peak at the end of that stage.
+    """
+
+    def __init__(self):
+        self.stages = {}
+        self.can_reset = _reset_peak_rss()
+
+    @contextmanager
+    def stage(self, name):
+        if self.can_reset:
+            _reset_peak_rss()
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            elapsed = time.perf_counter() - start
+            entry = self.stages.setdefault(name, {"seconds": 0.0, "calls": 0, "peak_rss_mb": 0.0})
+            entry["seconds"] += elapsed
+            entry["calls"] += 1
+            entry["peak_rss_mb"] = max(entry["peak_rss_mb"], _peak_rss_mb())
+
+    def wrap(self, name, func):
+        """Return a version of ``func`` that is timed as stage ``name``."""
+
+        def _timed(*args, **kwargs):
+            with self.stage(name):
+                return func(*args, **kwargs)
+
+        return _timed
+
+
+@contextmanager
+def instrument_run_search(recorder):
+    """Temporarily patch the stage functions used by ``kbmod.run_search`` so
+    that each stage is timed by ``recorder``. Yields a ``SearchRunner`` subclass
+    that times the result loading.
+    """
+    import kbmod.run_search as rs
+    import kbmod.search as kb
+
+    patched = {
+        "apply_mask_operations": "masking",
+        "apply_clipped_sigma_g": "sigma_g",
+        "get_coadds_and_filter": "stamp_filter",
+        "apply_clustering": "clustering",
+    }
+    originals = {attr: getattr(rs, attr) for attr in patched}
+    orig_stack_search = kb.StackSearch
+
+    class TimedStackSearch(orig_stack_search):
+        """Split the psi/phi preparation out of the search timing."""
+
+        def search(self, *args, **kwargs):
+            with recorder.stage("psi_phi"):
+                self.prepare_psi_phi()
+            with recorder.stage("search"):
+                return super().search(*args, **kwargs)
+
+    class TimedSearchRunner(rs.SearchRunner):
+        def load_and_filter_results(self, search, config):
+            with recorder.stage("load_results"):
+                return super().load_and_filter_results(search, config)
+
+    try:
+        for attr, name in patched.items():
+            setattr(rs, attr, recorder.wrap(name, originals[attr]))
+        kb.StackSearch = TimedStackSearch
+        yield TimedSearchRunner
+    finally:
+        for attr, func in originals.items():
+            setattr(rs, attr, func)
+        kb.StackSearch = orig_stack_search
+
+
+def run_case(case):
+    """Run a single benchmark case in the current process.
+
+    Parameters
+    ----------
+    case : `dict`
+        The case parameters: width, height, num_times, velocity_steps, threads,
+        num_objects and max_velocity.
+
+    Returns
+    -------
+    result : `dict`
+        The case parameters along with the per-stage timings, throughputs and
+        peak RSS.
+    """
+    from kbmod.configuration import SearchConfiguration
+    from kbmod.fake_data.fake_data_creator import FakeDataSet, create_fake_times
+    from kbmod.search import HAS_GPU
+    from kbmod.trajectory_generator import VelocityGridSearch
+
+    width = case["width"]
+    height = case["height"]
+    num_times = case["num_times"]
+    steps = case["velocity_steps"]
+    max_vel = case.get("max_velocity", 20.0)
+
+    gen_start = time.perf_counter()
+    times = create_fake_times(num_times, t0=57130.2)
+    ds = FakeDataSet(width, height, times, use_seed=True)
+    for _ in range(case.get("num_objects", 5)):
+        ds.insert_random_object(100.0)
+    data_seconds = time.perf_counter() - gen_start
+
+    config = SearchConfiguration()
+    config.set("num_cores", case["threads"])
+    config.set("num_obs", max(3, num_times // 2))
+    config.set("do_mask", True)
+    config.set("do_stamp_filter", True)
+    config.set("do_clustering", True)
+    config.set("average_angle", 0.0)
+    config.set("ind_output_files", False)
+    generator = VelocityGridSearch(steps, -max_vel, max_vel, steps, -max_vel, max_vel)
+
+    recorder = StageRecorder()
+    error = None
+    total_start = time.perf_counter()
+    try:
+        with instrument_run_search(recorder) as runner_class:
+            results = runner_class().run_search(config, ds.stack, trj_generator=generator)
+        num_results = results.num_results()
+    except RuntimeError as err:
+        # The search itself needs a GPU.
+        error = str(err)
+        num_results = 0
+    total_seconds = time.perf_counter() - total_start
+
+    num_pixels = width * height
+    num_trajectories = num_pixels * steps * steps
+    stages = recorder.stages
+    throughput = {}
+    if "search" in stages and stages["search"]["seconds"] > 0.0:
+        throughput["trajectories_per_s"] = num_trajectories / stages["search"]["seconds"]
+        throughput["trajectory_steps_per_s"] = num_trajectories * num_times / stages["search"]["seconds"]
+    throughput["pixel_times_per_s"] = num_pixels * num_times / total_seconds
+    if "psi_phi" in stages and stages["psi_phi"]["seconds"] > 0.0:
+        throughput["psi_phi_pixel_times_per_s"] = num_pixels * num_times / stages["psi_phi"]["seconds"]
+
+    result = dict(case)
+    result.update(
+        {
+            "has_gpu": HAS_GPU,
+            "num_trajectories": num_trajectories,
+            "num_results": num_results,
+            "data_seconds": data_seconds,
+            "total_seconds": total_seconds,
+            "peak_rss_mb": _peak_rss_mb() if not recorder.can_reset else None,
+            "stages": stages,
+            "throughput": throughput,
+            "error": error,
+        }
+    )
+    return result
+
+
+def run_case_subprocess(case):
+    """Run a case in a fresh interpreter with OMP_NUM_THREADS set to the case's threads."""
+    env = dict(os.environ)
+    env["OMP_NUM_THREADS"] = str(case["threads"])
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        out_file = os.path.join(tmp_dir, "result.json")
+        cmd = [sys.executable, os.path.abspath(__file__), "--worker", json.dumps(case), out_file]
+        proc = subprocess.run(cmd, env=env, capture_output=True, text=True)
+        if proc.returncode != 0 or not os.path.exists(out_file):
+            result = dict(case)
+            result["error"] = proc.stderr.strip().splitlines()[-1] if proc.stderr.strip() else "failed"
+            return result
+        with open(out_file) as f:
+            return json.load(f)
+
+
+def make_cases(args):
+    """Build the list of cases from the command line arguments."""
+    sizes = []
+    for size in args.sizes:
+        w, h = size.lower().split("x")
+        sizes.append((int(w), int(h)))
+
+    cases = []
+    base = {"num_objects": args.num_objects, "max_velocity": args.max_velocity}
+    for (width, height), num_times, steps in itertools.product(sizes, args.num_times, args.velocity_steps):
+        case = dict(base, width=width, num_times=num_times, velocity_steps=steps)
+        for threads in args.threads:
+            if args.scaling in ("strong", "both"):
+                cases.append(dict(case, height=height, threads=threads, scaling="strong"))
+            if args.scaling in ("weak", "both"):
+                # Grow the work (rows of the image) with the number of threads.
+                cases.append(dict(case, height=height * threads, threads=threads, scaling="weak"))
+    return cases
+
+
+def scaling_summary(results):
+    """Compute the speedup and efficiency of each case relative to the smallest
+    thread count for the same problem (strong) or per-thread problem (weak)."""
+    baselines = {}
+    for res in results:
+        base_height = res["height"] // res["threads"] if res["scaling"] == "weak" else res["height"]
+        key = (res["scaling"], res["width"], base_height, res["num_times"], res["velocity_steps"])
+        res["_key"] = key
+        if res.get("total_seconds") is None:
+            continue
+        if key not in baselines or res["threads"] < baselines[key]["threads"]:
+            baselines[key] = res
+
+    for res in results:
+        base = baselines.get(res.pop("_key"))
+        if base is None or res.get("total_seconds") is None:
+            continue
+        ratio = res["threads"] / base["threads"]
+        if res["scaling"] == "strong":
+            res["speedup"] = base["total_seconds"] / res["total_seconds"]
+            res["efficiency"] = res["speedup"] / ratio
+        else:
+            res["efficiency"] = base["total_seconds"] / res["total_seconds"]
+            res["speedup"] = res["efficiency"] * ratio
+    return results
+
+
+def write_csv(results, filename):
+    """Flatten the results into one row per case."""
+    fields = ["scaling", "width", "height", "num_times", "velocity_steps", "threads", "num_trajectories"]
+    fields += ["num_results", "total_seconds", "speedup", "efficiency"]
+    for stage in STAGES:
+        fields += [f"{stage}_s", f"{stage}_peak_rss_mb"]
+    fields += ["trajectories_per_s", "trajectory_steps_per_s", "pixel_times_per_s", "error"]
+
+    with open(filename, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=fields, extrasaction="ignore")
+        writer.writeheader()
+        for res in results:
+            row = dict(res)
+            for stage, data in res.get("stages", {}).items():
+                row[f"{stage}_s"] = data["seconds"]
+                row[f"{stage}_peak_rss_mb"] = data["peak_rss_mb"]
+            row.update(res.get("throughput", {}))
+            writer.writerow(row)
+
+
+def print_table(results):
+    print(" Scaling |    Size    | Times | Vel | Thr |  Total (s) | Search (s) | Speedup | Peak RSS (MB)")
+    print("-" * 95)
+    for res in results:
+        stages = res.get("stages", {})
+        search_s = stages.get("search", {}).get("seconds", float("nan"))
+        total_s = res.get("total_seconds", float("nan"))
+        peak = max([s["peak_rss_mb"] for s in stages.values()] + [res.get("peak_rss_mb") or 0.0])
+        print(
+            f" {res['scaling']:>7s} | {res['width']:4d}x{res['height']:<5d} | {res['num_times']:5d} | "
+            f"{res['velocity_steps']:3d} | {res['threads']:3d} | {total_s:10.4f} | "
+            f"{search_s:10.4f} | {res.get('speedup', float('nan')):7.2f} | {peak:10.1f}"
+        )
+        if res.get("error"):
+            print(f"          error: {res['error']}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="End-to-end scaling benchmark for run_search.")
+    parser.add_argument("--sizes", nargs="+", default=["128x128", "256x256"], help="Image sizes as WxH.")
+    parser.add_argument("--num-times", nargs="+", type=int, default=[10, 50])
+    parser.add_argument(
+        "--velocity-steps", nargs="+", type=int, default=[8, 16], help="Steps per velocity axis."
+    )
+    parser.add_argument("--threads", nargs="+", type=int, default=[1])
+    parser.add_argument("--scaling", choices=["strong", "weak", "both"], default="strong")
+    parser.add_argument("--num-objects", type=int, default=5, help="Number of objects to insert.")
+    parser.add_argument("--max-velocity", type=float, default=20.0, help="Maximum speed in pixels/day.")
+    parser.add_argument("--output", default=None, help="Write the results to OUTPUT.json and OUTPUT.csv.")
+    parser.add_argument("--worker", nargs=2, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker is not None:
+        result = run_case(json.loads(args.worker[0]))
+        with open(args.worker[1], "w") as f:
+            json.dump(result, f)
+        return
+
+    results = [run_case_subprocess(case) for case in make_cases(args)]
+    results = scaling_summary(results)
+    print_table(results)
+
+    if args.output is not None:
+        with open(f"{args.output}.json", "w") as f:
+            json.dump({"argv": sys.argv[1:], "results": results}, f, indent=2)
+        write_csv(results, f"{args.output}.csv")
+
+
+if __name__ == "__main__":
+    main()
@@ -41,6 +41,7 @@ class SearchConfiguration:
 
         self._params = {
             "ang_arr": [math.pi / 15, math.pi / 15, 128],
+            "async_logging": False,
             "average_angle": None,
             "center_thresh": 0.00,
             "chunk_size": 500000,
@@ -67,14 +68,21 @@ class SearchConfiguration:
             "mask_num_images": 2,
             "mask_threshold": None,
             "max_lh": 1000.0,
+            "max_memory_gb": None,
             "mjd_lims": None,
             "mom_lims": [35.5, 35.5, 2.0, 0.3, 0.3],
             "num_cores": 1,
             "num_obs": 10,
             "output_suffix": "search",
             "peak_offset": [2.0, 2.0],
+            "perf_counters": False,
             "psf_val": 1.4,
             "psf_file": None,
+            "psf_variants": None,
+            "refine_min_velocity_step": 0.05,
+            "refine_num_results": 0,
+            "refine_velocity_step": 1.0,
+            "reorder_candidates": False,
             "repeated_flag_keys": default_repeated_flag_keys,
             "res_filepath": None,
             "result_filename": None,
@@ -83,6 +91,7 @@ class SearchConfiguration:
             "stamp_radius": 10,
             "stamp_type": "sum",
             "time_file": None,
+            "trace_file": None,
             "v_arr": [92.0, 526.0, 256],
             "x_pixel_bounds": None,
             "x_pixel_buffer": None,
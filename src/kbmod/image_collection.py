@@ -4,6 +4,9 @@ The ``ImageCollection`` class stores additional information for the
 input FITS files that is used during a variety of analysis.
 """
 
+from collections import deque
+from concurrent.futures import ProcessPoolExecutor, ThreadPoolExecutor
+from functools import partial
 import os
 import glob
 import json
@@ -24,6 +27,73 @@ __all__ = [
 ]
 
 
+def _ordered_map(func, items, num_workers=1, executor="thread", max_pending=None):
+    """Apply a function to each item, optionally in parallel, and yield the
+    results in the order of the items.
+
+    At most ``max_pending`` items are submitted to the pool at any time, so the
+    number of results held in memory, but not yet consumed, stays bounded.
+
+    Parameters
+    ----------
+    func : `callable`
+        Function to apply. Must be picklable when ``executor`` is
+        ``"process"``.
+    items : `iterable`
+        The items to process. Consumed lazily.
+    num_workers : `int`
+        Number of workers. With one worker the items are processed serially
+        in the calling thread. Default: 1
+    executor : `str`
+        Either ``"thread"`` or ``"process"``. Default: ``"thread"``
+    max_pending : `int` or `None`
+        Maximum number of in-flight items. Defaults to twice the number of
+        workers.
+
+    Yields
+    ------
+    result
+        The result of ``func`` for each item, in order.
+
+    Raises
+    ------
+    ValueError:
+        When the number of workers or the executor type are invalid.
+    """
+    if num_workers < 1:
+        raise ValueError(f"Invalid number of workers {num_workers}")
+    if executor not in ("thread", "process"):
+        raise ValueError(f"Unknown executor {executor}, expected 'thread' or 'process'.")
+
+    if num_workers == 1:
+        for item in items:
+            yield func(item)
+        return
+
+    if max_pending is None:
+        max_pending = 2 * num_workers
+    pool_cls = ThreadPoolExecutor if executor == "thread" else ProcessPoolExecutor
+    pending = deque()
+    with pool_cls(max_workers=num_workers) as pool:
+        for item in items:
+            pending.append(pool.submit(func, item))
+            if len(pending) >= max_pending:
+                yield pending.popleft().result()
+        while pending:
+            yield pending.popleft().result()
+
+
+def _standardize_metadata(std):
+    """Module level wrapper around ``Standardizer.standardizeMetadata`` usable
+    by both the thread and process pools."""
+    return std.standardizeMetadata()
+
+
+def _to_layered_images(std):
+    """Module level wrapper around ``Standardizer.toLayeredImage``."""
+    return std.toLayeredImage()
+
+
 class ImageCollection:
     """A collection of basic pointing, file paths, names, timestamps and other
     metadata that facilitate, and make easier the construction of ImageStack
@@ -192,7 +262,7 @@ class ImageCollection:
         return cls(metadata)
 
     @classmethod
-    def fromStandardizers(cls, standardizers, meta=None):
+    def fromStandardizers(cls, standardizers, meta=None, num_workers=1):
         """Create ImageCollection from a collection `Standardizers`.
 
         The `Standardizer` is "unravelled", i.e. the shared metadata is
@@ -206,6 +276,11 @@ class ImageCollection:
         ----------
         standardizers : `iterable`
             Collection of `Standardizer` objects.
+        meta : `dict` or `None`
+            Metadata of the collection. Defaults to the number of standardizers.
+        num_workers : `int`
+            Number of threads used to standardize the metadata. The order of
+            the standardizers is preserved. Default: 1
 
         Returns
         -------
@@ -213,9 +288,9 @@ class ImageCollection:
             Image Collection
         """
         unravelledStdMetadata = []
-        for i, stdFits in enumerate(standardizers):
+        stdMetas = _ordered_map(_standardize_metadata, standardizers, num_workers)
+        for i, (stdFits, stdMeta) in enumerate(zip(standardizers, stdMetas)):
             # needs a "validate standardized" method here or in standardizers
-            stdMeta = stdFits.standardizeMetadata()
 
             # unravel all standardized keys whose values are iterables unless
             # they are a string. "Unraveling" means that each processable item
@@ -246,7 +321,7 @@ class ImageCollection:
         return cls(metadata=metadata, standardizers=standardizers)
 
     @classmethod
-    def fromTargets(cls, tgts, force=None, config=None, **kwargs):
+    def fromTargets(cls, tgts, force=None, config=None, num_workers=1, executor="thread", **kwargs):
         """Instantiate a ImageCollection class from a collection of targets
         recognized by the standardizers, for example file paths, integer id,
         dataset reference objects etc.
@@ -264,6 +339,15 @@ class ImageCollection:
             If `None`, when applicable, determine the correct `Standardizer` to
             use automatically. Otherwise force the use of the given
             `Standardizer`.
+        num_workers : `int`
+            Number of workers used to instantiate the standardizers and
+            standardize their metadata. Ordering of the targets is preserved.
+            Default: 1
+        executor : `str`
+            Use a ``"thread"`` or a ``"process"`` pool to instantiate the
+            standardizers. Process pools require the standardizers to be
+            picklable. Metadata is always standardized in threads.
+            Default: ``"thread"``
         **kwargs : `dict`
             Remaining kwargs, not listed here, are passed onwards to
             the underlying `Standardizer`.
@@ -273,11 +357,14 @@ class ImageCollection:
         ValueError:
             when location is not recognized as a file, directory or an URI
         """
-        standardizers = [Standardizer.get(tgt, force=force, config=config, **kwargs) for tgt in tgts]
-        return cls.fromStandardizers(standardizers)
+        get_std = partial(Standardizer.get, force=force, config=config, **kwargs)
+        standardizers = list(_ordered_map(get_std, tgts, num_workers, executor))
+        return cls.fromStandardizers(standardizers, num_workers=num_workers)
 
     @classmethod
-    def fromDir(cls, dirpath, recursive=False, force=None, config=None, **kwargs):
+    def fromDir(
+        cls, dirpath, recursive=False, force=None, config=None, num_workers=1, executor="thread", **kwargs
+    ):
         """Instantiate ImageInfoSet from a path to a directory
         containing FITS files.
 
@@ -294,12 +381,18 @@ class ImageCollection:
             If `None`, when applicable, determine the correct `Standardizer` to
             use automatically. Otherwise force the use of the given
             `Standardizer`.
+        num_workers : `int`
+            Number of workers, see `fromTargets`. Default: 1
+        executor : `str`
+            Type of the worker pool, see `fromTargets`. Default: ``"thread"``
         **kwargs : `dict`
             Remaining kwargs, not listed here, are passed onwards to
             the underlying `Standardizer`.
         """
         fits_files = glob.glob(os.path.join(dirpath, "*fits*"), recursive=recursive)
-        return cls.fromTargets(fits_files, force=force, config=config, **kwargs)
+        return cls.fromTargets(
+            fits_files, force=force, config=config, num_workers=num_workers, executor=executor, **kwargs
+        )
 
     ########################
     # PROPERTIES (type operations and invariants)
@@ -491,18 +584,36 @@ class ImageCollection:
         # maybe timespan?
         return self.data["mjd"][-1] - self.data["mjd"][0]
 
-    def toImageStack(self):
+    def _layered_images(self, standardizers, num_workers=1):
+        """Standardize the images of the given standardizers, in parallel
+        threads, and return the `LayeredImage` objects in order.
+
+        Reading and decompressing the FITS data, and the conversion into the
+        C++ layers, release the GIL so threads scale. Only ``2*num_workers``
+        standardizers are being processed at any time.
+        """
+        layeredImages = []
+        for imgs in _ordered_map(_to_layered_images, standardizers, num_workers):
+            layeredImages.extend(imgs)
+        return layeredImages
+
+    def toImageStack(self, num_workers=1):
         """Return an `~kbmod.search.image_stack` object for processing with
         KBMOD.
+
+        Parameters
+        ----------
+        num_workers : `int`
+            Number of threads used to standardize the images. Default: 1
+
         Returns
         -------
         imageStack : `~kbmod.search.image_stack`
             Image stack for processing with KBMOD.
         """
-        layeredImages = [img for std in self._standardizers for img in std.toLayeredImage()]
-        return ImageStack(layeredImages)
+        return ImageStack(self._layered_images(self._standardizers, num_workers))
 
-    def toWorkUnit(self, config):
+    def toWorkUnit(self, config, num_workers=None):
         """Return an `~kbmod.WorkUnit` object for processing with
         KBMOD.
 
@@ -510,13 +621,19 @@ class ImageCollection:
         ----------
         config : `~kbmod.SearchConfiguration`
             Search configuration.
+        num_workers : `int` or `None`
+            Number of threads used to standardize the images. Defaults to the
+            ``num_cores`` value of the configuration.
 
         Returns
         -------
         work_unit : `~kbmod.WorkUnit`
             A `~kbmod.WorkUnit` object for processing with KBMOD.
         """
-        layeredImages = [img for std in self.standardizers for img in std["std"].toLayeredImage()]
+        if num_workers is None:
+            num_workers = config["num_cores"]
+        standardizers = [std["std"] for std in self.standardizers]
+        layeredImages = self._layered_images(standardizers, num_workers)
         imgstack = ImageStack(layeredImages)
         if None not in self.wcs:
             return WorkUnit(imgstack, config, per_image_wcs=self.wcs)
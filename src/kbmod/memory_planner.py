@@ -0,0 +1,331 @@
+"""Functions for planning a search to fit within a memory budget.
+
+The planner estimates the host memory used by each part of the search (the
+image stack, the psi/phi arrays, the result and candidate buffers, the loaded
+results and the stamps) and picks the encoding and the chunking of the search
+so the estimated peak stays under the budget.
+"""
+
+import math
+
+import kbmod.search as kb
+
+logger = kb.Logging.getLogger(__name__)
+
+# The bytes per pixel per time of the layered images (science, variance and mask).
+STACK_BYTES_PER_PIXEL = 12
+
+# The bytes per pixel per time of the temporary psi and phi images.
+PSI_PHI_IMAGE_BYTES_PER_PIXEL = 8
+
+# The rough size of a Python ``Trajectory`` object, which holds a copy of the C++ data.
+PY_TRAJECTORY_BYTES = 128
+
+# The rough size of a loaded ``ResultRow`` without its per-time arrays.
+RESULT_ROW_BYTES = 1024
+
+# The bytes per stamp pixel for the coadds (the C++ stamp, the GPU buffer and the
+# copy held by the ResultRow).
+STAMP_BYTES_PER_PIXEL = 12
+
+# The shares of the memory left after the psi/phi array that each buffer may use.
+CANDIDATE_FRACTION = 0.25
+LOAD_FRACTION = 0.1
+STAMP_FRACTION = 0.25
+
+GB = 1024**3
+
+
+def get_search_bounds(config, width, height):
+    """Compute the bounds of the starting pixels of the search from the
+    configuration.
+
+    Parameters
+    ----------
+    config : `SearchConfiguration`
+        The configuration parameters.
+    width : `int`
+        The width of the images in pixels.
+    height : `int`
+        The height of the images in pixels.
+
+    Returns
+    -------
+    bounds : `tuple`
+        The bounds (x_min, x_max, y_min, y_max) with the maxima exclusive.
+    """
+    x_min, x_max = 0, width
+    if config["x_pixel_bounds"] and len(config["x_pixel_bounds"]) == 2:
+        x_min, x_max = config["x_pixel_bounds"]
+    elif config["x_pixel_buffer"] and config["x_pixel_buffer"] > 0:
+        x_min, x_max = -config["x_pixel_buffer"], width + config["x_pixel_buffer"]
+
+    y_min, y_max = 0, height
+    if config["y_pixel_bounds"] and len(config["y_pixel_bounds"]) == 2:
+        y_min, y_max = config["y_pixel_bounds"]
+    elif config["y_pixel_buffer"] and config["y_pixel_buffer"] > 0:
+        y_min, y_max = -config["y_pixel_buffer"], height + config["y_pixel_buffer"]
+
+    return (x_min, x_max, y_min, y_max)
+
+
+class SearchMemoryPlan:
+    """The encoding and chunking of a search chosen to fit a memory budget.
+
+    Attributes
+    ----------
+    max_memory_bytes : `int`
+        The budget in bytes.
+    encode_num_bytes : `int`
+        The psi/phi encoding (-1 for floats, 2 or 1 for the integer encodings).
+    x_bounds : `tuple`
+        The (min, max) starting x pixels, shared by all the spatial chunks.
+    y_ranges : `list`
+        The (min, max) starting y pixels of each spatial chunk.
+    velocity_chunk_size : `int` or `None`
+        The number of candidate velocities to search at a time, ``None`` to
+        search them all at once.
+    chunk_size : `int`
+        The number of results to load from the search at a time.
+    stamp_chunk_size : `int`
+        The number of results to create coadded stamps for at a time.
+    estimates : `dict`
+        The estimated bytes of each component of the search.
+    """
+
+    def __init__(self, max_memory_bytes):
+        self.max_memory_bytes = max_memory_bytes
+        self.encode_num_bytes = -1
+        self.x_bounds = (0, 0)
+        self.y_ranges = []
+        self.velocity_chunk_size = None
+        self.chunk_size = 0
+        self.stamp_chunk_size = 0
+        self.estimates = {}
+
+    @property
+    def rows_per_chunk(self):
+        """The largest number of starting rows in a spatial chunk."""
+        return max([y_max - y_min for y_min, y_max in self.y_ranges], default=0)
+
+    @property
+    def peak_bytes(self):
+        """The estimated peak memory of the search in bytes."""
+        return self.estimates.get("peak", 0)
+
+    def __str__(self):
+        lines = [
+            f"Memory plan for a budget of {self.max_memory_bytes / GB:.2f} GB:",
+            f"  encode_num_bytes = {self.encode_num_bytes}",
+            f"  spatial chunks = {len(self.y_ranges)} of up to {self.rows_per_chunk} rows",
+            f"  velocity_chunk_size = {self.velocity_chunk_size}",
+            f"  chunk_size = {self.chunk_size}",
+            f"  stamp_chunk_size = {self.stamp_chunk_size}",
+        ]
+        for name, value in self.estimates.items():
+            lines.append(f"  {name}: {value / GB:.3f} GB")
+        return "\n".join(lines)
+
+
+def plan_search_memory(
+    max_memory_bytes,
+    num_times,
+    width,
+    height,
+    search_bounds,
+    num_trajectories=None,
+    native_candidates=True,
+    encode_num_bytes=-1,
+    chunk_size=500000,
+    stamp_radius=10,
+    stamp_chunk_size=1000000,
+    num_psfs=1,
+):
+    """Choose the encoding and chunking of a search to fit a memory budget.
+
+    The encoding is the most precise one (starting from the requested one) whose
+    psi/phi arrays fit. The memory that remains is shared between the candidate
+    velocities (split into chunks if they take more than their share), the
+    result loading batches and the per-pixel result buffers (split into chunks
+    of rows of starting pixels). The stamps are created after the search data
+    is freed, so their batches are sized against the memory left after the stack.
+
+    Parameters
+    ----------
+    max_memory_bytes : `int`
+        The memory budget in bytes.
+    num_times : `int`
+        The number of images.
+    width : `int`
+        The width of the images in pixels.
+    height : `int`
+        The height of the images in pixels.
+    search_bounds : `tuple`
+        The bounds (x_min, x_max, y_min, y_max) of the starting pixels.
+    num_trajectories : `int`, optional
+        The number of candidate velocities. If ``None`` (unknown) the velocities are
+        always searched in chunks that fit.
+    native_candidates : `bool`
+        Whether the candidates come from a native (C++) generator, in which case
+        no Python objects are created for them when they are searched in one
+        pass. Chunks of candidates are always Python lists.
+    encode_num_bytes : `int`
+        The requested encoding (-1 for floats).
+    chunk_size : `int`
+        The largest number of results to load at a time.
+    stamp_radius : `int`
+        The radius of the stamps in pixels.
+    stamp_chunk_size : `int`
+        The largest number of stamps to create at a time.
+    num_psfs : `int`
+        The number of PSF variants, each of which has its own psi/phi array.
+
+    Returns
+    -------
+    plan : `SearchMemoryPlan`
+        The chosen plan.
+
+    Raises
+    ------
+    ValueError
+        If the search cannot fit in the budget with any plan.
+    """
+    if max_memory_bytes <= 0:
+        raise ValueError(f"Invalid memory budget {max_memory_bytes}")
+    x_min, x_max, y_min, y_max = search_bounds
+    search_width = x_max - x_min
+    search_height = y_max - y_min
+    if search_width <= 0 or search_height <= 0:
+        raise ValueError(f"Invalid search bounds {search_bounds}")
+
+    plan = SearchMemoryPlan(max_memory_bytes)
+    plan.x_bounds = (x_min, x_max)
+    num_pixels = width * height
+
+    # The stack is already loaded, so everything else has to fit around it.
+    stack_bytes = num_times * num_pixels * STACK_BYTES_PER_PIXEL
+    available = max_memory_bytes - stack_bytes
+    if available <= 0:
+        raise ValueError(
+            f"The image stack alone ({stack_bytes / GB:.2f} GB) exceeds the budget "
+            f"of {max_memory_bytes / GB:.2f} GB."
+        )
+
+    # Choose the most precise encoding that fits along with at least one row of
+    # results. The psi/phi images are only held while the array is built.
+    image_bytes = num_psfs * num_times * num_pixels * PSI_PHI_IMAGE_BYTES_PER_PIXEL
+    bytes_per_pixel = kb.RESULTS_PER_PIXEL * kb.TRAJECTORY_BYTES
+    min_remaining = search_width * bytes_per_pixel / (1.0 - CANDIDATE_FRACTION - LOAD_FRACTION)
+    encodings = [4, 2, 1]
+    if encode_num_bytes in (1, 2):
+        encodings = encodings[encodings.index(encode_num_bytes) :]
+    array_bytes = None
+    for num_bytes in encodings:
+        array_bytes = num_psfs * 2 * num_bytes * num_times * num_pixels
+        if image_bytes + array_bytes < available and available - array_bytes >= min_remaining:
+            plan.encode_num_bytes = num_bytes if num_bytes < 4 else -1
+            break
+    else:
+        raise ValueError(
+            f"The psi/phi arrays ({(image_bytes + array_bytes) / GB:.2f} GB) and a row of results "
+            f"do not fit in the {available / GB:.2f} GB left after the image stack."
+        )
+    remaining = available - array_bytes
+
+    # The candidates, which are also copied into a TrajectoryList. A native
+    # generator avoids the Python objects only if all of its candidates fit,
+    # since the chunks are built as lists of Python trajectories.
+    candidate_budget = int(CANDIDATE_FRACTION * remaining)
+    native_fits = num_trajectories is not None and num_trajectories * kb.TRAJECTORY_BYTES <= candidate_budget
+    if native_candidates and native_fits:
+        candidate_bytes = num_trajectories * kb.TRAJECTORY_BYTES
+    else:
+        bytes_per_candidate = kb.TRAJECTORY_BYTES + PY_TRAJECTORY_BYTES
+        max_candidates = max(1, candidate_budget // bytes_per_candidate)
+        if num_trajectories is None or num_trajectories > max_candidates:
+            # An unknown number of candidates is always searched in bounded chunks.
+            plan.velocity_chunk_size = max_candidates
+            candidate_bytes = max_candidates * bytes_per_candidate
+        else:
+            candidate_bytes = num_trajectories * bytes_per_candidate
+
+    # The batches of loaded results, which carry their psi and phi curves.
+    row_bytes = RESULT_ROW_BYTES + 3 * 8 * num_times
+    plan.chunk_size = max(1, min(chunk_size, int(LOAD_FRACTION * remaining) // row_bytes))
+    load_bytes = plan.chunk_size * row_bytes
+
+    # Split the rows of starting pixels so each chunk's results fit.
+    results_budget = remaining - candidate_bytes - load_bytes
+    rows_per_chunk = int(results_budget // (bytes_per_pixel * search_width))
+    if rows_per_chunk <= 0:
+        raise ValueError(
+            f"A single row of {search_width} starting pixels does not fit in the "
+            f"{max(results_budget, 0) / GB:.2f} GB left for the results."
+        )
+    num_chunks = math.ceil(search_height / rows_per_chunk)
+    rows_per_chunk = math.ceil(search_height / num_chunks)
+    plan.y_ranges = [
+        (start, min(start + rows_per_chunk, y_max)) for start in range(y_min, y_max, rows_per_chunk)
+    ]
+    result_bytes = rows_per_chunk * search_width * bytes_per_pixel
+
+    # The stamps are made after the search data has been freed.
+    stamp_width = 2 * stamp_radius + 1
+    stamp_bytes_each = stamp_width * stamp_width * STAMP_BYTES_PER_PIXEL
+    plan.stamp_chunk_size = max(1, min(stamp_chunk_size, int(STAMP_FRACTION * available) // stamp_bytes_each))
+    stamp_bytes = plan.stamp_chunk_size * stamp_bytes_each
+
+    search_peak = max(image_bytes + array_bytes, array_bytes + candidate_bytes + load_bytes + result_bytes)
+    plan.estimates = {
+        "stack": stack_bytes,
+        "psi_phi_images": image_bytes,
+        "psi_phi_array": array_bytes,
+        "candidates": candidate_bytes,
+        "results": result_bytes,
+        "result_loading": load_bytes,
+        "stamps": stamp_bytes,
+        "peak": stack_bytes + max(search_peak, stamp_bytes),
+    }
+    return plan
+
+
+def plan_search_from_config(config, stack, trj_generator):
+    """Plan a search to fit in the configuration's ``max_memory_gb``.
+
+    Parameters
+    ----------
+    config : `SearchConfiguration`
+        The configuration parameters.
+    stack : `ImageStack`
+        The images to search.
+    trj_generator : `TrajectoryGenerator`
+        The object to generate the candidate trajectories for each pixel.
+
+    Returns
+    -------
+    plan : `SearchMemoryPlan`
+        The chosen plan.
+    """
+    width = stack.get_width()
+    height = stack.get_height()
+
+    native_generator = trj_generator.to_native()
+    num_trajectories = None
+    if native_generator is not None:
+        num_trajectories = native_generator.size()
+
+    plan = plan_search_memory(
+        int(config["max_memory_gb"] * GB),
+        stack.img_count(),
+        width,
+        height,
+        get_search_bounds(config, width, height),
+        num_trajectories=num_trajectories,
+        native_candidates=native_generator is not None,
+        encode_num_bytes=config["encode_num_bytes"],
+        chunk_size=config["chunk_size"],
+        stamp_radius=config["stamp_radius"],
+        num_psfs=max(1, len(config["psf_variants"] or [])),
+    )
+    logger.info(str(plan))
+    return plan
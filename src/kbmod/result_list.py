@@ -16,6 +16,7 @@ from kbmod.file_utils import *
 from kbmod.trajectory_utils import (
     make_trajectory,
     trajectory_from_yaml,
+    trajectories_predict_skypos,
     trajectory_predict_skypos,
     trajectory_to_yaml,
 )
@@ -145,6 +146,8 @@ class ResultRow:
             data["flux"],
             data["likelihood"],
             data["obs_count"],
+            # Tables written before the PSF variants have no psf_index column.
+            data["psf_index"] if "psf_index" in data.columns else 0,
         )
 
         # Manually fill in all the rest of the values. We let the stamp related columns
@@ -183,6 +186,7 @@ class ResultRow:
             or self.trajectory.lh != other.trajectory.lh
             or self.trajectory.flux != other.trajectory.flux
             or self.trajectory.obs_count != other.trajectory.obs_count
+            or self.trajectory.psf_index != other.trajectory.psf_index
         ):
             return False
 
@@ -465,6 +469,7 @@ class ResultRow:
             result_dict["trajectory_vx"].append(self.trajectory.vx)
             result_dict["trajectory_vy"].append(self.trajectory.vy)
             result_dict["obs_count"].append(self.trajectory.obs_count)
+            result_dict["psf_index"].append(self.trajectory.psf_index)
             result_dict["flux"].append(self.trajectory.flux)
         else:
             result_dict["trajectory"].append(trajectory)
@@ -721,9 +726,21 @@ class ResultList:
         -------
         self : ResultList
             Returns a reference to itself to allow chaining.
+
+        Raises
+        ------
+        ValueError if a row does not have one entry per time in the list.
         """
+        num_times = len(self._all_times)
         for row in self.results:
-            row.compute_predicted_skypos(self._all_times, wcs)
+            if row.num_times != num_times:
+                raise ValueError(f"Expected an array of length {row.num_times} got {num_times} instead")
+
+        # Convert all the trajectories in a single batch.
+        ra, dec = trajectories_predict_skypos([row.trajectory for row in self.results], wcs, self._all_times)
+        for i, row in enumerate(self.results):
+            row.pred_ra = ra[i]
+            row.pred_dec = dec[i]
         return self
 
     def filter_results(self, indices_to_keep, label=None):
@@ -924,6 +941,7 @@ class ResultList:
             "trajectory_vx": [],
             "trajectory_vy": [],
             "obs_count": [],
+            "psf_index": [],
             "flux": [],
             "likelihood": [],
             "stamp": [],
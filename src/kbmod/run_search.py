@@ -1,3 +1,4 @@
+import itertools
 import os
 import time
 
@@ -13,6 +14,7 @@ from .filters.sigma_g_filter import apply_clipped_sigma_g, SigmaGClipping
 from .filters.stamp_filters import append_all_stamps, get_coadds_and_filter
 from .filters.stats_filters import CombinedStatsFilter
 from .masking import apply_mask_operations
+from .memory_planner import get_search_bounds, plan_search_from_config
 from .result_list import *
 from .trajectory_generator import KBMODV1Search
 from .wcs_utils import calc_ecliptic_angle
@@ -26,7 +28,8 @@ class SearchRunner:
     """A class to run the KBMOD grid search."""
 
     def __init__(self):
-        pass
+        # The timings and counters from the most recent call to run_search.
+        self.run_report = None
 
     def get_angle_limits(self, config):
         """Compute the angle limits based on the configuration information.
@@ -45,7 +48,7 @@ class SearchRunner:
         ang_max = config["average_angle"] + config["ang_arr"][1]
         return [ang_min, ang_max]
 
-    def load_and_filter_results(self, search, config):
+    def load_and_filter_results(self, search, config, chunk_size=None):
         """This function loads results that are output by the gpu grid search.
         Results are loaded in chunks and evaluated to see if the minimum
         likelihood level has been reached. If not, another chunk of results is
@@ -58,8 +61,9 @@ class SearchRunner:
             The search function object.
         config : `SearchConfiguration`
             The configuration parameters
-        chunk_size : int
-            The number of results to load at a given time from search.
+        chunk_size : int, optional
+            The number of results to load at a given time from search. If None
+            uses the configuration's ``chunk_size``.
 
         Returns
         -------
@@ -72,7 +76,8 @@ class SearchRunner:
         clip_negative = config["clip_negative"]
         lh_level = config["lh_level"]
         max_lh = config["max_lh"]
-        chunk_size = config["chunk_size"]
+        if chunk_size is None:
+            chunk_size = config["chunk_size"]
         if chunk_size <= 0:
             raise ValueError(f"Invalid chunk size {chunk_size}")
         num_cores = config["num_cores"]
@@ -127,15 +132,30 @@ class SearchRunner:
             batch_size = result_batch.num_results()
             logger.info(f"Extracted batch of {batch_size} results for total of {total_count}")
             if batch_size > 0:
-                apply_clipped_sigma_g(clipper, result_batch, num_cores)
-                result_batch.apply_filter(stats_filter)
+                with kb.ScopedTimer("sigma_g"):
+                    apply_clipped_sigma_g(clipper, result_batch, num_cores)
+                    result_batch.apply_filter(stats_filter)
 
                 # Add the results to the final set.
                 keep.extend(result_batch)
             res_num += chunk_size
+        kb.Instrumentation.add_counter("results_loaded", total_count)
         return keep
 
-    def do_gpu_search(self, config, stack, trj_generator):
+    def _refine_results(self, search, config):
+        """Refine the velocities of the best results of the last search (if
+        ``refine_num_results`` is set)."""
+        num_refine = config["refine_num_results"]
+        if num_refine is None or num_refine <= 0:
+            return
+        logger.info(f"Refining the best {num_refine} results")
+        search.refine_results(
+            int(num_refine),
+            velocity_step=config["refine_velocity_step"],
+            min_velocity_step=config["refine_min_velocity_step"],
+        )
+
+    def do_gpu_search(self, config, stack, trj_generator, plan=None):
         """Performs search on the GPU.
 
         Parameters
@@ -146,6 +166,9 @@ class SearchRunner:
             The stack before the masks have been applied. Modified in-place.
         trj_generator : `TrajectoryGenerator`
             The object to generate the candidate trajectories for each pixel.
+        plan : `SearchMemoryPlan`, optional
+            The encoding and chunking to use. If None the search is done in one
+            pass with the configuration's settings.
 
         Returns
         -------
@@ -160,15 +183,9 @@ class SearchRunner:
         debug = config["debug"]
 
         # Set the search bounds.
-        if config["x_pixel_bounds"] and len(config["x_pixel_bounds"]) == 2:
-            search.set_start_bounds_x(config["x_pixel_bounds"][0], config["x_pixel_bounds"][1])
-        elif config["x_pixel_buffer"] and config["x_pixel_buffer"] > 0:
-            search.set_start_bounds_x(-config["x_pixel_buffer"], width + config["x_pixel_buffer"])
-
-        if config["y_pixel_bounds"] and len(config["y_pixel_bounds"]) == 2:
-            search.set_start_bounds_y(config["y_pixel_bounds"][0], config["y_pixel_bounds"][1])
-        elif config["y_pixel_buffer"] and config["y_pixel_buffer"] > 0:
-            search.set_start_bounds_y(-config["y_pixel_buffer"], height + config["y_pixel_buffer"])
+        x_min, x_max, y_min, y_max = get_search_bounds(config, width, height)
+        search.set_start_bounds_x(x_min, x_max)
+        search.set_start_bounds_y(y_min, y_max)
 
         search_timer = kb.DebugTimer("grid search", logger)
         logger.debug(f"{trj_generator}")
@@ -188,25 +205,93 @@ class SearchRunner:
 
         # If we are using an encoded image representation on GPU, enable it and
         # set the parameters.
-        if config["encode_num_bytes"] > 0:
-            search.enable_gpu_encoding(config["encode_num_bytes"])
+        encode_num_bytes = config["encode_num_bytes"] if plan is None else plan.encode_num_bytes
+        if encode_num_bytes > 0:
+            search.enable_gpu_encoding(encode_num_bytes)
+
+        # Search with several PSF widths instead of the images' own PSFs.
+        if config["psf_variants"]:
+            logger.info(f"Searching with PSF variants {config['psf_variants']}")
+            search.set_psf_variants([kb.PSF(float(std)) for std in config["psf_variants"]])
+
+        # Order the candidate velocities for better memory locality.
+        if config["reorder_candidates"]:
+            search.set_candidate_reordering(True)
 
         # Enable debugging.
         if config["debug"]:
             search.set_debug(config["debug"])
 
-        # Do the actual search.
-        candidates = [trj for trj in trj_generator]
-        search.search(candidates, int(config["num_obs"]))
+        if plan is None:
+            # Do the actual search. Use the native generator when one exists to
+            # avoid creating a Python object for every candidate.
+            native_generator = trj_generator.to_native()
+            if native_generator is not None:
+                search.search(native_generator, int(config["num_obs"]))
+            else:
+                candidates = [trj for trj in trj_generator]
+                search.search(candidates, int(config["num_obs"]))
+            self._refine_results(search, config)
+            search_timer.stop()
+
+            # Load the results.
+            with kb.ScopedTimer("load_results"), kb.MemoryStage("load_results"):
+                keep = self.load_and_filter_results(search, config)
+            return keep
+
+        # Search each chunk of candidate velocities over every chunk of starting
+        # rows. The candidates are generated only once (generators such as
+        # RandomVelocitySearch cannot be rewound) and the psi/phi data is computed
+        # once and reused by every chunk.
+        mjds = [stack.get_obstime(t) for t in range(stack.img_count())]
+        keep = ResultList(mjds)
+        num_velocity_chunks = 0
+        for candidates in self._candidate_chunks(trj_generator, plan.velocity_chunk_size):
+            for chunk_y_min, chunk_y_max in plan.y_ranges:
+                logger.debug(f"Searching starting rows [{chunk_y_min}, {chunk_y_max})")
+                search.set_start_bounds_y(chunk_y_min, chunk_y_max)
+                search.search(candidates, int(config["num_obs"]))
+                self._refine_results(search, config)
+                with kb.ScopedTimer("load_results"), kb.MemoryStage("load_results"):
+                    keep.extend(self.load_and_filter_results(search, config, plan.chunk_size))
+            num_velocity_chunks += 1
+
+            # Each velocity chunk keeps its own best results per starting pixel, so
+            # keep only the overall best as a single pass would (though here the
+            # selection happens after the sigma-G and stats filters). Pruning after
+            # every chunk bounds the results by the number of starting pixels.
+            if num_velocity_chunks > 1:
+                _keep_best_per_pixel(keep, kb.RESULTS_PER_PIXEL)
         search_timer.stop()
 
-        # Load the results.
-        keep = self.load_and_filter_results(search, config)
+        if len(plan.y_ranges) > 1 or num_velocity_chunks > 1:
+            keep.sort()
         return keep
 
-    def run_search(self, config, stack, trj_generator=None):
-        """This function serves as the highest-level python interface for starting
-        a KBMOD search given an ImageStack and SearchConfiguration.
+    @staticmethod
+    def _candidate_chunks(trj_generator, chunk_size):
+        """Yield the candidates to search, either the native generator (when not
+        chunking and one exists) or lists of at most chunk_size trajectories.
+        The generator is only iterated once.
+        """
+        if chunk_size is None:
+            native_generator = trj_generator.to_native()
+            if native_generator is not None:
+                yield native_generator
+            else:
+                yield [trj for trj in trj_generator]
+            return
+
+        iterator = iter(trj_generator)
+        while True:
+            candidates = list(itertools.islice(iterator, chunk_size))
+            if len(candidates) == 0:
+                return
+            yield candidates
+
+    def _search_and_save(self, config, stack, trj_generator):
+        """Apply the masks, run the search and the filtering on the results and
+        save them as requested by the configuration.
 
         Parameters
         ----------
@@ -214,7 +299,7 @@ class SearchRunner:
             The configuration parameters
         stack : `ImageStack`
             The stack before the masks have been applied. Modified in-place.
-        trj_generator : `TrajectoryGenerator`, optional
+        trj_generator : `TrajectoryGenerator` or None
             The object to generate the candidate trajectories for each pixel.
             If None uses the default KBMODv1 grid search
 
@@ -223,11 +308,10 @@ class SearchRunner:
         keep : ResultList
             The results.
         """
-        full_timer = kb.DebugTimer("KBMOD", logger)
-
         # Apply the mask to the images.
         if config["do_mask"]:
-            stack = apply_mask_operations(config, stack)
+            with kb.ScopedTimer("masking"), kb.MemoryStage("masking"):
+                stack = apply_mask_operations(config, stack)
 
         # Perform the actual search.
         if trj_generator is None:
@@ -240,16 +324,26 @@ class SearchRunner:
                 ang_limits[0],
                 ang_limits[1],
             )
-        keep = self.do_gpu_search(config, stack, trj_generator)
+
+        # Plan the encoding and chunking to fit in the memory budget.
+        plan = None
+        if config["max_memory_gb"] is not None:
+            plan = plan_search_from_config(config, stack, trj_generator)
+
+        with kb.ScopedTimer("grid_search"), kb.MemoryStage("grid_search"):
+            keep = self.do_gpu_search(config, stack, trj_generator, plan)
 
         if config["do_stamp_filter"]:
             stamp_timer = kb.DebugTimer("stamp filtering", logger)
-            get_coadds_and_filter(
-                keep,
-                stack,
-                config,
-                debug=config["debug"],
-            )
+            stamp_chunk_size = 1000000 if plan is None else plan.stamp_chunk_size
+            with kb.ScopedTimer("stamp_filter"), kb.MemoryStage("stamp_filter"):
+                get_coadds_and_filter(
+                    keep,
+                    stack,
+                    config,
+                    chunk_size=stamp_chunk_size,
+                    debug=config["debug"],
+                )
             stamp_timer.stop()
 
         if config["do_clustering"]:
@@ -264,13 +358,15 @@ class SearchRunner:
                 "width": stack.get_width(),
                 "height": stack.get_height(),
             }
-            apply_clustering(keep, cluster_params)
+            with kb.ScopedTimer("clustering"), kb.MemoryStage("clustering"):
+                apply_clustering(keep, cluster_params)
             cluster_timer.stop()
 
         # Extract all the stamps for all time steps and append them onto the result rows.
         if config["save_all_stamps"]:
             stamp_timer = kb.DebugTimer("computing all stamps", logger)
-            append_all_stamps(keep, stack, config["stamp_radius"])
+            with kb.ScopedTimer("all_stamps"), kb.MemoryStage("all_stamps"):
+                append_all_stamps(keep, stack, config["stamp_radius"])
             stamp_timer.stop()
 
         # TODO - Re-enable the known object counting once we have a way to pass
@@ -289,7 +385,63 @@ class SearchRunner:
         if config["result_filename"] is not None:
             keep.write_table(config["result_filename"], keep_all_stamps=config["save_all_stamps"])
 
-        full_timer.stop()
+        return keep
+
+    def run_search(self, config, stack, trj_generator=None):
+        """This function serves as the highest-level python interface for starting
+        a KBMOD search given an ImageStack and SearchConfiguration.
+
+        Parameters
+        ----------
+        config : `SearchConfiguration`
+            The configuration parameters
+        stack : `ImageStack`
+            The stack before the masks have been applied. Modified in-place.
+        trj_generator : `TrajectoryGenerator`, optional
+            The object to generate the candidate trajectories for each pixel.
+            If None uses the default KBMODv1 grid search
+
+        Returns
+        -------
+        keep : ResultList
+            The results.
+        """
+        full_timer = kb.DebugTimer("KBMOD", logger)
+        kb.Instrumentation.reset()
+        kb.MemoryTracker.reset()
+        if config["num_cores"] <= 0:
+            raise ValueError(f"Invalid number of cores {config['num_cores']}")
+        kb.ThreadPool.set_num_threads(config["num_cores"])
+        if config["async_logging"]:
+            kb.Logging.set_async(True)
+        if config["trace_file"] is not None:
+            kb.Instrumentation.set_tracing(True)
+        if config["perf_counters"] and not kb.PerfCounters.set_enabled(True):
+            logger.debug("Hardware performance counters are not available.")
+        try:
+            # The run's phase and memory stage end even if the search fails.
+            with kb.ScopedTimer("run_search"), kb.MemoryStage("run_search"):
+                keep = self._search_and_save(config, stack, trj_generator)
+            full_timer.stop()
+
+            # Record where the time and memory went.
+            self.run_report = kb.Instrumentation.get_report()
+            self.run_report["memory"] = kb.MemoryTracker.get_report()
+            logger.debug(kb.Instrumentation.to_string())
+            logger.debug(kb.MemoryTracker.to_string())
+        finally:
+            if config["perf_counters"]:
+                kb.PerfCounters.set_enabled(False)
+            if config["trace_file"] is not None:
+                kb.Instrumentation.set_tracing(False)
+            if config["async_logging"]:
+                # Write out any queued messages, including those about a failure.
+                kb.Logging.set_async(False)
+
+            # Write the events so far, even for a failed run. Last, as it can fail.
+            if config["trace_file"] is not None:
+                kb.Instrumentation.write_trace(config["trace_file"])
+                logger.info(f"Wrote trace to {config['trace_file']}")
 
         return keep
 
@@ -416,3 +568,24 @@ class SearchRunner:
 
         if num_found > 0:
             logger.info(f"{matches_string}")
+
+
+def _keep_best_per_pixel(result_list, max_per_pixel):
+    """Keep only the max_per_pixel most likely results for each starting pixel.
+
+    Parameters
+    ----------
+    result_list : `ResultList`
+        The results. Modified in-place.
+    max_per_pixel : `int`
+        The number of results to keep for each starting pixel.
+    """
+    by_pixel = {}
+    for i, row in enumerate(result_list.results):
+        by_pixel.setdefault((row.trajectory.x, row.trajectory.y), []).append(i)
+
+    inds_to_keep = []
+    for inds in by_pixel.values():
+        inds.sort(key=lambda i: result_list.results[i].trajectory.lh, reverse=True)
+        inds_to_keep.extend(inds[:max_per_pixel])
+    result_list.filter_results(inds_to_keep)
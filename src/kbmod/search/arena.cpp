@@ -0,0 +1,77 @@
+#include "arena.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace search {
+
+Arena::Arena(uint64_t block_bytes) : block_bytes(block_bytes), current(0), capacity(MEM_ARENA) {}
+
+Arena::~Arena() {
+    for (Block& block : blocks) HugePages::deallocate(block.data);
+}
+
+Arena& Arena::for_thread() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+void Arena::add_block(uint64_t min_bytes) {
+    uint64_t size = std::max(block_bytes, min_bytes);
+    char* data = static_cast<char*>(HugePages::allocate(size));
+    if (data == nullptr) {
+        throw std::runtime_error("Unable to allocate " + std::to_string(size) + " bytes for an arena.");
+    }
+
+    blocks.push_back({data, size, 0});
+    capacity.set(capacity.get_bytes() + size);
+}
+
+void* Arena::allocate(uint64_t bytes, uint64_t alignment) {
+    // Use the current block or the next one that fits, adding one if needed.
+    // The blocks are aligned to SIMD_ALIGNMENT, so aligning offsets is enough.
+    while (true) {
+        if (current < blocks.size()) {
+            Block& block = blocks[current];
+            uint64_t offset = ((block.used + alignment - 1) / alignment) * alignment;
+            if (offset + bytes <= block.size) {
+                block.used = offset + bytes;
+                return block.data + offset;
+            }
+            if (current + 1 < blocks.size()) {
+                current += 1;
+                blocks[current].used = 0;
+                continue;
+            }
+        }
+
+        add_block(bytes + alignment);
+        current = blocks.size() - 1;
+    }
+}
+
+void Arena::rewind(const Mark& position) {
+    if (blocks.empty()) return;
+
+    if (position.block == 0 && position.offset == 0 && blocks.size() > 1) {
+        // The arena is empty, so coalesce the blocks. The next batch of the same
+        // size then fits in one block.
+        uint64_t total = capacity.get_bytes();
+        for (Block& block : blocks) HugePages::deallocate(block.data);
+        blocks.clear();
+        capacity.set(0);
+        add_block(total);
+    }
+
+    current = position.block;
+    blocks[current].used = position.offset;
+    for (size_t i = current + 1; i < blocks.size(); ++i) blocks[i].used = 0;
+}
+
+uint64_t Arena::get_bytes_used() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i <= current && i < blocks.size(); ++i) total += blocks[i].used;
+    return total;
+}
+
+} /* namespace search */
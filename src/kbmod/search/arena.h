@@ -0,0 +1,103 @@
+/*
+ * arena.h
+ *
+ * A bump allocator for the short-lived scratch memory of batch operations
+ * (the stamps of a trajectory, the pixel lists of a median, squared PSF
+ * kernels). Allocation moves a pointer through large blocks and freeing
+ * rewinds it, so once the arena has grown to the size of a batch the inner
+ * loops do no heap allocation at all.
+ *
+ * Each thread has its own arena (Arena::for_thread()), so no locking is
+ * needed. Only trivially destructible data (pixels, indices) should be
+ * placed in an arena since destructors are never run. Use an ArenaScope to
+ * release everything allocated within a scope. When the outermost scope of a
+ * batch ends, an arena that had to grow past its first block replaces its
+ * blocks with a single one large enough for the whole batch.
+ *
+ * Created on: October 18, 2026
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "huge_pages.h"
+#include "memory_tracker.h"
+
+namespace search {
+
+// The size of the first block of an arena.
+constexpr uint64_t DEFAULT_ARENA_BLOCK_BYTES = 1024 * 1024;
+
+class Arena {
+public:
+    explicit Arena(uint64_t block_bytes = DEFAULT_ARENA_BLOCK_BYTES);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // The calling thread's arena.
+    static Arena& for_thread();
+
+    void* allocate(uint64_t bytes, uint64_t alignment = SIMD_ALIGNMENT);
+
+    template <typename T>
+    T* allocate_array(uint64_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena data is never destroyed.");
+        return static_cast<T*>(allocate(count * sizeof(T), std::max<uint64_t>(alignof(T), SIMD_ALIGNMENT)));
+    }
+
+    // A position in the arena to rewind to.
+    struct Mark {
+        size_t block;
+        uint64_t offset;
+    };
+    Mark mark() const { return {current, blocks.empty() ? 0 : blocks[current].used}; }
+    void rewind(const Mark& position);
+
+    // Release everything. Nothing allocated from the arena may still be in use.
+    void reset() { rewind({0, 0}); }
+
+    uint64_t get_bytes_used() const;
+    uint64_t get_capacity() const { return capacity.get_bytes(); }
+    int get_num_blocks() const { return blocks.size(); }
+
+private:
+    struct Block {
+        char* data;
+        uint64_t size;
+        uint64_t used;
+    };
+
+    void add_block(uint64_t min_bytes);
+
+    uint64_t block_bytes;
+    std::vector<Block> blocks;
+    size_t current;
+    TrackedBytes capacity;
+};
+
+// Rewinds an arena to where it was when the scope was entered.
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena = Arena::for_thread()) : arena_(arena), mark_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(mark_); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    Arena& arena() { return arena_; }
+
+private:
+    Arena& arena_;
+    Arena::Mark mark_;
+};
+
+} /* namespace search */
+
+#endif /* ARENA_H_ */
@@ -11,6 +11,7 @@ namespace py = pybind11;
 #include "geom.h"
 
 #include "psf.cpp"
+#include "psf_grid.cpp"
 #include "raw_image.cpp"
 #include "layered_image.cpp"
 #include "image_stack.cpp"
@@ -19,11 +20,23 @@ namespace py = pybind11;
 #include "kernel_testing_helpers.cpp"
 #include "psi_phi_array.cpp"
 #include "debug_timer.cpp"
+#include "instrumentation.cpp"
+#include "perf_counters.cpp"
+#include "memory_tracker.cpp"
+#include "huge_pages.cpp"
+#include "arena.cpp"
+#include "thread_pool.cpp"
 #include "trajectory_list.cpp"
+#include "trajectory_evaluator.cpp"
+#include "trajectory_generator.cpp"
+#include "multi_stack_search.cpp"
+#include "tan_wcs.cpp"
 
 PYBIND11_MODULE(search, m) {
     m.attr("KB_NO_DATA") = pybind11::float_(search::NO_DATA);
     m.attr("HAS_GPU") = pybind11::bool_(search::HAVE_GPU);
+    m.attr("RESULTS_PER_PIXEL") = pybind11::int_(search::RESULTS_PER_PIXEL);
+    m.attr("TRAJECTORY_BYTES") = pybind11::int_(sizeof(search::Trajectory));
     py::enum_<search::StampType>(m, "StampType")
             .value("STAMP_SUM", search::StampType::STAMP_SUM)
             .value("STAMP_MEAN", search::StampType::STAMP_MEAN)
@@ -35,6 +48,7 @@ PYBIND11_MODULE(search, m) {
     indexing::rectangle_bindings(m);
     indexing::geom_functions(m);
     search::psf_bindings(m);
+    search::psf_grid_bindings(m);
     search::raw_image_bindings(m);
     search::layered_image_bindings(m);
     search::image_stack_bindings(m);
@@ -45,7 +59,15 @@ PYBIND11_MODULE(search, m) {
     search::stamp_parameters_bindings(m);
     search::psi_phi_array_binding(m);
     search::debug_timer_binding(m);
+    search::instrumentation_bindings(m);
+    search::perf_counters_bindings(m);
+    search::memory_tracker_bindings(m);
+    search::huge_pages_bindings(m);
+    search::thread_pool_bindings(m);
     search::trajectory_list_binding(m);
+    search::trajectory_generator_bindings(m);
+    search::multi_stack_search_bindings(m);
+    search::tan_wcs_bindings(m);
     // Helper function from common.h
     m.def("pixel_value_valid", &search::pixel_value_valid);
     // Functions from raw_image.cpp
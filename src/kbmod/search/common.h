@@ -52,6 +52,8 @@ struct Trajectory {
     short obs_count;
     // Whether the trajectory is valid. Used for on-GPU filtering.
     bool valid = true;
+    // The PSF variant scored (see StackSearch::set_psf_variants).
+    unsigned char psf_index = 0;
 
     // Get pixel positions from a zero-shifted time.
     float get_x_pos(float time) const { return x + time * vx; }
@@ -176,6 +178,7 @@ static void trajectory_bindings(py::module &m) {
             .def_readwrite("y", &tj::y)
             .def_readwrite("obs_count", &tj::obs_count)
             .def_readwrite("valid", &tj::valid)
+            .def_readwrite("psf_index", &tj::psf_index)
             .def("get_x_pos", &tj::get_x_pos, pydocs::DOC_Trajectory_get_x_pos)
             .def("get_y_pos", &tj::get_y_pos, pydocs::DOC_Trajectory_get_y_pos)
             .def("is_close", &tj::is_close, pydocs::DOC_Trajectory_is_close)
@@ -183,13 +186,16 @@ static void trajectory_bindings(py::module &m) {
             .def("__str__", &tj::to_string)
             .def(py::pickle(
                     [](const tj &p) {  // __getstate__
-                        return py::make_tuple(p.vx, p.vy, p.lh, p.flux, p.x, p.y, p.obs_count, p.valid);
+                        return py::make_tuple(p.vx, p.vy, p.lh, p.flux, p.x, p.y, p.obs_count, p.valid,
+                                              p.psf_index);
                     },
                     [](py::tuple t) {  // __setstate__
-                        if (t.size() != 8) throw std::runtime_error("Invalid state!");
+                        // States pickled before psf_index was added have 8 entries.
+                        if (t.size() != 8 && t.size() != 9) throw std::runtime_error("Invalid state!");
                         tj trj = {t[0].cast<float>(), t[1].cast<float>(), t[2].cast<float>(),
                                   t[3].cast<float>(), t[4].cast<short>(), t[5].cast<short>(),
                                   t[6].cast<short>(), t[7].cast<bool>()};
+                        if (t.size() == 9) trj.psf_index = t[8].cast<unsigned char>();
                         return trj;
                     }));
 }
@@ -28,28 +28,29 @@ DebugTimer::DebugTimer(std::string message) : message_(message) {
 
 void DebugTimer::start() {
     running_ = true;
-    t_start_ = std::chrono::system_clock::now();
-    logger_->debug("Starting " + message_ + " timer.");
+    t_start_ = std::chrono::steady_clock::now();
+    LOG_DEBUG(logger_, "Starting " + message_ + " timer.");
 }
 
 void DebugTimer::stop() {
-    t_end_ = std::chrono::system_clock::now();
+    t_end_ = std::chrono::steady_clock::now();
     running_ = false;
     auto t_delta = std::chrono::duration_cast<std::chrono::milliseconds>(t_end_ - t_start_);
-    logger_->debug("Finished " + message_ + " in " + std::to_string(t_delta.count() / 1000.0) + "seconds.");
+    LOG_DEBUG(logger_,
+              "Finished " + message_ + " in " + std::to_string(t_delta.count() / 1000.0) + "seconds.");
 }
 
 double DebugTimer::read() {
     std::chrono::milliseconds t_delta;
     if (running_) {
-        std::chrono::time_point<std::chrono::system_clock> t_current_ = std::chrono::system_clock::now();
+        std::chrono::time_point<std::chrono::steady_clock> t_current_ = std::chrono::steady_clock::now();
         t_delta = std::chrono::duration_cast<std::chrono::milliseconds>(t_current_ - t_start_);
     } else {
         t_delta = std::chrono::duration_cast<std::chrono::milliseconds>(t_end_ - t_start_);
     }
 
     double result = t_delta.count() / 1000.0;
-    logger_->debug("Step " + message_ + " is at " + std::to_string(result) + "seconds.");
+    LOG_DEBUG(logger_, "Step " + message_ + " is at " + std::to_string(result) + "seconds.");
     return result;
 }
 
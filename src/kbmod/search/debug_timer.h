@@ -27,8 +27,8 @@ public:
     double read();
 
 private:
-    std::chrono::time_point<std::chrono::system_clock> t_start_;
-    std::chrono::time_point<std::chrono::system_clock> t_end_;
+    std::chrono::time_point<std::chrono::steady_clock> t_start_;
+    std::chrono::time_point<std::chrono::steady_clock> t_end_;
     bool running_;
     logging::Logger* logger_;
     std::string message_;
@@ -0,0 +1,228 @@
+#include "huge_pages.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "logging.h"
+
+namespace search {
+
+std::atomic<bool> HugePages::enabled(true);
+std::mutex HugePages::lock;
+std::map<void*, HugePages::Allocation> HugePages::allocations;
+
+static uint64_t round_up(uint64_t value, uint64_t multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+void* HugePages::allocate(uint64_t bytes) {
+    Allocation allocation = {nullptr, bytes, 0, false};
+
+#ifdef __linux__
+    if (enabled && bytes >= MIN_HUGE_PAGE_BUFFER) {
+        const uint64_t mapped_bytes = round_up(bytes, HUGE_PAGE_SIZE);
+
+        // The explicit pool fails the mapping up front if it is too small.
+        void* ptr = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            allocation = {ptr, bytes, mapped_bytes, true};
+        } else {
+            // Over-allocate by a huge page to align the start and trim the ends.
+            const uint64_t raw_bytes = mapped_bytes + HUGE_PAGE_SIZE;
+            char* raw = (char*)mmap(nullptr, raw_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                                    -1, 0);
+            if (raw == MAP_FAILED) return nullptr;
+
+            char* start = (char*)round_up((uint64_t)raw, HUGE_PAGE_SIZE);
+            char* end = start + mapped_bytes;
+            if (start > raw) munmap(raw, start - raw);
+            if (raw + raw_bytes > end) munmap(end, raw + raw_bytes - end);
+
+            madvise(start, mapped_bytes, MADV_HUGEPAGE);
+            allocation = {start, bytes, mapped_bytes, false};
+        }
+    }
+#endif
+
+    if (allocation.base == nullptr) {
+        const uint64_t heap_bytes = round_up(std::max<uint64_t>(bytes, 1), SIMD_ALIGNMENT);
+        allocation.base = std::aligned_alloc(SIMD_ALIGNMENT, heap_bytes);
+        if (allocation.base == nullptr) return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    allocations[allocation.base] = allocation;
+    return allocation.base;
+}
+
+void HugePages::deallocate(void* ptr) {
+    if (ptr == nullptr) return;
+
+    Allocation allocation = {ptr, 0, 0, false};
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = allocations.find(ptr);
+        if (it != allocations.end()) {
+            allocation = it->second;
+            allocations.erase(it);
+            found = true;
+        }
+    }
+    if (!found) {
+        LOG_WARNING(logging::getLogger("kbmod.search.huge_pages"),
+                    "Freeing a buffer not from HugePages::allocate with free().");
+    }
+
+#ifdef __linux__
+    if (allocation.mapped_bytes > 0) {
+        munmap(allocation.base, allocation.mapped_bytes);
+        return;
+    }
+#endif
+    std::free(allocation.base);
+}
+
+bool HugePages::owns(const void* ptr) {
+    std::lock_guard<std::mutex> guard(lock);
+    return allocations.count(const_cast<void*>(ptr)) > 0;
+}
+
+bool HugePages::advise(void* ptr, uint64_t bytes) {
+#ifdef __linux__
+    if (!enabled || ptr == nullptr) return false;
+
+    // Only the whole huge pages inside the buffer can be advised.
+    uint64_t start = round_up((uint64_t)ptr, HUGE_PAGE_SIZE);
+    uint64_t end = (((uint64_t)ptr + bytes) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+    if (end <= start) return false;
+    return madvise((void*)start, end - start, MADV_HUGEPAGE) == 0;
+#else
+    return false;
+#endif
+}
+
+namespace {
+// The huge page bytes of one mapping in /proc/self/smaps.
+struct SmapsRegion {
+    uint64_t start;
+    uint64_t end;
+    uint64_t huge_page_bytes;
+};
+
+std::vector<SmapsRegion> read_smaps_regions() {
+    std::vector<SmapsRegion> regions;
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    while (std::getline(smaps, line)) {
+        // Mapping headers start with "<start>-<end> " in hex. The fields that
+        // follow are "<Name>: <value> kB".
+        size_t dash = line.find('-');
+        size_t colon = line.find(':');
+        if (dash != std::string::npos && (colon == std::string::npos || dash < colon) && line.size() > dash &&
+            std::isxdigit(line[0])) {
+            regions.push_back({std::stoull(line.substr(0, dash), nullptr, 16),
+                               std::stoull(line.substr(dash + 1), nullptr, 16), 0});
+            continue;
+        }
+        if (regions.empty() || colon == std::string::npos) continue;
+
+        std::string key = line.substr(0, colon);
+        if (key == "AnonHugePages" || key == "Shared_Hugetlb" || key == "Private_Hugetlb") {
+            regions.back().huge_page_bytes += std::stoull(line.substr(colon + 1)) * 1024;
+        }
+    }
+    return regions;
+}
+
+uint64_t count_huge_page_bytes(const std::vector<SmapsRegion>& regions, uint64_t start, uint64_t end) {
+    // A mapping may be merged with its neighbours, so count at most the overlap.
+    uint64_t total = 0;
+    for (const SmapsRegion& region : regions) {
+        uint64_t lo = std::max(start, region.start);
+        uint64_t hi = std::min(end, region.end);
+        if (lo < hi) total += std::min(hi - lo, region.huge_page_bytes);
+    }
+    return total;
+}
+}  // namespace
+
+uint64_t HugePages::get_huge_page_bytes(const void* ptr, uint64_t bytes) {
+    if (ptr == nullptr || bytes == 0) return 0;
+    return count_huge_page_bytes(read_smaps_regions(), (uint64_t)ptr, (uint64_t)ptr + bytes);
+}
+
+HugePageUsage HugePages::get_usage() {
+    std::vector<SmapsRegion> regions = read_smaps_regions();
+
+    HugePageUsage usage;
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto& [ptr, allocation] : allocations) {
+        usage.num_buffers += 1;
+        usage.bytes += allocation.bytes;
+        if (allocation.mapped_bytes == 0) continue;
+
+        if (allocation.hugetlb) {
+            usage.hugetlb_bytes += allocation.bytes;
+        } else {
+            usage.transparent_bytes += allocation.bytes;
+        }
+        uint64_t start = (uint64_t)allocation.base;
+        usage.huge_page_bytes += count_huge_page_bytes(regions, start, start + allocation.bytes);
+    }
+    return usage;
+}
+
+std::string HugePages::to_string() {
+    constexpr double MB = 1024.0 * 1024.0;
+    HugePageUsage usage = get_usage();
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "Huge pages " << (enabled ? "enabled" : "disabled") << ": " << usage.num_buffers << " buffers of "
+       << usage.bytes / MB << " MB (" << usage.hugetlb_bytes / MB << " MB hugetlb, "
+       << usage.transparent_bytes / MB << " MB transparent), " << usage.huge_page_bytes / MB
+       << " MB on huge pages\n";
+    return ss.str();
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static void huge_pages_bindings(py::module& m) {
+    using hp = search::HugePages;
+
+    py::class_<hp>(m, "HugePages", pydocs::DOC_HugePages)
+            .def_static("get_enabled", &hp::get_enabled, pydocs::DOC_HugePages_get_enabled)
+            .def_static("set_enabled", &hp::set_enabled, pydocs::DOC_HugePages_set_enabled)
+            .def_static(
+                    "get_report",
+                    []() {
+                        search::HugePageUsage usage = hp::get_usage();
+                        py::dict report;
+                        report["enabled"] = hp::get_enabled();
+                        report["num_buffers"] = usage.num_buffers;
+                        report["bytes"] = usage.bytes;
+                        report["hugetlb_bytes"] = usage.hugetlb_bytes;
+                        report["transparent_bytes"] = usage.transparent_bytes;
+                        report["huge_page_bytes"] = usage.huge_page_bytes;
+                        return report;
+                    },
+                    pydocs::DOC_HugePages_get_report)
+            .def_static("to_string", &hp::to_string, pydocs::DOC_HugePages_to_string);
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
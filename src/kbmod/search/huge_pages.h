@@ -0,0 +1,92 @@
+/*
+ * huge_pages.h
+ *
+ * Allocation of the large buffers (the psi/phi array and the image layers)
+ * on 2 MB huge pages. The search reads these buffers at scattered offsets, so
+ * with 4 KB pages most reads miss the TLB.
+ *
+ * Buffers from HugePages::allocate() are mapped directly: from the explicit
+ * huge page pool (MAP_HUGETLB) when it has room, and otherwise 2 MB aligned and
+ * advised for transparent huge pages (MADV_HUGEPAGE). Buffers owned by others,
+ * such as Eigen matrices, can be advised before they are first written. Since
+ * the kernel is free to ignore the advice, the number of bytes actually backed
+ * by huge pages is read back from /proc/self/smaps.
+ *
+ * Created on: October 18, 2026
+ */
+
+#ifndef HUGE_PAGES_H_
+#define HUGE_PAGES_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "pydocs/huge_pages_docs.h"
+
+namespace search {
+
+constexpr uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// The alignment of every buffer (a cache line, enough for any SIMD load).
+constexpr uint64_t SIMD_ALIGNMENT = 64;
+
+// Buffers smaller than this come from the heap.
+constexpr uint64_t MIN_HUGE_PAGE_BUFFER = HUGE_PAGE_SIZE;
+
+struct HugePageUsage {
+    uint64_t num_buffers = 0;
+    uint64_t bytes = 0;
+    uint64_t hugetlb_bytes = 0;      // Mapped from the explicit huge page pool.
+    uint64_t transparent_bytes = 0;  // Advised for transparent huge pages.
+    uint64_t huge_page_bytes = 0;    // Currently backed by huge pages.
+};
+
+class HugePages {
+public:
+    // Allocate a buffer of at least bytes, aligned to SIMD_ALIGNMENT. Returns
+    // nullptr on failure. Must be freed with deallocate().
+    static void* allocate(uint64_t bytes);
+
+    // Free a buffer from allocate(). Since this runs from destructors it does not
+    // throw: any other pointer is logged and returned to the heap with free().
+    static void deallocate(void* ptr);
+
+    // Whether ptr is a live buffer from allocate().
+    static bool owns(const void* ptr);
+
+    // Advise the kernel to back the whole 2 MB pages of an existing buffer with
+    // transparent huge pages. Should be called before the buffer is written.
+    // Returns false if the advice was not taken.
+    static bool advise(void* ptr, uint64_t bytes);
+
+    // The bytes of [ptr, ptr + bytes) currently backed by huge pages.
+    static uint64_t get_huge_page_bytes(const void* ptr, uint64_t bytes);
+
+    // Turn the use of huge pages on or off (on by default). Off, allocate()
+    // uses aligned heap memory and advise() does nothing.
+    static bool get_enabled() { return enabled; }
+    static void set_enabled(bool enable) { enabled = enable; }
+
+    // The live buffers from allocate().
+    static HugePageUsage get_usage();
+    static std::string to_string();
+
+private:
+    struct Allocation {
+        void* base;
+        uint64_t bytes;
+        uint64_t mapped_bytes;  // 0 for heap buffers.
+        bool hugetlb;
+    };
+
+    static std::atomic<bool> enabled;
+    static std::mutex lock;
+    static std::map<void*, Allocation> allocations;
+};
+
+} /* namespace search */
+
+#endif /* HUGE_PAGES_H_ */
@@ -0,0 +1,327 @@
+#include "instrumentation.h"
+
+namespace search {
+
+std::atomic<bool> Instrumentation::enabled_flag(true);
+std::atomic<bool> Instrumentation::tracing_flag(false);
+
+Instrumentation& Instrumentation::instance() {
+    static Instrumentation registry;
+    return registry;
+}
+
+Instrumentation::ThreadData& Instrumentation::local_data() {
+    // Registered once per thread. The registry keeps a reference so the data
+    // survives the thread (e.g. when OpenMP shuts down its pool).
+    thread_local std::shared_ptr<ThreadData> data = nullptr;
+    if (data == nullptr) {
+        data = std::make_shared<ThreadData>();
+        std::lock_guard<std::mutex> guard(registry_lock);
+        data->thread_id = thread_data.size();
+        thread_data.push_back(data);
+    }
+    return *data;
+}
+
+void Instrumentation::set_tracing(bool tracing) {
+    // Start the trace clock when tracing is first turned on.
+    if (tracing && !is_tracing()) {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        trace_epoch = std::chrono::steady_clock::now();
+    }
+    tracing_flag.store(tracing, std::memory_order_relaxed);
+}
+
+void Instrumentation::reset() {
+    // Only the calling thread's stack can be cleared safely. Timers that are
+    // still running on it will not find their phase when they stop.
+    local_data().phase_stack.clear();
+
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (auto& data : thread_data) {
+        std::lock_guard<std::mutex> thread_guard(data->lock);
+        data->phases.clear();
+        data->counters.clear();
+        data->hardware.clear();
+        data->events.clear();
+    }
+    trace_epoch = std::chrono::steady_clock::now();
+}
+
+void Instrumentation::add_phase_time(const std::string& path, double seconds) {
+    ThreadData& data = local_data();
+    std::lock_guard<std::mutex> guard(data.lock);
+    data.phases[path].add(seconds);
+}
+
+void Instrumentation::add_counter(const std::string& name, uint64_t value) {
+    ThreadData& data = local_data();
+    std::lock_guard<std::mutex> guard(data.lock);
+    data.counters[name] += value;
+}
+
+void Instrumentation::add_hardware_counts(const std::string& path, const HardwareCounts& counts) {
+    ThreadData& data = local_data();
+    std::lock_guard<std::mutex> guard(data.lock);
+    data.hardware[path].merge(counts);
+}
+
+void Instrumentation::add_trace_event(const std::string& name, const std::string& path,
+                                      std::chrono::steady_clock::time_point t_start,
+                                      std::chrono::steady_clock::time_point t_end) {
+    ThreadData& data = local_data();
+    std::lock_guard<std::mutex> guard(data.lock);
+    double start_us = std::chrono::duration<double, std::micro>(t_start - trace_epoch).count();
+    double duration_us = std::chrono::duration<double, std::micro>(t_end - t_start).count();
+    data.events.push_back({name, path, start_us, duration_us});
+}
+
+std::string Instrumentation::push_phase(const std::string& name, const std::string& parent) {
+    ThreadData& data = local_data();
+    std::string path;
+    if (!data.phase_stack.empty()) {
+        path = data.phase_stack.back() + "/" + name;
+    } else {
+        path = parent.empty() ? name : parent + "/" + name;
+    }
+    data.phase_stack.push_back(path);
+    return path;
+}
+
+void Instrumentation::pop_phase(const std::string& path) {
+    // Timers stopped out of order remove their own entry, not the innermost one.
+    std::vector<std::string>& stack = local_data().phase_stack;
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        if (*it == path) {
+            stack.erase(std::next(it).base());
+            return;
+        }
+    }
+}
+
+std::string Instrumentation::current_phase() {
+    ThreadData& data = local_data();
+    return data.phase_stack.empty() ? "" : data.phase_stack.back();
+}
+
+std::map<std::string, PhaseStats> Instrumentation::get_phases() {
+    std::map<std::string, PhaseStats> result;
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (auto& data : thread_data) {
+        std::lock_guard<std::mutex> thread_guard(data->lock);
+        for (auto& entry : data->phases) result[entry.first].merge(entry.second);
+    }
+    return result;
+}
+
+std::map<std::string, uint64_t> Instrumentation::get_counters() {
+    std::map<std::string, uint64_t> result;
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (auto& data : thread_data) {
+        std::lock_guard<std::mutex> thread_guard(data->lock);
+        for (auto& entry : data->counters) result[entry.first] += entry.second;
+    }
+    return result;
+}
+
+std::map<std::string, HardwareCounts> Instrumentation::get_hardware_counts() {
+    std::map<std::string, HardwareCounts> result;
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (auto& data : thread_data) {
+        std::lock_guard<std::mutex> thread_guard(data->lock);
+        for (auto& entry : data->hardware) result[entry.first].merge(entry.second);
+    }
+    return result;
+}
+
+std::string Instrumentation::to_string() {
+    std::stringstream ss;
+    ss << "Phase timings (calls, total s, min s, max s):\n";
+    for (auto& entry : get_phases()) {
+        const PhaseStats& stats = entry.second;
+        ss << "  " << entry.first << ": " << stats.calls << ", " << stats.total_seconds << ", "
+           << stats.min_seconds << ", " << stats.max_seconds << "\n";
+    }
+    ss << "Counters:\n";
+    for (auto& entry : get_counters()) {
+        ss << "  " << entry.first << ": " << entry.second << "\n";
+    }
+
+    auto hardware = get_hardware_counts();
+    if (!hardware.empty()) {
+        ss << "Hardware counters (cycles, instructions, cache misses, branch misses):\n";
+        for (auto& entry : hardware) {
+            const HardwareCounts& counts = entry.second;
+            ss << "  " << entry.first << ": " << counts.cycles << ", " << counts.instructions << ", "
+               << counts.cache_misses << ", " << counts.branch_misses << "\n";
+        }
+    }
+    return ss.str();
+}
+
+size_t Instrumentation::num_trace_events() {
+    size_t count = 0;
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (auto& data : thread_data) {
+        std::lock_guard<std::mutex> thread_guard(data->lock);
+        count += data->events.size();
+    }
+    return count;
+}
+
+static std::string json_escape(const std::string& str) {
+    std::string result;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            result += ' ';
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+void Instrumentation::write_trace(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) throw std::runtime_error("Unable to open trace file " + filename);
+    out.precision(3);
+    out << std::fixed;
+
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (auto& data : thread_data) {
+        std::lock_guard<std::mutex> thread_guard(data->lock);
+        if (data->events.empty()) continue;
+
+        // Name the thread's track.
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << data->thread_id << ", \"args\": {\"name\": \"thread " << data->thread_id << "\"}}";
+        first = false;
+
+        for (auto& evt : data->events) {
+            out << ",\n{\"name\": \"" << json_escape(evt.name) << "\", \"cat\": \"kbmod\", \"ph\": \"X\", "
+                << "\"ts\": " << evt.start_us << ", \"dur\": " << evt.duration_us
+                << ", \"pid\": 1, \"tid\": " << data->thread_id << ", \"args\": {\"path\": \""
+                << json_escape(evt.path) << "\"}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+// --------------------------------------------
+// ScopedTimer
+// --------------------------------------------
+
+ScopedTimer::ScopedTimer(const std::string& name, const std::string& parent)
+        : active_(Instrumentation::is_enabled()), tracing_(false), running_(true) {
+    if (active_) {
+        path_ = Instrumentation::instance().push_phase(name, parent);
+        tracing_ = Instrumentation::is_tracing();
+        if (tracing_) name_ = name;
+    }
+    t_start_ = std::chrono::steady_clock::now();
+}
+
+void ScopedTimer::stop() {
+    if (!running_) return;
+    t_end_ = std::chrono::steady_clock::now();
+    running_ = false;
+
+    if (active_) {
+        Instrumentation& registry = Instrumentation::instance();
+        registry.add_phase_time(path_, std::chrono::duration<double>(t_end_ - t_start_).count());
+        if (tracing_) registry.add_trace_event(name_, path_, t_start_, t_end_);
+        registry.pop_phase(path_);
+    }
+}
+
+double ScopedTimer::read() const {
+    auto t_last = running_ ? std::chrono::steady_clock::now() : t_end_;
+    return std::chrono::duration<double>(t_last - t_start_).count();
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static py::dict instrumentation_report() {
+    Instrumentation& registry = Instrumentation::instance();
+
+    py::dict phases;
+    for (auto& entry : registry.get_phases()) {
+        py::dict stats;
+        stats["calls"] = entry.second.calls;
+        stats["total_seconds"] = entry.second.total_seconds;
+        stats["min_seconds"] = entry.second.min_seconds;
+        stats["max_seconds"] = entry.second.max_seconds;
+        phases[py::str(entry.first)] = stats;
+    }
+
+    py::dict counters;
+    for (auto& entry : registry.get_counters()) {
+        counters[py::str(entry.first)] = entry.second;
+    }
+
+    py::dict hardware;
+    for (auto& entry : registry.get_hardware_counts()) {
+        const HardwareCounts& counts = entry.second;
+        py::dict stats;
+        stats["cycles"] = counts.cycles;
+        stats["instructions"] = counts.instructions;
+        stats["cache_misses"] = counts.cache_misses;
+        stats["branch_misses"] = counts.branch_misses;
+        stats["ipc"] = (counts.cycles > 0) ? (double)counts.instructions / counts.cycles : 0.0;
+        hardware[py::str(entry.first)] = stats;
+    }
+
+    py::dict report;
+    report["phases"] = phases;
+    report["counters"] = counters;
+    report["hardware"] = hardware;
+    return report;
+}
+
+static void instrumentation_bindings(py::module& m) {
+    using inst = search::Instrumentation;
+    using st = search::ScopedTimer;
+
+    py::class_<inst, std::unique_ptr<inst, py::nodelete>>(m, "Instrumentation", pydocs::DOC_Instrumentation)
+            .def_static("is_enabled", &inst::is_enabled, pydocs::DOC_Instrumentation_is_enabled)
+            .def_static("set_enabled", &inst::set_enabled, pydocs::DOC_Instrumentation_set_enabled)
+            .def_static(
+                    "reset", []() { inst::instance().reset(); }, pydocs::DOC_Instrumentation_reset)
+            .def_static(
+                    "add_counter", [](const std::string& name, uint64_t value) { add_counter(name, value); },
+                    pydocs::DOC_Instrumentation_add_counter)
+            .def_static("get_report", &instrumentation_report, pydocs::DOC_Instrumentation_get_report)
+            .def_static("is_tracing", &inst::is_tracing, pydocs::DOC_Instrumentation_is_tracing)
+            .def_static(
+                    "set_tracing", [](bool tracing) { inst::instance().set_tracing(tracing); },
+                    pydocs::DOC_Instrumentation_set_tracing)
+            .def_static(
+                    "num_trace_events", []() { return inst::instance().num_trace_events(); },
+                    pydocs::DOC_Instrumentation_num_trace_events)
+            .def_static(
+                    "write_trace",
+                    [](const std::string& filename) { inst::instance().write_trace(filename); },
+                    pydocs::DOC_Instrumentation_write_trace)
+            .def_static(
+                    "to_string", []() { return inst::instance().to_string(); },
+                    pydocs::DOC_Instrumentation_to_string);
+
+    py::class_<st>(m, "ScopedTimer", pydocs::DOC_ScopedTimer)
+            .def(py::init<const std::string&, const std::string&>(), py::arg("name"), py::arg("parent") = "")
+            .def("stop", &st::stop, pydocs::DOC_ScopedTimer_stop)
+            .def("read", &st::read, pydocs::DOC_ScopedTimer_read)
+            .def_property_readonly("path", &st::get_path)
+            .def("__enter__", [](st& self) -> st& { return self; }, py::return_value_policy::reference)
+            .def("__exit__", [](st& self, py::args) { self.stop(); });
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
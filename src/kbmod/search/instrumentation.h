@@ -0,0 +1,197 @@
+/*
+ * instrumentation.h
+ *
+ * A low overhead registry of phase timings and counters. Timings use
+ * steady_clock and are organized by nested phase names ("search/psi_phi")
+ * built from the scoped timers that are active on each thread. Each thread
+ * accumulates into its own storage so the hot paths never contend on a shared
+ * lock; the per-thread data is only merged when a report is requested.
+ *
+ * Unlike DebugTimer, which only logs, the registry is meant to be queried at
+ * the end of a run to record where the time went. When tracing is turned on,
+ * every timed phase is also kept as an event on its thread's timeline and can
+ * be written as a Chrome Trace Event file (viewable in Perfetto).
+ *
+ * Created on: October 17, 2026
+ */
+
+#ifndef INSTRUMENTATION_H_
+#define INSTRUMENTATION_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pydocs/instrumentation_docs.h"
+
+namespace search {
+
+struct PhaseStats {
+    uint64_t calls = 0;
+    double total_seconds = 0.0;
+    double min_seconds = std::numeric_limits<double>::infinity();
+    double max_seconds = 0.0;
+
+    void add(double seconds) {
+        calls += 1;
+        total_seconds += seconds;
+        if (seconds < min_seconds) min_seconds = seconds;
+        if (seconds > max_seconds) max_seconds = seconds;
+    }
+
+    void merge(const PhaseStats& other) {
+        calls += other.calls;
+        total_seconds += other.total_seconds;
+        if (other.min_seconds < min_seconds) min_seconds = other.min_seconds;
+        if (other.max_seconds > max_seconds) max_seconds = other.max_seconds;
+    }
+};
+
+// Hardware event counts of a phase (see perf_counters.h).
+struct HardwareCounts {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+    uint64_t branch_misses = 0;
+
+    void merge(const HardwareCounts& other) {
+        cycles += other.cycles;
+        instructions += other.instructions;
+        cache_misses += other.cache_misses;
+        branch_misses += other.branch_misses;
+    }
+};
+
+// A completed phase on a thread's timeline. Times are in microseconds since the
+// start of the trace.
+struct TraceEvent {
+    std::string name;
+    std::string path;
+    double start_us;
+    double duration_us;
+};
+
+class Instrumentation {
+public:
+    static Instrumentation& instance();
+
+    // A single relaxed load, so disabled instrumentation costs almost nothing.
+    static bool is_enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enabled) { enabled_flag.store(enabled, std::memory_order_relaxed); }
+
+    // Tracing only records events while the instrumentation is also enabled.
+    static bool is_tracing() { return tracing_flag.load(std::memory_order_relaxed); }
+    void set_tracing(bool tracing);
+
+    // Clear all the accumulated timings, counters and trace events (on every thread),
+    // the calling thread's active phases, and restart the trace clock.
+    void reset();
+
+    // Record the duration of a (fully qualified) phase on the calling thread.
+    void add_phase_time(const std::string& path, double seconds);
+
+    // Add to a named counter on the calling thread.
+    void add_counter(const std::string& name, uint64_t value);
+
+    // Add the hardware event counts of a phase on the calling thread.
+    void add_hardware_counts(const std::string& path, const HardwareCounts& counts);
+
+    // Record a trace event on the calling thread's timeline.
+    void add_trace_event(const std::string& name, const std::string& path,
+                         std::chrono::steady_clock::time_point t_start,
+                         std::chrono::steady_clock::time_point t_end);
+
+    // Push a phase onto the calling thread's stack and return its full path. Threads
+    // with no active phase (such as OpenMP workers) nest it under parent instead.
+    std::string push_phase(const std::string& name, const std::string& parent = "");
+
+    // Remove the innermost entry of path from the calling thread's stack (if any).
+    void pop_phase(const std::string& path);
+
+    // The full path of the calling thread's innermost active phase ("" if none).
+    std::string current_phase();
+
+    // Merge the data from all threads.
+    std::map<std::string, PhaseStats> get_phases();
+    std::map<std::string, uint64_t> get_counters();
+    std::map<std::string, HardwareCounts> get_hardware_counts();
+    std::string to_string();
+
+    // The number of trace events recorded on all threads.
+    size_t num_trace_events();
+
+    // Write all the trace events to a Chrome Trace Event JSON file.
+    void write_trace(const std::string& filename);
+
+private:
+    Instrumentation() : trace_epoch(std::chrono::steady_clock::now()) {}
+
+    struct ThreadData {
+        std::mutex lock;  // Only contended while a report is being merged.
+        int thread_id = 0;
+        std::unordered_map<std::string, PhaseStats> phases;
+        std::unordered_map<std::string, uint64_t> counters;
+        std::unordered_map<std::string, HardwareCounts> hardware;
+        std::vector<std::string> phase_stack;
+        std::vector<TraceEvent> events;
+    };
+
+    ThreadData& local_data();
+
+    static std::atomic<bool> enabled_flag;
+    static std::atomic<bool> tracing_flag;
+
+    std::mutex registry_lock;
+    std::vector<std::shared_ptr<ThreadData>> thread_data;
+    std::chrono::steady_clock::time_point trace_epoch;
+};
+
+// Add to a counter if the instrumentation is enabled. Hot loops should accumulate
+// locally and call this once per chunk of work.
+inline void add_counter(const std::string& name, uint64_t value) {
+    if (Instrumentation::is_enabled()) Instrumentation::instance().add_counter(name, value);
+}
+
+// Times the enclosing scope as a phase nested under any phases already active on
+// the same thread. Work inside a parallel region can pass the enclosing phase
+// (from current_phase()) as the parent so it is reported under it. Does nothing
+// when the instrumentation is disabled.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const std::string& name, const std::string& parent = "");
+    ~ScopedTimer() { stop(); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    // Stop the timer and record its duration (only the first call has an effect).
+    void stop();
+
+    // The elapsed time in seconds (up to the stop if the timer is stopped).
+    double read() const;
+
+    const std::string& get_path() const { return path_; }
+
+private:
+    bool active_;
+    bool tracing_;
+    bool running_;
+    std::string name_;
+    std::string path_;
+    std::chrono::steady_clock::time_point t_start_;
+    std::chrono::steady_clock::time_point t_end_;
+};
+
+} /* namespace search */
+
+#endif /* INSTRUMENTATION_H_ */
@@ -19,18 +19,45 @@ LayeredImage::LayeredImage(const RawImage& sci, const RawImage& var, const RawIm
     variance = var;
 }
 
+LayeredImage::LayeredImage(Image& sci, Image& var, Image& msk, const PSF& psf, double obs_time)
+        : psf(psf) {
+    width = sci.cols();
+    height = sci.rows();
+    if (var.cols() != sci.cols() or var.rows() != sci.rows())
+        throw std::runtime_error("Science and Variance layers are not the same size.");
+    if (msk.cols() != sci.cols() or msk.rows() != sci.rows())
+        throw std::runtime_error("Science and Mask layers are not the same size.");
+
+    // Move the pixel data into the layers without copying.
+    science = RawImage(sci, obs_time);
+    variance = RawImage(var, obs_time);
+    mask = RawImage(msk, obs_time);
+}
+
 void LayeredImage::set_psf(const PSF& new_psf) { psf = new_psf; }
 
+void LayeredImage::set_psf_grid(const PSFGrid& grid) {
+    if (grid.get_width() != (int)width || grid.get_height() != (int)height) {
+        throw std::runtime_error("PSF grid size does not match the image size.");
+    }
+    psf_grid = grid;
+}
+
 void LayeredImage::convolve_given_psf(const PSF& given_psf) {
     science.convolve(given_psf);
 
-    // Square the PSF use that on the variance image.
-    PSF psfsq = PSF(given_psf);  // Copy
-    psfsq.square_psf();
-    variance.convolve(psfsq);
+    // Use the squared PSF on the variance image.
+    variance.convolve_squared(given_psf);
 }
 
-void LayeredImage::convolve_psf() { convolve_given_psf(psf); }
+void LayeredImage::convolve_psf() {
+    if (has_psf_grid()) {
+        science.convolve_psf_grid(psf_grid);
+        variance.convolve_psf_grid_squared(psf_grid);
+    } else {
+        convolve_given_psf(psf);
+    }
+}
 
 void LayeredImage::mask_pixel(const Index& idx) {
     science.mask_pixel(idx);
@@ -151,6 +178,26 @@ void LayeredImage::check_dims(RawImage& im) {
 }
 
 RawImage LayeredImage::generate_psi_image() {
+    RawImage result = generate_unconvolved_psi_image();
+    if (has_psf_grid()) {
+        result.convolve_psf_grid(psf_grid);
+    } else {
+        result.convolve(psf);
+    }
+    return result;
+}
+
+RawImage LayeredImage::generate_phi_image() {
+    RawImage result = generate_unconvolved_phi_image();
+    if (has_psf_grid()) {
+        result.convolve_psf_grid_squared(psf_grid);
+    } else {
+        result.convolve_squared(psf);
+    }
+    return result;
+}
+
+RawImage LayeredImage::generate_unconvolved_psi_image() {
     RawImage result(width, height);
     float* result_arr = result.data();
     float* sci_array = science.data();
@@ -166,14 +213,10 @@ RawImage LayeredImage::generate_psi_image() {
             result_arr[p] = NO_DATA;
         }
     }
-
-    // Convolve with the PSF.
-    result.convolve(psf);
-
     return result;
 }
 
-RawImage LayeredImage::generate_phi_image() {
+RawImage LayeredImage::generate_unconvolved_phi_image() {
     RawImage result(width, height);
     float* result_arr = result.data();
     float* var_array = variance.data();
@@ -188,12 +231,6 @@ RawImage LayeredImage::generate_phi_image() {
             result_arr[p] = NO_DATA;
         }
     }
-
-    // Convolve with the PSF squared.
-    PSF psfsq = PSF(psf);  // Copy
-    psfsq.square_psf();
-    result.convolve(psfsq);
-
     return result;
 }
 
@@ -205,6 +242,8 @@ static void layered_image_bindings(py::module& m) {
 
     py::class_<li>(m, "LayeredImage", pydocs::DOC_LayeredImage)
             .def(py::init<const ri&, const ri&, const ri&, pf&>())
+            .def(py::init<search::Image&, search::Image&, search::Image&, pf&, double>(), py::arg("sci"),
+                 py::arg("var"), py::arg("msk"), py::arg("psf"), py::arg("obs_time") = -1.0)
             .def("contains", &li::contains, pydocs::DOC_LayeredImage_cointains)
             .def("get_science_pixel", &li::get_science_pixel, pydocs::DOC_LayeredImage_get_science_pixel)
             .def("get_variance_pixel", &li::get_variance_pixel, pydocs::DOC_LayeredImage_get_variance_pixel)
@@ -223,6 +262,11 @@ static void layered_image_bindings(py::module& m) {
             .def("set_psf", &li::set_psf, pydocs::DOC_LayeredImage_set_psf)
             .def("get_psf", &li::get_psf, py::return_value_policy::reference_internal,
                  pydocs::DOC_LayeredImage_get_psf)
+            .def("set_psf_grid", &li::set_psf_grid, pydocs::DOC_LayeredImage_set_psf_grid)
+            .def("get_psf_grid", &li::get_psf_grid, py::return_value_policy::reference_internal,
+                 pydocs::DOC_LayeredImage_get_psf_grid)
+            .def("has_psf_grid", &li::has_psf_grid, pydocs::DOC_LayeredImage_has_psf_grid)
+            .def("clear_psf_grid", &li::clear_psf_grid, pydocs::DOC_LayeredImage_clear_psf_grid)
             .def("mask_pixel", &li::mask_pixel, pydocs::DOC_LayeredImage_mask_pixel)
             .def("mask_pixel",
                  [](li& cls, int i, int j) {
@@ -16,10 +16,22 @@ class LayeredImage {
 public:
     explicit LayeredImage(const RawImage& sci, const RawImage& var, const RawImage& msk, const PSF& psf);
 
+    // Build the layers directly from pixel arrays. The arrays are moved into
+    // the layers, so the caller's arrays are left empty.
+    explicit LayeredImage(Image& sci, Image& var, Image& msk, const PSF& psf, double obs_time = -1.0);
+
     // Set an image specific point spread function.
     void set_psf(const PSF& psf);
     const PSF& get_psf() const { return psf; }
 
+    // Set a spatially varying PSF, used instead of the single PSF by
+    // convolve_psf() and the psi and phi images. The grid must have the size
+    // of the image.
+    void set_psf_grid(const PSFGrid& grid);
+    const PSFGrid& get_psf_grid() const { return psf_grid; }
+    bool has_psf_grid() const { return !psf_grid.empty(); }
+    void clear_psf_grid() { psf_grid = PSFGrid(); }
+
     // Basic getter functions for image data.
     unsigned get_width() const { return width; }
     unsigned get_height() const { return height; }
@@ -64,7 +76,7 @@ public:
     void set_mask(RawImage& im);
     void set_variance(RawImage& im);
 
-    // Convolve with a given PSF or the default one.
+    // Convolve with a given PSF or the default one (the PSF grid if there is one).
     void convolve_psf();
     void convolve_given_psf(const PSF& psf);
 
@@ -74,12 +86,18 @@ public:
     RawImage generate_psi_image();
     RawImage generate_phi_image();
 
+    // The psi (science / variance) and phi (1 / variance) planes before the
+    // convolution, so they can be convolved with several PSFs.
+    RawImage generate_unconvolved_psi_image();
+    RawImage generate_unconvolved_phi_image();
+
 private:
     void check_dims(RawImage& im);
     unsigned width;
     unsigned height;
 
     PSF psf;
+    PSFGrid psf_grid;
     RawImage science;
     RawImage mask;
     RawImage variance;
@@ -1,14 +1,22 @@
 #ifndef KBMOD_LOGGER
 #define KBMOD_LOGGER
 
+#include <atomic>
+#include <chrono>
+#include <ctime>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <sstream>
-#include <regex>
+#include <thread>
 #include <unordered_map>
 #include <string>
 #include <vector>
 
+#ifdef __unix__
+#include <pthread.h>
+#endif
+
 /*
  * The Logging class is a singleton that keeps a reference to all created
  * Loggers. The Loggers define the log format and IO method (stdout, file etc.).
@@ -26,6 +34,15 @@
  * these Python-side Loggers are not registered in the Logging's registry the
  * KBMOD Logging will default to using the C++ std::out logger. This can lead to
  * differing output formats if the Python Logger in question is re-configured.
+ *
+ * Hot code should log through the LOG_DEBUG/LOG_INFO/... macros, which check
+ * the level before the message expression is evaluated, so a filtered message
+ * costs one comparison. Messages can also be handed to an AsyncLogSink, which
+ * writes them from a background thread once Logging::set_async enables it.
+ * Threads that do not hold the Python GIL cannot write to a Python-side logger
+ * and always hand their messages to the sink, starting its thread on first use.
+ * Only those messages go through it while async logging is off: every other
+ * message is still written directly.
  */
 namespace logging {
 // Python's dict[str: str]-like typedef for readability
@@ -49,6 +66,206 @@ static std::unordered_map<LogLevel, std::string> LogLevelToString{{LogLevel::DEB
                                                                   {LogLevel::ERROR, "ERROR"},
                                                                   {LogLevel::CRITICAL, "CRITICAL"}};
 
+// The name of a level without a map lookup (levels between the named ones use
+// the name below them, as Python's would be custom).
+inline const char* level_name(LogLevel level) {
+    if (level >= LogLevel::CRITICAL) return "CRITICAL";
+    if (level >= LogLevel::ERROR) return "ERROR";
+    if (level >= LogLevel::WARNING) return "WARNING";
+    if (level >= LogLevel::INFO) return "INFO";
+    return "DEBUG";
+}
+
+inline LogLevel level_from_string(const std::string& level) {
+    auto it = StringToLogLevel.find(level);
+    return (it == StringToLogLevel.end()) ? LogLevel::WARNING : it->second;
+}
+
+class Logger;
+
+// A log message waiting to be written by the asynchronous sink.
+struct LogRecord {
+    Logger* logger = nullptr;
+    LogLevel level = LogLevel::DEBUG;
+    std::time_t time = 0;
+    std::string message;
+};
+
+// A bounded lock-free queue for many producers and one consumer (after Dmitry
+// Vyukov's bounded MPMC queue). Each slot carries a sequence number that tells
+// producers and the consumer whose turn it is, so pushing is one CAS on the
+// tail and never waits.
+class LogRingBuffer {
+public:
+    explicit LogRingBuffer(size_t min_capacity) {
+        size_t capacity = 2;
+        while (capacity < min_capacity) capacity *= 2;
+        mask = capacity - 1;
+        slots.reset(new Slot[capacity]);
+        for (size_t i = 0; i < capacity; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    // Returns false (and leaves the record) if the buffer is full.
+    bool push(LogRecord& record) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Only called from the consumer thread.
+    bool pop(LogRecord& record) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[pos & mask];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return false;
+
+        record = std::move(slot.record);
+        head.store(pos + 1, std::memory_order_relaxed);
+        slot.sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+// Writes log messages from a background thread. Producers never block: when
+// the buffer is full the message is written synchronously if the logger
+// allows it, and dropped (and counted) otherwise. The consumer polls with a
+// short sleep so producers need no locks or notifications.
+class AsyncLogSink {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 8192;
+
+    static AsyncLogSink& instance() {
+        static AsyncLogSink sink;
+        return sink;
+    }
+
+    bool is_running() const { return running.load(std::memory_order_acquire); }
+
+    // Whether all messages go through the sink (see Logging::set_async), rather
+    // than only those from threads that cannot write directly.
+    bool is_enabled() const { return enabled.load(std::memory_order_acquire); }
+    void set_enabled(bool enable) {
+        enabled.store(enable, std::memory_order_release);
+        if (enable) {
+            start();
+        } else {
+            stop();
+        }
+    }
+
+    // Start the background thread (if it is not running).
+    void start() {
+        if (running.exchange(true)) return;
+        stopping.store(false);
+        worker = std::thread(&AsyncLogSink::run, this);
+    }
+
+    // Write everything queued and stop the background thread. With a Python
+    // logger the GIL must not be held, or the remaining messages cannot be written.
+    void stop() {
+        if (!running.load()) return;
+        stopping.store(true);
+        if (worker.joinable()) worker.join();
+        running.store(false);
+    }
+
+    // Queue a message. Returns false if the buffer is full.
+    bool submit(Logger* logger, LogLevel level, const std::string& message) {
+        LogRecord record{logger, level, std::time(nullptr), message};
+        return buffer.push(record);
+    }
+
+    // The messages that could neither be queued nor written directly.
+    void count_dropped() { num_dropped.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t get_num_dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+
+    ~AsyncLogSink() { stop(); }
+
+private:
+    AsyncLogSink()
+            : buffer(DEFAULT_CAPACITY), enabled(false), running(false), stopping(false), num_dropped(0) {
+#ifdef __unix__
+        // The background thread does not survive a fork.
+        pthread_atfork(nullptr, nullptr, []() {
+            AsyncLogSink& sink = instance();
+            new (&sink.worker) std::thread();
+            sink.enabled.store(false);
+            sink.running.store(false);
+        });
+#endif
+    }
+
+    inline void run();
+
+    LogRingBuffer buffer;
+    std::thread worker;
+    std::atomic<bool> enabled;
+    std::atomic<bool> running;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> num_dropped;
+};
+
+// A log format split once into literal text and fields, so formatting a
+// message is a few appends instead of a regex pass per field.
+class LogFormat {
+public:
+    enum Field { LITERAL, ASCTIME, LEVELNAME, NAME, MESSAGE };
+
+    LogFormat() {}
+    explicit LogFormat(const std::string& format) {
+        static const std::vector<std::pair<std::string, Field>> fields = {{"%(asctime)s", ASCTIME},
+                                                                          {"%(levelname)s", LEVELNAME},
+                                                                          {"%(name)s", NAME},
+                                                                          {"%(message)s", MESSAGE}};
+        std::string literal;
+        size_t pos = 0;
+        while (pos < format.size()) {
+            bool matched = false;
+            for (auto& [text, field] : fields) {
+                if (format.compare(pos, text.size(), text) == 0) {
+                    if (!literal.empty()) parts.push_back({LITERAL, literal});
+                    literal.clear();
+                    parts.push_back({field, ""});
+                    pos += text.size();
+                    matched = true;
+                    break;
+                }
+            }
+            if (!matched) literal += format[pos++];
+        }
+        if (!literal.empty()) parts.push_back({LITERAL, literal});
+    }
+
+    std::vector<std::pair<Field, std::string>> parts;
+};
+
 // Logger is a base class that dispatches the logging mechanism (IO mostly)
 // It wraps convenience methods and other shared functionality, such as
 // string formatters, commonly used by child Loggers. Expects the following
@@ -72,77 +289,182 @@ public:
     Logger(const std::string logger_name) : name(logger_name), config(), level_threshold{LogLevel::WARNING} {}
 
     Logger(const std::string logger_name, const sdict conf) : name(logger_name), config(conf) {
-        level_threshold = StringToLogLevel[config["level"]];
+        level_threshold = level_from_string(config["level"]);
+        format = LogFormat(config["format"]);
+        use_gmtime = (config["converter"] == "gmtime");
+        datefmt = config["datefmt"];
     }
 
     virtual ~Logger() {}
 
-    std::string fmt_time() {
-        std::time_t now = std::time(nullptr);
-        std::tm timeinfo;
+    // Whether a message at this level would be written. Check this (or use the
+    // LOG_* macros) before building a message.
+    virtual bool is_enabled_for(LogLevel level) { return level >= level_threshold; }
 
-        if (config["converter"] == "gmtime") {
-            timeinfo = *std::gmtime(&now);
+    std::string fmt_time(std::time_t when = std::time(nullptr)) {
+        // The timestamp only changes once a second, so reuse the last one.
+        thread_local std::time_t cached_time = -1;
+        thread_local const Logger* cached_logger = nullptr;
+        thread_local std::string cached_text;
+        if (when == cached_time && cached_logger == this) return cached_text;
+
+        std::tm timeinfo;
+        if (use_gmtime) {
+            gmtime_r(&when, &timeinfo);
         } else {
-            timeinfo = *std::localtime(&now);
+            localtime_r(&when, &timeinfo);
         }
 
-        std::ostringstream timestamp;
-        timestamp << std::put_time(&timeinfo, config["datefmt"].c_str());
-        return timestamp.str();
+        char buffer[128];
+        size_t length = std::strftime(buffer, sizeof(buffer), datefmt.c_str(), &timeinfo);
+        cached_text.assign(buffer, length);
+        cached_time = when;
+        cached_logger = this;
+        return cached_text;
     }
 
-    std::string fmt_log(const std::string level, const std::string msg) {
-        std::string logfmt = config["format"];
-
-        std::regex t("%\\(asctime\\)s");
-        logfmt = std::regex_replace(logfmt, t, fmt_time());
+    std::string fmt_log(const std::string& level, const std::string& msg,
+                        std::time_t when = std::time(nullptr)) {
+        std::string result;
+        result.reserve(msg.size() + 64);
+        for (auto& [field, text] : format.parts) {
+            switch (field) {
+                case LogFormat::LITERAL:
+                    result += text;
+                    break;
+                case LogFormat::ASCTIME:
+                    result += fmt_time(when);
+                    break;
+                case LogFormat::LEVELNAME:
+                    result += level;
+                    break;
+                case LogFormat::NAME:
+                    result += name;
+                    break;
+                case LogFormat::MESSAGE:
+                    result += msg;
+                    break;
+            }
+        }
+        return result;
+    }
 
-        std::regex l("%\\(levelname\\)s");
-        logfmt = std::regex_replace(logfmt, l, level);
+    // Log a message, through the asynchronous sink when it is enabled or when
+    // the calling thread cannot write to this logger directly.
+    void log(LogLevel level, const std::string& msg) {
+        if (is_enabled_for(level)) emit(level, msg);
+    }
+    void log(const std::string& level, const std::string& msg) { log(level_from_string(level), msg); }
+
+    // Log a message without checking the level (the caller already has).
+    void emit(LogLevel level, const std::string& msg) {
+        AsyncLogSink& sink = AsyncLogSink::instance();
+        if (must_defer()) {
+            // The sink's thread is started for these messages even when async
+            // logging is off, which leaves the other messages written directly.
+            sink.start();
+            if (!sink.submit(this, level, msg)) sink.count_dropped();
+            return;
+        }
+        if (sink.is_enabled() && sink.is_running() && sink.submit(this, level, msg)) return;
+        write(level, std::time(nullptr), msg);
+    }
 
-        std::regex n("%\\(name\\)s");
-        logfmt = std::regex_replace(logfmt, n, name);
+    void debug(const std::string& msg) { log(LogLevel::DEBUG, msg); }
+    void info(const std::string& msg) { log(LogLevel::INFO, msg); }
+    void warning(const std::string& msg) { log(LogLevel::WARNING, msg); }
+    void error(const std::string& msg) { log(LogLevel::ERROR, msg); }
+    void critical(const std::string& msg) { log(LogLevel::CRITICAL, msg); }
 
-        std::regex m("%\\(message\\)s");
-        logfmt = std::regex_replace(logfmt, m, msg);
+    // Write one message now. Called by log() or by the sink's thread.
+    virtual void write(LogLevel level, std::time_t when, const std::string& msg) = 0;
 
-        return logfmt;
-    }
+protected:
+    // Whether the calling thread has to hand its messages to the sink.
+    virtual bool must_defer() { return false; }
 
-    virtual void log(std::string level, std::string msg) = 0;
-    void debug(std::string msg) { log("DEBUG", msg); }
-    void info(std::string msg) { log("INFO", msg); }
-    void warning(std::string msg) { log("WARNING", msg); }
-    void error(std::string msg) { log("ERROR", msg); }
-    void critical(std::string msg) { log("CRITICAL", msg); }
+    LogFormat format;
+    bool use_gmtime = false;
+    std::string datefmt;
 };
 
+void AsyncLogSink::run() {
+    LogRecord record;
+    while (true) {
+        bool wrote = false;
+        while (buffer.pop(record)) {
+            record.logger->write(record.level, record.time, record.message);
+            wrote = true;
+        }
+        if (!wrote) {
+            if (stopping.load()) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
 // Glorified std::cout.
 class CoutLogger : public Logger {
 public:
     CoutLogger(std::string name, sdict config) : Logger(name, config) {}
 
-    virtual void log(const std::string level, const std::string msg) {
-        if (level_threshold <= StringToLogLevel[level]) std::cout << fmt_log(level, msg) << std::endl;
+    virtual void write(LogLevel level, std::time_t when, const std::string& msg) {
+        std::cout << fmt_log(level_name(level), msg, when) << std::endl;
     }
 };
 
+// Log a message only if the logger would write it. The message expression is
+// not evaluated otherwise, e.g. LOG_DEBUG(logger, "Found " + std::to_string(n)).
+#define LOG_AT_LEVEL(logger, level, msg)                                         \
+    do {                                                                         \
+        logging::Logger* log_target_ = (logger);                                 \
+        if (log_target_->is_enabled_for(level)) log_target_->emit(level, (msg)); \
+    } while (0)
+#define LOG_DEBUG(logger, msg) LOG_AT_LEVEL(logger, logging::LogLevel::DEBUG, msg)
+#define LOG_INFO(logger, msg) LOG_AT_LEVEL(logger, logging::LogLevel::INFO, msg)
+#define LOG_WARNING(logger, msg) LOG_AT_LEVEL(logger, logging::LogLevel::WARNING, msg)
+#define LOG_ERROR(logger, msg) LOG_AT_LEVEL(logger, logging::LogLevel::ERROR, msg)
+
 // Wrapper around the Python-side loggers. Basically dispatches the logging
 // calls to the Python-side object. Does no formatting, IO, or other management
 // except to ensure the message is dispatched to the correct in-Python method.
 #ifdef Py_PYTHON_H
 class PyLogger : public Logger {
 private:
+    // How often the cached level is read back from Python.
+    static constexpr std::chrono::steady_clock::duration LEVEL_REFRESH = std::chrono::seconds(1);
+
     py::object pylogger;
+    std::atomic<int> effective_level;
+    std::atomic<int64_t> next_refresh;  // steady_clock ticks, 0 to refresh at the next check.
 
 public:
-    PyLogger(py::object logger) : Logger(logger.attr("name").cast<std::string>()), pylogger(logger) {}
+    PyLogger(py::object logger)
+            : Logger(logger.attr("name").cast<std::string>()),
+              pylogger(logger),
+              effective_level(logger.attr("getEffectiveLevel")().cast<int>()),
+              next_refresh(0) {}
+
+    // Python's level can change at any time, but asking Python costs far more
+    // than the check itself. So the level is read back on the first check made
+    // with the GIL and then at most once every LEVEL_REFRESH. Other threads use
+    // the last level seen.
+    virtual bool is_enabled_for(LogLevel level) {
+        const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        if (now >= next_refresh.load(std::memory_order_relaxed) && PyGILState_Check()) {
+            effective_level = pylogger.attr("getEffectiveLevel")().cast<int>();
+            next_refresh.store(now + LEVEL_REFRESH.count(), std::memory_order_relaxed);
+        }
+        return level >= effective_level;
+    }
 
-    virtual void log(std::string level, const std::string msg) {
-        for (char& ch : level) ch = std::tolower(ch);
-        pylogger.attr(level.c_str())(msg);
+    virtual void write(LogLevel level, std::time_t when, const std::string& msg) {
+        py::gil_scoped_acquire gil;
+        pylogger.attr("log")((int)level, msg);
     }
+
+protected:
+    virtual bool must_defer() { return !PyGILState_Check(); }
 };
 #endif  // Py_PYTHON_H
 
@@ -212,6 +534,11 @@ public:
     }
 
     void register_logger(Logger* logger) { Logging::logging()->registry[logger->name] = logger; }
+
+    // Write the C++ log messages from a background thread (or stop doing so,
+    // after writing the queued messages).
+    static void set_async(bool enabled) { AsyncLogSink::instance().set_enabled(enabled); }
+    static bool get_async() { return AsyncLogSink::instance().is_enabled(); }
 };
 
 // Convenience method to shorten the very long signature required to invoke
@@ -224,12 +551,32 @@ static void logging_bindings(py::module& m) {
     py::class_<Logging, std::unique_ptr<Logging, py::nodelete>>(m, "Logging")
             .def(py::init([]() { return std::unique_ptr<Logging, py::nodelete>(Logging::logging()); }))
             .def("setConfig", &Logging::setConfig)
+            .def_static(
+                    "set_async",
+                    [](bool enabled) {
+                        // The sink's thread needs the GIL to write to Python loggers.
+                        py::gil_scoped_release release;
+                        Logging::set_async(enabled);
+                    },
+                    "Write the C++ log messages from a background thread, or stop doing so after "
+                    "writing the queued messages.")
+            .def_static("get_async", &Logging::get_async,
+                        "Whether the C++ log messages are written from a background thread.")
+            .def_static(
+                    "get_num_dropped", []() { return AsyncLogSink::instance().get_num_dropped(); },
+                    "The number of C++ log messages that did not fit in the background writer's buffer.")
             .def_static("getLogger", [](py::str name) -> py::object {
                 py::module_ logging = py::module_::import("logging");
                 py::object pylogger = logging.attr("getLogger")(name);
                 Logging::logging()->register_logger(new PyLogger(pylogger));
                 return pylogger;
             });
+
+    // Write any queued messages while the interpreter can still take them.
+    py::module_::import("atexit").attr("register")(py::cpp_function([]() {
+        py::gil_scoped_release release;
+        AsyncLogSink::instance().stop();
+    }));
 }
 #endif /* Py_PYTHON_H */
 }  // namespace logging
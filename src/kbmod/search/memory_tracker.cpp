@@ -0,0 +1,227 @@
+#include "memory_tracker.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace search {
+
+std::array<std::atomic<uint64_t>, MEM_NUM_CATEGORIES> MemoryTracker::current_bytes = {};
+std::array<std::atomic<uint64_t>, MEM_NUM_CATEGORIES> MemoryTracker::peak_bytes = {};
+
+std::mutex MemoryTracker::stage_lock;
+std::vector<MemoryTracker::Stage> MemoryTracker::active_stages;
+std::map<std::string, uint64_t> MemoryTracker::stage_peaks;
+
+void MemoryTracker::allocate(MemoryCategory category, uint64_t bytes) {
+    if (bytes == 0) return;
+    uint64_t now = current_bytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    uint64_t peak = peak_bytes[category].load(std::memory_order_relaxed);
+    while (now > peak && !peak_bytes[category].compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryTracker::release(MemoryCategory category, uint64_t bytes) {
+    if (bytes == 0) return;
+    current_bytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+uint64_t MemoryTracker::get_current_bytes(MemoryCategory category) {
+    return current_bytes[category].load(std::memory_order_relaxed);
+}
+
+uint64_t MemoryTracker::get_peak_bytes(MemoryCategory category) {
+    return peak_bytes[category].load(std::memory_order_relaxed);
+}
+
+std::string MemoryTracker::category_name(MemoryCategory category) {
+    switch (category) {
+        case MEM_RAW_IMAGE:
+            return "raw_image";
+        case MEM_PSI_PHI:
+            return "psi_phi";
+        case MEM_TRAJECTORY_LIST:
+            return "trajectory_list";
+        case MEM_STAMPS:
+            return "stamps";
+        case MEM_ARENA:
+            return "arena";
+        default:
+            throw std::runtime_error("Invalid memory category.");
+    }
+}
+
+std::map<std::string, MemoryUsage> MemoryTracker::get_usage() {
+    std::map<std::string, MemoryUsage> usage;
+    for (int i = 0; i < MEM_NUM_CATEGORIES; ++i) {
+        MemoryCategory category = static_cast<MemoryCategory>(i);
+        usage[category_name(category)] = {get_current_bytes(category), get_peak_bytes(category)};
+    }
+    return usage;
+}
+
+void MemoryTracker::reset() {
+    for (int i = 0; i < MEM_NUM_CATEGORIES; ++i) {
+        peak_bytes[i].store(current_bytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> guard(stage_lock);
+    active_stages.clear();
+    stage_peaks.clear();
+}
+
+// Read a "<key>: <value> kB" entry from /proc/self/status.
+static uint64_t read_proc_status_bytes(const std::string& key) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':') {
+            return std::stoull(line.substr(key.size() + 1)) * 1024;
+        }
+    }
+    return 0;
+}
+
+uint64_t MemoryTracker::get_rss_bytes() { return read_proc_status_bytes("VmRSS"); }
+
+uint64_t MemoryTracker::get_peak_rss_bytes() { return read_proc_status_bytes("VmHWM"); }
+
+bool MemoryTracker::reset_peak_rss() {
+    // Writing 5 to clear_refs resets VmHWM (Linux 4.0 and later).
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (!clear_refs) return false;
+    clear_refs << "5";
+    clear_refs.flush();
+    return clear_refs.good();
+}
+
+void MemoryTracker::begin_stage(const std::string& name) {
+    std::lock_guard<std::mutex> guard(stage_lock);
+
+    // Resetting the high-water mark would lose the enclosing stages' peaks, so
+    // fold it into them first.
+    uint64_t peak_rss = get_peak_rss_bytes();
+    for (auto& stage : active_stages) {
+        if (peak_rss > stage.peak_rss) stage.peak_rss = peak_rss;
+    }
+    reset_peak_rss();
+    active_stages.push_back({name, get_rss_bytes()});
+}
+
+void MemoryTracker::end_stage() {
+    std::lock_guard<std::mutex> guard(stage_lock);
+    if (active_stages.empty()) return;
+
+    uint64_t peak_rss = get_peak_rss_bytes();
+    for (auto& stage : active_stages) {
+        if (peak_rss > stage.peak_rss) stage.peak_rss = peak_rss;
+    }
+
+    const Stage& stage = active_stages.back();
+    uint64_t& recorded = stage_peaks[stage.name];
+    if (stage.peak_rss > recorded) recorded = stage.peak_rss;
+    active_stages.pop_back();
+}
+
+std::map<std::string, uint64_t> MemoryTracker::get_stage_peaks() {
+    std::lock_guard<std::mutex> guard(stage_lock);
+    return stage_peaks;
+}
+
+std::string MemoryTracker::to_string() {
+    constexpr double MB = 1024.0 * 1024.0;
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "Memory (MB): category [current, peak]\n";
+    for (auto& [name, usage] : get_usage()) {
+        ss << "  " << name << " [" << usage.current_bytes / MB << ", " << usage.peak_bytes / MB << "]\n";
+    }
+    ss << "RSS (MB): current " << get_rss_bytes() / MB << ", peak " << get_peak_rss_bytes() / MB << "\n";
+
+    auto stages = get_stage_peaks();
+    if (!stages.empty()) {
+        ss << "Peak RSS by stage (MB):\n";
+        for (auto& [name, bytes] : stages) ss << "  " << name << " " << bytes / MB << "\n";
+    }
+    return ss.str();
+}
+
+TrackedBytes& TrackedBytes::operator=(const TrackedBytes& other) {
+    if (this != &other) {
+        set_category(other.category_);
+        set(other.bytes_);
+    }
+    return *this;
+}
+
+TrackedBytes& TrackedBytes::operator=(TrackedBytes&& other) {
+    if (this != &other) {
+        MemoryTracker::release(category_, bytes_);
+        category_ = other.category_;
+        bytes_ = other.bytes_;
+        other.bytes_ = 0;
+    }
+    return *this;
+}
+
+void TrackedBytes::set(uint64_t bytes) {
+    if (bytes > bytes_) {
+        MemoryTracker::allocate(category_, bytes - bytes_);
+    } else {
+        MemoryTracker::release(category_, bytes_ - bytes);
+    }
+    bytes_ = bytes;
+}
+
+void TrackedBytes::set_category(MemoryCategory category) {
+    if (category == category_) return;
+    MemoryTracker::release(category_, bytes_);
+    category_ = category;
+    MemoryTracker::allocate(category_, bytes_);
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static void memory_tracker_bindings(py::module& m) {
+    using mt = search::MemoryTracker;
+    using ms = search::MemoryStage;
+
+    py::class_<mt>(m, "MemoryTracker", pydocs::DOC_MemoryTracker)
+            .def_static("reset", &mt::reset, pydocs::DOC_MemoryTracker_reset)
+            .def_static("get_rss_bytes", &mt::get_rss_bytes, pydocs::DOC_MemoryTracker_get_rss_bytes)
+            .def_static("get_peak_rss_bytes", &mt::get_peak_rss_bytes,
+                        pydocs::DOC_MemoryTracker_get_peak_rss_bytes)
+            .def_static(
+                    "get_report",
+                    []() {
+                        py::dict categories;
+                        for (auto& [name, usage] : mt::get_usage()) {
+                            py::dict entry;
+                            entry["current_bytes"] = usage.current_bytes;
+                            entry["peak_bytes"] = usage.peak_bytes;
+                            categories[py::str(name)] = entry;
+                        }
+
+                        py::dict report;
+                        report["categories"] = categories;
+                        report["stage_peak_rss_bytes"] = mt::get_stage_peaks();
+                        report["rss_bytes"] = mt::get_rss_bytes();
+                        report["peak_rss_bytes"] = mt::get_peak_rss_bytes();
+                        return report;
+                    },
+                    pydocs::DOC_MemoryTracker_get_report)
+            .def_static("to_string", &mt::to_string, pydocs::DOC_MemoryTracker_to_string);
+
+    py::class_<ms>(m, "MemoryStage", pydocs::DOC_MemoryStage)
+            .def(py::init<const std::string&>(), py::arg("name"))
+            .def("stop", &ms::stop, pydocs::DOC_MemoryStage_stop)
+            .def("__enter__", [](ms& self) -> ms& { return self; }, py::return_value_policy::reference)
+            .def("__exit__", [](ms& self, py::args) { self.stop(); });
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
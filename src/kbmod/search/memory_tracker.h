@@ -0,0 +1,141 @@
+/*
+ * memory_tracker.h
+ *
+ * Accounting of the memory held by the major data structures (the RawImage
+ * layers, the PsiPhiArray, the TrajectoryList, the stamp buffers and the
+ * per-thread scratch arenas). Each category keeps its current and peak number
+ * of bytes in relaxed atomics, so the accounting is always on and safe to
+ * update from any thread.
+ *
+ * The tracker also reads the process's resident set size (RSS) from /proc and
+ * records the RSS high-water mark of named pipeline stages. This gives a
+ * failed (out of memory) run a record of which structures and stages were
+ * holding the memory.
+ *
+ * Created on: October 17, 2026
+ */
+
+#ifndef MEMORY_TRACKER_H_
+#define MEMORY_TRACKER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "pydocs/memory_tracker_docs.h"
+
+namespace search {
+
+enum MemoryCategory {
+    MEM_RAW_IMAGE = 0,
+    MEM_PSI_PHI,
+    MEM_TRAJECTORY_LIST,
+    MEM_STAMPS,
+    MEM_ARENA,
+    MEM_NUM_CATEGORIES
+};
+
+struct MemoryUsage {
+    uint64_t current_bytes = 0;
+    uint64_t peak_bytes = 0;
+};
+
+class MemoryTracker {
+public:
+    static void allocate(MemoryCategory category, uint64_t bytes);
+    static void release(MemoryCategory category, uint64_t bytes);
+
+    static uint64_t get_current_bytes(MemoryCategory category);
+    static uint64_t get_peak_bytes(MemoryCategory category);
+    static std::string category_name(MemoryCategory category);
+
+    // The usage of every category by name.
+    static std::map<std::string, MemoryUsage> get_usage();
+
+    // Restart the peaks at the current usage and clear the stage data.
+    static void reset();
+
+    // The resident set size of the process and its high-water mark (in bytes).
+    // Both are 0 where /proc is unavailable.
+    static uint64_t get_rss_bytes();
+    static uint64_t get_peak_rss_bytes();
+
+    // Restart the RSS high-water mark at the current RSS. Returns false if the
+    // kernel does not support it (the mark then covers the whole run).
+    static bool reset_peak_rss();
+
+    // Track the RSS high-water mark of (possibly nested) stages. Called from the
+    // main thread only.
+    static void begin_stage(const std::string& name);
+    static void end_stage();
+    static std::map<std::string, uint64_t> get_stage_peaks();
+
+    static std::string to_string();
+
+private:
+    struct Stage {
+        std::string name;
+        uint64_t peak_rss = 0;
+    };
+
+    static std::array<std::atomic<uint64_t>, MEM_NUM_CATEGORIES> current_bytes;
+    static std::array<std::atomic<uint64_t>, MEM_NUM_CATEGORIES> peak_bytes;
+
+    static std::mutex stage_lock;
+    static std::vector<Stage> active_stages;
+    static std::map<std::string, uint64_t> stage_peaks;
+};
+
+// The bytes owned by one object in a memory category. Copies account for their
+// own bytes and moves transfer them, so the members of copyable classes can
+// hold one of these and call set() whenever the owned buffer changes size.
+class TrackedBytes {
+public:
+    explicit TrackedBytes(MemoryCategory category, uint64_t bytes = 0) : category_(category), bytes_(0) {
+        set(bytes);
+    }
+    TrackedBytes(const TrackedBytes& other) : TrackedBytes(other.category_, other.bytes_) {}
+    TrackedBytes(TrackedBytes&& other) : category_(other.category_), bytes_(other.bytes_) {
+        other.bytes_ = 0;
+    }
+    ~TrackedBytes() { MemoryTracker::release(category_, bytes_); }
+
+    TrackedBytes& operator=(const TrackedBytes& other);
+    TrackedBytes& operator=(TrackedBytes&& other);
+
+    void set(uint64_t bytes);
+    void set_category(MemoryCategory category);
+
+    MemoryCategory get_category() const { return category_; }
+    uint64_t get_bytes() const { return bytes_; }
+
+private:
+    MemoryCategory category_;
+    uint64_t bytes_;
+};
+
+// Records the RSS high-water mark of the enclosing scope as a named stage.
+class MemoryStage {
+public:
+    explicit MemoryStage(const std::string& name) : running_(true) { MemoryTracker::begin_stage(name); }
+    ~MemoryStage() { stop(); }
+
+    MemoryStage(const MemoryStage&) = delete;
+    MemoryStage& operator=(const MemoryStage&) = delete;
+
+    void stop() {
+        if (running_) MemoryTracker::end_stage();
+        running_ = false;
+    }
+
+private:
+    bool running_;
+};
+
+} /* namespace search */
+
+#endif /* MEMORY_TRACKER_H_ */
@@ -0,0 +1,115 @@
+#include "multi_stack_search.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#include "debug_timer.h"
+#include "instrumentation.h"
+#include "logging.h"
+#include "thread_pool.h"
+
+namespace search {
+
+std::vector<SearchTile> plan_search_tiles(const std::vector<int>& widths, const std::vector<int>& heights) {
+    if (widths.size() != heights.size()) throw std::runtime_error("Mismatched search area sizes.");
+
+    std::vector<SearchTile> tiles;
+    for (size_t s = 0; s < widths.size(); ++s) {
+        if (widths[s] <= 0 || heights[s] <= 0) continue;
+        const int tile_rows = std::max(1, SEARCH_TILE_PIXELS / widths[s]);
+        for (int row = 0; row < heights[s]; row += tile_rows) {
+            const int row_end = std::min(row + tile_rows, heights[s]);
+            tiles.push_back({(int)s, row, row_end, (uint64_t)(row_end - row) * widths[s]});
+        }
+    }
+
+    // Start the largest tiles first, so the small ones fill in at the end.
+    std::stable_sort(tiles.begin(), tiles.end(),
+                     [](const SearchTile& a, const SearchTile& b) { return a.num_pixels > b.num_pixels; });
+    return tiles;
+}
+
+void search_stacks(const std::vector<StackSearch*>& searches, const std::vector<Trajectory>& candidates,
+                   int min_observations) {
+    auto logger = logging::getLogger("kbmod.search.multi_stack_search");
+
+    // Tiles of the same search run concurrently, so each search may only appear once.
+    std::set<StackSearch*> unique_searches;
+    for (StackSearch* s : searches) {
+        if (s == nullptr) throw std::runtime_error("Invalid search.");
+        if (!unique_searches.insert(s).second) throw std::runtime_error("Search listed more than once.");
+    }
+
+    DebugTimer timer = DebugTimer("multi-stack search", logger);
+    ScopedTimer phase("search_stacks");
+
+    // Prepare the psi/phi data and results of each search.
+    std::vector<int> widths;
+    std::vector<int> heights;
+    {
+        ScopedTimer prepare_phase("prepare");
+        for (StackSearch* s : searches) {
+            heights.push_back(s->start_cpu_search(min_observations));
+            widths.push_back(s->get_search_width());
+        }
+    }
+
+    std::vector<SearchTile> tiles = plan_search_tiles(widths, heights);
+    LOG_INFO(logger, "Searching " + std::to_string(searches.size()) + " stacks in " +
+                             std::to_string(tiles.size()) + " tiles for " +
+                             std::to_string(candidates.size()) + " trajectories.");
+
+    {
+        ScopedTimer evaluate_phase("evaluate");
+        const std::string& evaluate_path = evaluate_phase.get_path();
+        TaskGroup group;
+        for (const SearchTile& tile : tiles) {
+            group.run([&searches, &candidates, &evaluate_path, tile]() {
+                // Time each stack's tiles separately, under the evaluate phase.
+                ScopedTimer tile_phase("stack_" + std::to_string(tile.search_index), evaluate_path);
+                searches[tile.search_index]->search_rows(candidates, tile.row_begin, tile.row_end);
+            });
+        }
+        group.wait();
+    }
+
+    uint64_t num_pixels = 0;
+    for (const SearchTile& tile : tiles) num_pixels += tile.num_pixels;
+    add_counter("trajectories_evaluated", num_pixels * candidates.size());
+
+    for (StackSearch* s : searches) s->finish_cpu_search();
+    timer.stop();
+}
+
+void search_stacks(const std::vector<StackSearch*>& searches, const TrajectoryGenerator& generator,
+                   int min_observations) {
+    search_stacks(searches, generator.generate(), min_observations);
+}
+
+#ifdef Py_PYTHON_H
+static void multi_stack_search_bindings(py::module& m) {
+    using gen = search::TrajectoryGenerator;
+    using tj = search::Trajectory;
+
+    m.def(
+            "search_stacks",
+            [](const std::vector<StackSearch*>& searches, const std::vector<tj>& candidates,
+               int min_observations) {
+                py::gil_scoped_release release;
+                search_stacks(searches, candidates, min_observations);
+            },
+            py::arg("searches"), py::arg("candidates"), py::arg("min_observations"),
+            pydocs::DOC_search_stacks);
+    m.def(
+            "search_stacks",
+            [](const std::vector<StackSearch*>& searches, const gen& generator, int min_observations) {
+                py::gil_scoped_release release;
+                search_stacks(searches, generator, min_observations);
+            },
+            py::arg("searches"), py::arg("candidates"), py::arg("min_observations"),
+            pydocs::DOC_search_stacks);
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
@@ -0,0 +1,55 @@
+/*
+ * multi_stack_search.h
+ *
+ * Grid searches of several image stacks (such as the chips of one pointing)
+ * with one list of candidate velocities. Each stack keeps its own StackSearch,
+ * with its own starting bounds, filtering settings and results, but the
+ * searches run together: the starting rows of every stack are cut into tiles
+ * and all of the tiles are scheduled on the thread pool at once, largest
+ * first. Small stacks and the last rows of a stack then fill the cores that
+ * would otherwise idle at the end of each search.
+ *
+ * The tiles run on the CPU (see search_rows_cpu), with the same scores and
+ * results per pixel as the GPU search.
+ *
+ * Created on: October 18, 2026
+ */
+
+#ifndef MULTI_STACK_SEARCH_H_
+#define MULTI_STACK_SEARCH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "pydocs/multi_stack_search_docs.h"
+#include "stack_search.h"
+#include "trajectory_generator.h"
+
+namespace search {
+
+// The number of starting pixels in a tile (rounded to whole rows).
+constexpr int SEARCH_TILE_PIXELS = 4096;
+
+struct SearchTile {
+    int search_index;
+    int row_begin;
+    int row_end;
+    uint64_t num_pixels;
+};
+
+// Cut the rows of each search area (given by its width and height) into tiles
+// of about SEARCH_TILE_PIXELS pixels, ordered from the largest to the smallest
+// (ties in search and row order).
+std::vector<SearchTile> plan_search_tiles(const std::vector<int>& widths, const std::vector<int>& heights);
+
+// Search every stack for the candidate velocities. The results of each search
+// are left in its StackSearch, sorted by likelihood, as after StackSearch::search.
+void search_stacks(const std::vector<StackSearch*>& searches, const std::vector<Trajectory>& candidates,
+                   int min_observations);
+void search_stacks(const std::vector<StackSearch*>& searches, const TrajectoryGenerator& generator,
+                   int min_observations);
+
+} /* namespace search */
+
+#endif /* MULTI_STACK_SEARCH_H_ */
@@ -0,0 +1,140 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace search {
+
+std::atomic<bool> PerfCounters::enabled_flag(false);
+
+#ifdef __linux__
+namespace {
+
+constexpr int NUM_PERF_EVENTS = 4;
+constexpr std::array<uint64_t, NUM_PERF_EVENTS> PERF_EVENT_CONFIGS = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES};
+
+// The file descriptors of the calling thread's counters. Opened on first use and
+// closed when the thread exits.
+struct ThreadPerfEvents {
+    std::array<int, NUM_PERF_EVENTS> fds;
+    bool opened = false;
+    bool available = false;
+
+    ThreadPerfEvents() { fds.fill(-1); }
+
+    ~ThreadPerfEvents() {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    bool open_events() {
+        if (opened) return available;
+        opened = true;
+
+        for (int i = 0; i < NUM_PERF_EVENTS; ++i) {
+            struct perf_event_attr attr = {};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_EVENT_CONFIGS[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            // Count the calling thread on any CPU.
+            fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[i] < 0) return false;
+        }
+        available = true;
+        return true;
+    }
+
+    // Read a counter, scaled up if the kernel had to multiplex it.
+    uint64_t read_event(int i) const {
+        uint64_t values[3] = {0, 0, 0};  // value, time enabled, time running
+        if (read(fds[i], values, sizeof(values)) != sizeof(values)) return 0;
+        if (values[2] == 0) return 0;
+        if (values[2] < values[1]) return (uint64_t)((double)values[0] * values[1] / values[2]);
+        return values[0];
+    }
+};
+
+ThreadPerfEvents& thread_events() {
+    thread_local ThreadPerfEvents events;
+    return events;
+}
+
+}  // namespace
+#endif
+
+bool PerfCounters::set_enabled(bool enabled) {
+    enabled_flag.store(enabled && is_available(), std::memory_order_relaxed);
+    return is_enabled();
+}
+
+bool PerfCounters::is_available() {
+#ifdef __linux__
+    return thread_events().open_events();
+#else
+    return false;
+#endif
+}
+
+bool PerfCounters::read_thread_counts(HardwareCounts& counts) {
+#ifdef __linux__
+    ThreadPerfEvents& events = thread_events();
+    if (!events.open_events()) return false;
+
+    counts.cycles = events.read_event(0);
+    counts.instructions = events.read_event(1);
+    counts.cache_misses = events.read_event(2);
+    counts.branch_misses = events.read_event(3);
+    return true;
+#else
+    return false;
+#endif
+}
+
+PerfCounterScope::PerfCounterScope(const std::string& path)
+        : active_(PerfCounters::is_enabled() && !path.empty()), path_(path) {
+    if (active_) active_ = PerfCounters::read_thread_counts(start_);
+}
+
+PerfCounterScope::~PerfCounterScope() {
+    if (!active_) return;
+
+    HardwareCounts end;
+    if (!PerfCounters::read_thread_counts(end)) return;
+
+    // Multiplexed counters are estimates, so guard against them going backwards.
+    auto diff = [](uint64_t a, uint64_t b) { return (a > b) ? a - b : 0; };
+    HardwareCounts delta;
+    delta.cycles = diff(end.cycles, start_.cycles);
+    delta.instructions = diff(end.instructions, start_.instructions);
+    delta.cache_misses = diff(end.cache_misses, start_.cache_misses);
+    delta.branch_misses = diff(end.branch_misses, start_.branch_misses);
+    Instrumentation::instance().add_hardware_counts(path_, delta);
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static void perf_counters_bindings(py::module& m) {
+    using pc = search::PerfCounters;
+
+    py::class_<pc>(m, "PerfCounters", pydocs::DOC_PerfCounters)
+            .def_static("set_enabled", &pc::set_enabled, pydocs::DOC_PerfCounters_set_enabled)
+            .def_static("is_enabled", &pc::is_enabled, pydocs::DOC_PerfCounters_is_enabled)
+            .def_static("is_available", &pc::is_available, pydocs::DOC_PerfCounters_is_available);
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
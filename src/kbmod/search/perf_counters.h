@@ -0,0 +1,68 @@
+/*
+ * perf_counters.h
+ *
+ * Opt-in hardware performance counters (cycles, instructions, cache misses and
+ * branch misses) for the hot phases of the search, read with Linux's
+ * perf_event_open. The counts are recorded per phase in the Instrumentation
+ * registry next to the wall time.
+ *
+ * The counters follow the calling thread only, so for phases that fan out to
+ * worker threads they describe the calling thread's share of the work. On
+ * hosts where the counters are unavailable (other operating systems,
+ * restrictive perf_event_paranoid settings, containers or virtual machines
+ * without a PMU) everything silently becomes a no-op.
+ *
+ * Created on: October 17, 2026
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "instrumentation.h"
+#include "pydocs/perf_counters_docs.h"
+
+namespace search {
+
+class PerfCounters {
+public:
+    // Enable or disable the counters (process wide). Enabling returns whether the
+    // counters could be opened on the calling thread.
+    static bool set_enabled(bool enabled);
+    static bool is_enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+
+    // Whether the counters can be opened on this host.
+    static bool is_available();
+
+    // Read the current counts of the calling thread (opening the counters on first
+    // use). Returns false if the counters are unavailable.
+    static bool read_thread_counts(HardwareCounts& counts);
+
+private:
+    static std::atomic<bool> enabled_flag;
+};
+
+// Counts the hardware events of the enclosing scope on the calling thread and adds
+// them to the given phase. Does nothing if the counters are disabled or unavailable
+// or the path is empty (i.e. the instrumentation is disabled).
+class PerfCounterScope {
+public:
+    explicit PerfCounterScope(const std::string& path);
+    ~PerfCounterScope();
+
+    PerfCounterScope(const PerfCounterScope&) = delete;
+    PerfCounterScope& operator=(const PerfCounterScope&) = delete;
+
+private:
+    bool active_;
+    std::string path_;
+    HardwareCounts start_;
+};
+
+} /* namespace search */
+
+#endif /* PERF_COUNTERS_H_ */
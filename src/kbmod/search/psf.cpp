@@ -46,6 +46,17 @@ PSF::PSF(float stdev) {
     calc_sum();
 }
 
+PSF::PSF(const std::vector<float>& values) {
+    dim = std::lround(std::sqrt((double)values.size()));
+    if (dim * dim != (int)values.size() || dim % 2 == 0) {
+        throw std::runtime_error("PSF kernel must be a square with an odd side length.");
+    }
+    radius = dim / 2;
+    kernel = values;
+    calc_sum();
+    width = 0.0;
+}
+
 // Copy constructor.
 PSF::PSF(const PSF& other) {
     kernel = other.kernel;
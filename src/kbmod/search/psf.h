@@ -14,6 +14,7 @@ class PSF {
 public:
     PSF();  // Create a no-op PSF.
     PSF(float stdev);
+    explicit PSF(const std::vector<float>& kernel);  // A square kernel with an odd side.
     PSF(const PSF& other);  // Copy constructor
     PSF(PSF&& other);       // Move constructor
 #ifdef Py_PYTHON_H
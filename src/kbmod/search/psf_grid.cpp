@@ -0,0 +1,161 @@
+#include "psf_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace search {
+
+// Find the cells whose PSFs are combined at pos (along one axis) and their
+// weights. Cell c covers [c * size / num_cells, (c + 1) * size / num_cells) and
+// its PSF is sampled at its center. Returns the number of cells used (1 or 2).
+static int grid_neighbors(float pos, int size, int num_cells, bool interpolate, int* cells, float* weights) {
+    if (!interpolate) {
+        const int64_t pixel = std::min<int64_t>(std::max<int64_t>(std::floor(pos), 0), size - 1);
+        cells[0] = (pixel * num_cells) / size;
+        weights[0] = 1.0;
+        return 1;
+    }
+
+    // The position in units of cells, relative to the center of the first cell.
+    float g = (pos + 0.5f) * num_cells / size - 0.5f;
+    g = std::min(std::max(g, 0.0f), (float)(num_cells - 1));
+    const int c0 = std::floor(g);
+    const float frac = g - c0;
+    if (frac > 0.0 && c0 + 1 < num_cells) {
+        cells[0] = c0;
+        weights[0] = 1.0f - frac;
+        cells[1] = c0 + 1;
+        weights[1] = frac;
+        return 2;
+    }
+    cells[0] = c0;
+    weights[0] = 1.0;
+    return 1;
+}
+
+PSFGrid::PSFGrid()
+        : width(0), height(0), grid_cols(0), grid_rows(0), interpolate(true), max_radius(0), psfs() {}
+
+PSFGrid::PSFGrid(int width, int height, int grid_cols, int grid_rows, const std::vector<PSF>& psfs,
+                 bool interpolate)
+        : width(width),
+          height(height),
+          grid_cols(grid_cols),
+          grid_rows(grid_rows),
+          interpolate(interpolate),
+          max_radius(0),
+          psfs(psfs) {
+    if (width <= 0 || height <= 0) throw std::runtime_error("PSF grid image size must be positive.");
+    if (grid_cols <= 0 || grid_rows <= 0) throw std::runtime_error("PSF grid must have at least one cell.");
+    if (grid_cols > width || grid_rows > height) {
+        throw std::runtime_error("PSF grid has more cells than the image has pixels.");
+    }
+    if (psfs.size() != (size_t)grid_cols * grid_rows) {
+        throw std::runtime_error("PSF grid needs one PSF per cell (" + std::to_string(grid_cols * grid_rows) +
+                                 "), given " + std::to_string(psfs.size()));
+    }
+    for (const PSF& psf : psfs) max_radius = std::max(max_radius, psf.get_radius());
+}
+
+const PSF& PSFGrid::get_psf(int col, int row) const {
+    if (col < 0 || col >= grid_cols || row < 0 || row >= grid_rows) {
+        throw std::runtime_error("PSF grid cell out of bounds.");
+    }
+    return psfs[row * grid_cols + col];
+}
+
+float PSFGrid::fill_kernel(float x, float y, bool squared, float* kernel, int& radius) const {
+    if (empty()) throw std::runtime_error("The PSF grid is empty.");
+
+    int cols[2];
+    int rows[2];
+    float col_weights[2];
+    float row_weights[2];
+    const int num_cols = grid_neighbors(x, width, grid_cols, interpolate, cols, col_weights);
+    const int num_rows = grid_neighbors(y, height, grid_rows, interpolate, rows, row_weights);
+
+    radius = 0;
+    for (int r = 0; r < num_rows; ++r) {
+        for (int c = 0; c < num_cols; ++c) {
+            radius = std::max(radius, psfs[rows[r] * grid_cols + cols[c]].get_radius());
+        }
+    }
+    const int dim = 2 * radius + 1;
+    std::fill(kernel, kernel + dim * dim, 0.0f);
+
+    // Add the weighted PSFs, centered in the (possibly larger) kernel.
+    for (int r = 0; r < num_rows; ++r) {
+        for (int c = 0; c < num_cols; ++c) {
+            const PSF& psf = psfs[rows[r] * grid_cols + cols[c]];
+            const float weight = row_weights[r] * col_weights[c];
+            const int psf_dim = psf.get_dim();
+            const int offset = radius - psf.get_radius();
+            for (int j = 0; j < psf_dim; ++j) {
+                for (int i = 0; i < psf_dim; ++i) {
+                    kernel[(j + offset) * dim + i + offset] += weight * psf.get_value(i, j);
+                }
+            }
+        }
+    }
+
+    // Sum in kernel order, as PSF does.
+    float sum = 0.0;
+    for (int i = 0; i < dim * dim; ++i) {
+        if (squared) kernel[i] = kernel[i] * kernel[i];
+        sum += kernel[i];
+    }
+    return sum;
+}
+
+PSF PSFGrid::get_psf_at(float x, float y) const {
+    const int max_dim = 2 * max_radius + 1;
+    std::vector<float> kernel(max_dim * max_dim);
+    int radius = 0;
+    fill_kernel(x, y, false, kernel.data(), radius);
+    kernel.resize((2 * radius + 1) * (2 * radius + 1));
+    return PSF(kernel);
+}
+
+std::vector<int> PSFGrid::tile_bounds(int size, int num_cells) {
+    std::vector<int> bounds = {0};
+    for (int c = 0; c < num_cells; ++c) {
+        // The first pixel of each cell (see grid_neighbors).
+        const int begin = ((int64_t)c * size + num_cells - 1) / num_cells;
+        const int end = ((int64_t)(c + 1) * size + num_cells - 1) / num_cells;
+        const int num_tiles = (end - begin + PSF_GRID_TILE_SIZE - 1) / PSF_GRID_TILE_SIZE;
+        for (int t = 1; t <= num_tiles; ++t) {
+            bounds.push_back(begin + ((int64_t)(end - begin) * t) / num_tiles);
+        }
+    }
+    return bounds;
+}
+
+#ifdef Py_PYTHON_H
+static void psf_grid_bindings(py::module& m) {
+    using pg = search::PSFGrid;
+
+    py::class_<pg>(m, "PSFGrid", pydocs::DOC_PSFGrid)
+            .def(py::init<>())
+            .def(py::init<int, int, int, int, const std::vector<search::PSF>&, bool>(), py::arg("width"),
+                 py::arg("height"), py::arg("grid_cols"), py::arg("grid_rows"), py::arg("psfs"),
+                 py::arg("interpolate") = true)
+            .def("empty", &pg::empty, pydocs::DOC_PSFGrid_empty)
+            .def("get_width", &pg::get_width, pydocs::DOC_PSFGrid_get_width)
+            .def("get_height", &pg::get_height, pydocs::DOC_PSFGrid_get_height)
+            .def("get_grid_cols", &pg::get_grid_cols, pydocs::DOC_PSFGrid_get_grid_cols)
+            .def("get_grid_rows", &pg::get_grid_rows, pydocs::DOC_PSFGrid_get_grid_rows)
+            .def("get_psf", &pg::get_psf, py::return_value_policy::reference_internal,
+                 pydocs::DOC_PSFGrid_get_psf)
+            .def("get_interpolate", &pg::get_interpolate, pydocs::DOC_PSFGrid_get_interpolate)
+            .def("set_interpolate", &pg::set_interpolate, pydocs::DOC_PSFGrid_set_interpolate)
+            .def("get_max_radius", &pg::get_max_radius, pydocs::DOC_PSFGrid_get_max_radius)
+            .def("get_psf_at", &pg::get_psf_at, pydocs::DOC_PSFGrid_get_psf_at)
+            .def("get_tile_bounds_x", &pg::get_tile_bounds_x, pydocs::DOC_PSFGrid_get_tile_bounds)
+            .def("get_tile_bounds_y", &pg::get_tile_bounds_y, pydocs::DOC_PSFGrid_get_tile_bounds);
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
@@ -0,0 +1,85 @@
+/*
+ * psf_grid.h
+ *
+ * A spatially varying PSF, sampled on a coarse grid over an image. The image
+ * is split into grid_cols x grid_rows equal cells and each cell has the PSF
+ * measured at its center. The PSF anywhere else is either the PSF of the cell
+ * (nearest) or the bilinear interpolation of the four closest cell PSFs.
+ *
+ * Images are convolved with a PSFGrid tile by tile (RawImage::convolve_psf_grid):
+ * each tile uses the PSF at its center, read from the whole source image so the
+ * halo around a tile holds the real neighbouring pixels, and the tiles run in
+ * parallel. The tiles never cross a cell boundary, so in nearest mode every
+ * pixel uses the PSF of its own cell.
+ *
+ * Created on: October 18, 2026
+ */
+
+#ifndef PSF_GRID_H_
+#define PSF_GRID_H_
+
+#include <vector>
+
+#include "common.h"
+#include "psf.h"
+#include "pydocs/psf_grid_docs.h"
+
+namespace search {
+
+// The largest width and height (in pixels) of a convolution tile.
+constexpr int PSF_GRID_TILE_SIZE = 64;
+
+class PSFGrid {
+public:
+    PSFGrid();  // An empty grid.
+
+    // The PSFs are given in row-major order (grid_cols per row) and may have
+    // different sizes.
+    PSFGrid(int width, int height, int grid_cols, int grid_rows, const std::vector<PSF>& psfs,
+            bool interpolate = true);
+
+    bool empty() const { return psfs.empty(); }
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_grid_cols() const { return grid_cols; }
+    int get_grid_rows() const { return grid_rows; }
+    const PSF& get_psf(int col, int row) const;
+    const std::vector<PSF>& get_psfs() const { return psfs; }
+
+    // Whether the PSF between the cell centers is interpolated (otherwise the
+    // nearest cell's PSF is used).
+    bool get_interpolate() const { return interpolate; }
+    void set_interpolate(bool value) { interpolate = value; }
+
+    // The largest radius of the grid's PSFs. Every kernel at a point fits in
+    // (2 * max_radius + 1)^2 values.
+    int get_max_radius() const { return max_radius; }
+
+    // Write the kernel at the pixel (x, y) into kernel, squared element-wise for
+    // variance images if requested. Sets radius to the kernel's radius and
+    // returns the sum of its values.
+    float fill_kernel(float x, float y, bool squared, float* kernel, int& radius) const;
+
+    // The PSF at the pixel (x, y).
+    PSF get_psf_at(float x, float y) const;
+
+    // The boundaries of the convolution tiles along each axis: every cell
+    // boundary plus steps of at most PSF_GRID_TILE_SIZE in between.
+    std::vector<int> get_tile_bounds_x() const { return tile_bounds(width, grid_cols); }
+    std::vector<int> get_tile_bounds_y() const { return tile_bounds(height, grid_rows); }
+
+private:
+    static std::vector<int> tile_bounds(int size, int num_cells);
+
+    int width;
+    int height;
+    int grid_cols;
+    int grid_rows;
+    bool interpolate;
+    int max_radius;
+    std::vector<PSF> psfs;
+};
+
+} /* namespace search */
+
+#endif /* PSF_GRID_H_ */
@@ -24,8 +24,9 @@ PsiPhiArray::~PsiPhiArray() { clear(); }
 void PsiPhiArray::clear() {
     // Free all used memory on CPU and GPU.
     if (cpu_array_ptr != nullptr) {
-        free(cpu_array_ptr);
+        HugePages::deallocate(cpu_array_ptr);
         cpu_array_ptr = nullptr;
+        MemoryTracker::release(MEM_PSI_PHI, meta_data.total_array_size);
     }
     cpu_time_array.clear();
     clear_from_gpu();
@@ -47,6 +48,19 @@ void PsiPhiArray::clear() {
     meta_data.phi_scale = 1.0;
 }
 
+void PsiPhiArray::set_cpu_array_ptr(void* new_ptr) {
+    if (cpu_array_ptr != nullptr) throw std::runtime_error("CPU PsiPhi already allocated.");
+    if (new_ptr != nullptr && !HugePages::owns(new_ptr)) {
+        throw std::runtime_error("CPU PsiPhi array not from HugePages::allocate.");
+    }
+    cpu_array_ptr = new_ptr;
+    if (cpu_array_ptr != nullptr) MemoryTracker::allocate(MEM_PSI_PHI, meta_data.total_array_size);
+}
+
+uint64_t PsiPhiArray::get_cpu_huge_page_bytes() {
+    return HugePages::get_huge_page_bytes(cpu_array_ptr, meta_data.total_array_size);
+}
+
 void PsiPhiArray::clear_from_gpu() {
     if (!data_on_gpu) {
         if ((gpu_array_ptr != nullptr) || gpu_time_array.on_gpu()) {
@@ -199,14 +213,35 @@ float PsiPhiArray::read_time(int time_index) {
 std::array<float, 3> compute_scale_params_from_image_vect(const std::vector<RawImage>& imgs, int num_bytes) {
     int num_images = imgs.size();
 
-    // Do a linear pass through the data to compute the scaling parameters for psi and phi.
-    float min_val = FLT_MAX;
-    float max_val = -FLT_MAX;
-    for (int i = 0; i < num_images; ++i) {
-        std::array<float, 2> bnds = imgs[i].compute_bounds();
-        if (bnds[0] < min_val) min_val = bnds[0];
-        if (bnds[1] > max_val) max_val = bnds[1];
-    }
+    // Reduce the bounds over the pixels of all the images in one parallel pass,
+    // indexing the pixels of the images one after another.
+    std::vector<int64_t> offsets(num_images + 1, 0);
+    for (int i = 0; i < num_images; ++i) offsets[i + 1] = offsets[i] + imgs[i].get_npixels();
+
+    std::array<float, 2> bounds = parallel_reduce(
+            0, offsets[num_images], std::array<float, 2>{FLT_MAX, -FLT_MAX},
+            [&](int64_t lo, int64_t hi) {
+                float min_val = FLT_MAX;
+                float max_val = -FLT_MAX;
+                int i = std::upper_bound(offsets.begin(), offsets.end(), lo) - offsets.begin() - 1;
+                for (int64_t p = lo; p < hi; ++i) {
+                    const float* pixels = imgs[i].get_image().data();
+                    const int64_t end = std::min(hi, offsets[i + 1]);
+                    for (; p < end; ++p) {
+                        const float value = pixels[p - offsets[i]];
+                        if (pixel_value_valid(value)) {
+                            min_val = std::min(min_val, value);
+                            max_val = std::max(max_val, value);
+                        }
+                    }
+                }
+                return std::array<float, 2>{min_val, max_val};
+            },
+            [](const std::array<float, 2>& a, const std::array<float, 2>& b) {
+                return std::array<float, 2>{std::min(a[0], b[0]), std::max(a[1], b[1])};
+            });
+    const float min_val = bounds[0];
+    const float max_val = bounds[1];
 
     // Set the scale if we are encoding the values.
     float scale = 1.0;
@@ -231,9 +266,10 @@ void set_encode_cpu_psi_phi_array(PsiPhiArray& data, const std::vector<RawImage>
         printf("Allocating CPU memory for encoded PsiPhi array using %lu bytes.\n",
                data.get_total_array_size());
     }
-    T* encoded = (T*)malloc(data.get_total_array_size());
+    T* encoded = (T*)HugePages::allocate(data.get_total_array_size());
     if (encoded == nullptr) {
-        throw std::runtime_error("Unable to allocate space for CPU PsiPhi array.");
+        throw std::runtime_error("Unable to allocate " + std::to_string(data.get_total_array_size()) +
+                                 " bytes for CPU PsiPhi array.\n" + MemoryTracker::to_string());
     }
 
     // Create a safe maximum that is slightly less than the true max to avoid
@@ -241,13 +277,15 @@ void set_encode_cpu_psi_phi_array(PsiPhiArray& data, const std::vector<RawImage>
     float safe_max_psi = data.get_psi_max_val() - data.get_psi_scale() / 100.0;
     float safe_max_phi = data.get_phi_max_val() - data.get_phi_scale() / 100.0;
 
-    int current_index = 0;
+    // Fill the rows with a static partition, so the pages of each band of rows are
+    // first touched on the NUMA node of the threads that search from them.
     int num_bytes = data.get_num_bytes();
-    for (int t = 0; t < data.get_num_times(); ++t) {
-        for (int row = 0; row < data.get_height(); ++row) {
+    parallel_for_static(0, data.get_height(), [&](int64_t row) {
+        for (int t = 0; t < data.get_num_times(); ++t) {
+            uint64_t current_index = 2 * ((uint64_t)data.get_pixels_per_image() * t + row * data.get_width());
             for (int col = 0; col < data.get_width(); ++col) {
-                float psi_value = psi_imgs[t].get_pixel({row, col});
-                float phi_value = phi_imgs[t].get_pixel({row, col});
+                float psi_value = psi_imgs[t].get_pixel({(int)row, col});
+                float phi_value = phi_imgs[t].get_pixel({(int)row, col});
 
                 // Handle the encoding for the different values.
                 if (num_bytes == 1 || num_bytes == 2) {
@@ -261,7 +299,7 @@ void set_encode_cpu_psi_phi_array(PsiPhiArray& data, const std::vector<RawImage>
                 encoded[current_index++] = static_cast<T>(phi_value);
             }
         }
-    }
+    });
 
     data.set_cpu_array_ptr((void*)encoded);
 }
@@ -274,20 +312,22 @@ void set_float_cpu_psi_phi_array(PsiPhiArray& data, const std::vector<RawImage>&
     if (debug) {
         printf("Allocating CPU memory for PsiPhi array using %lu bytes.\n", data.get_total_array_size());
     }
-    float* encoded = (float*)malloc(data.get_total_array_size());
+    float* encoded = (float*)HugePages::allocate(data.get_total_array_size());
     if (encoded == nullptr) {
-        throw std::runtime_error("Unable to allocate space for CPU PsiPhi array.");
+        throw std::runtime_error("Unable to allocate " + std::to_string(data.get_total_array_size()) +
+                                 " bytes for CPU PsiPhi array.\n" + MemoryTracker::to_string());
     }
 
-    int current_index = 0;
-    for (int t = 0; t < data.get_num_times(); ++t) {
-        for (int row = 0; row < data.get_height(); ++row) {
+    // Use the same static partition of the rows as the encoded arrays.
+    parallel_for_static(0, data.get_height(), [&](int64_t row) {
+        for (int t = 0; t < data.get_num_times(); ++t) {
+            uint64_t current_index = 2 * ((uint64_t)data.get_pixels_per_image() * t + row * data.get_width());
             for (int col = 0; col < data.get_width(); ++col) {
-                encoded[current_index++] = psi_imgs[t].get_pixel({row, col});
-                encoded[current_index++] = phi_imgs[t].get_pixel({row, col});
+                encoded[current_index++] = psi_imgs[t].get_pixel({(int)row, col});
+                encoded[current_index++] = phi_imgs[t].get_pixel({(int)row, col});
             }
         }
-    }
+    });
 
     data.set_cpu_array_ptr((void*)encoded);
 }
@@ -341,6 +381,11 @@ void fill_psi_phi_array(PsiPhiArray& result_data, int num_bytes, const std::vect
         set_float_cpu_psi_phi_array(result_data, psi_imgs, phi_imgs, debug);
     }
 
+    if (debug) {
+        printf("%lu of the %lu bytes of the CPU PsiPhi array are on huge pages.\n",
+               result_data.get_cpu_huge_page_bytes(), result_data.get_total_array_size());
+    }
+
     // Copy the time array.
     if (debug) {
         const long unsigned times_bytes = result_data.get_num_times() * sizeof(float);
@@ -364,6 +409,7 @@ void fill_psi_phi_array_from_image_stack(PsiPhiArray& result_data, ImageStack& s
 
     // Build the psi and phi images first.
     for (int i = 0; i < num_images; ++i) {
+        ScopedTimer image_timer("psi_phi_image");
         LayeredImage& img = stack.get_single_image(i);
         psi_images.push_back(img.generate_psi_image());
         phi_images.push_back(img.generate_phi_image());
@@ -375,6 +421,42 @@ void fill_psi_phi_array_from_image_stack(PsiPhiArray& result_data, ImageStack& s
     fill_psi_phi_array(result_data, num_bytes, psi_images, phi_images, zeroed_times, debug);
 }
 
+void fill_psi_phi_arrays_for_psfs(const std::vector<PsiPhiArray*>& results, ImageStack& stack,
+                                  const std::vector<PSF>& psfs, int num_bytes, bool debug) {
+    if (results.size() != psfs.size()) throw std::runtime_error("Need one PsiPhiArray for each PSF.");
+    const int num_psfs = psfs.size();
+    const int num_images = stack.img_count();
+    if (debug) {
+        unsigned long total_bytes =
+                2 * stack.get_height() * stack.get_width() * num_images * num_psfs * sizeof(float);
+        printf("Building %i temporary %i by %i images (psi and phi for %i PSFs), requiring %lu bytes",
+               (num_images * 2 * num_psfs), stack.get_width(), stack.get_height(), num_psfs, total_bytes);
+    }
+
+    std::vector<std::vector<RawImage>> psi_images(num_psfs);
+    std::vector<std::vector<RawImage>> phi_images(num_psfs);
+    for (int i = 0; i < num_images; ++i) {
+        ScopedTimer image_timer("psi_phi_image");
+        LayeredImage& img = stack.get_single_image(i);
+        const RawImage psi_plane = img.generate_unconvolved_psi_image();
+        const RawImage phi_plane = img.generate_unconvolved_phi_image();
+        for (int p = 0; p < num_psfs; ++p) {
+            psi_images[p].push_back(psi_plane);
+            psi_images[p].back().convolve(psfs[p]);
+            phi_images[p].push_back(phi_plane);
+            phi_images[p].back().convolve_squared(psfs[p]);
+        }
+    }
+
+    // Each array is encoded with the bounds of its own images.
+    std::vector<float> zeroed_times = stack.build_zeroed_times();
+    for (int p = 0; p < num_psfs; ++p) {
+        fill_psi_phi_array(*results[p], num_bytes, psi_images[p], phi_images[p], zeroed_times, debug);
+        psi_images[p].clear();
+        phi_images[p].clear();
+    }
+}
+
 // -------------------------------------------
 // --- Python definitions --------------------
 // -------------------------------------------
@@ -416,6 +498,8 @@ static void psi_phi_array_binding(py::module& m) {
                                    pydocs::DOC_PsiPhiArray_get_cpu_array_allocated)
             .def_property_readonly("gpu_array_allocated", &ppa::gpu_array_allocated,
                                    pydocs::DOC_PsiPhiArray_get_gpu_array_allocated)
+            .def_property_readonly("cpu_huge_page_bytes", &ppa::get_cpu_huge_page_bytes,
+                                   pydocs::DOC_PsiPhiArray_get_cpu_huge_page_bytes)
             .def("set_meta_data", &ppa::set_meta_data, pydocs::DOC_PsiPhiArray_set_meta_data)
             .def("set_time_array", &ppa::set_time_array, pydocs::DOC_PsiPhiArray_set_time_array)
             .def("move_to_gpu", &ppa::move_to_gpu, py::arg("debug") = false,
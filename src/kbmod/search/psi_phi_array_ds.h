@@ -101,6 +101,9 @@ public:
     inline bool cpu_array_allocated() { return cpu_array_ptr != nullptr; }
     inline bool gpu_array_allocated() { return gpu_array_ptr != nullptr; }
 
+    // The bytes of the CPU array that the kernel backed with huge pages.
+    uint64_t get_cpu_huge_page_bytes();
+
     // Primary getter functions for interaction (read the data).
     PsiPhi read_psi_phi(int time_index, int row, int col);
     float read_time(int time_index);
@@ -118,7 +121,9 @@ public:
     // Should ONLY be called by the utility functions.
     inline void* get_cpu_array_ptr() { return cpu_array_ptr; }
     inline void* get_gpu_array_ptr() { return gpu_array_ptr; }
-    inline void set_cpu_array_ptr(void* new_ptr) { cpu_array_ptr = new_ptr; }
+    // Takes ownership of an array of get_total_array_size() bytes from HugePages::allocate.
+    // Throws for any other pointer, since clear() frees it with HugePages::deallocate.
+    void set_cpu_array_ptr(void* new_ptr);
 
     inline float* get_cpu_time_array_ptr() { return cpu_time_array.data(); }
     inline float* get_gpu_time_array_ptr() { return gpu_time_array.get_ptr(); }
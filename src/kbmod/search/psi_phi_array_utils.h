@@ -17,10 +17,14 @@
 #include <vector>
 
 #include "common.h"
+#include "huge_pages.h"
 #include "image_stack.h"
+#include "instrumentation.h"
 #include "layered_image.h"
+#include "memory_tracker.h"
 #include "psi_phi_array_ds.h"
 #include "raw_image.h"
+#include "thread_pool.h"
 
 namespace search {
 
@@ -34,6 +38,12 @@ void fill_psi_phi_array(PsiPhiArray& result_data, int num_bytes, const std::vect
 void fill_psi_phi_array_from_image_stack(PsiPhiArray& result_data, ImageStack& stack, int num_bytes,
                                          bool debug = false);
 
+// Fill one array per PSF, with every image convolved with that PSF (instead of
+// its own). The unconvolved psi and phi planes of each image are computed once
+// and shared by all of the PSFs.
+void fill_psi_phi_arrays_for_psfs(const std::vector<PsiPhiArray*>& results, ImageStack& stack,
+                                  const std::vector<PSF>& psfs, int num_bytes, bool debug = false);
+
 } /* namespace search */
 
 #endif /* PSI_PHI_ARRAY_UTILS_ */
@@ -25,6 +25,9 @@ static const auto DOC_Trajectory = R"doc(
         Number of observations trajectory was seen in.
     valid : `bool`
         Whether the trajectory is valid. Used for filtering.
+    psf_index : `int`
+        The PSF variant the trajectory is scored with. Searches with
+        several PSF variants set it to the variant with the best likelihood.
   )doc";
 
 static const auto DOC_Trajectory_get_x_pos = R"doc(
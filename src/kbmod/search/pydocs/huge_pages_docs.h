@@ -0,0 +1,44 @@
+#ifndef HUGE_PAGES_DOCS_
+#define HUGE_PAGES_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_HugePages = R"doc(
+  The allocator of the large buffers (the psi/phi array and the image layers)
+  on 2 MB huge pages, from the explicit huge page pool when it has room and
+  otherwise as transparent huge pages.
+  )doc";
+
+static const auto DOC_HugePages_get_enabled = R"doc(
+  Return whether large buffers are allocated on huge pages.
+  )doc";
+
+static const auto DOC_HugePages_set_enabled = R"doc(
+  Turn the use of huge pages for new large buffers on or off.
+
+  Parameters
+  ----------
+  enable : `bool`
+      Whether to use huge pages.
+  )doc";
+
+static const auto DOC_HugePages_get_report = R"doc(
+  Return the use of huge pages by the live buffers of the allocator.
+
+  Returns
+  -------
+  report : `dict`
+      A dictionary with the "enabled" flag, the "num_buffers" and their total
+      "bytes", the bytes mapped from the explicit huge page pool
+      ("hugetlb_bytes") and advised for transparent huge pages
+      ("transparent_bytes"), and the bytes the kernel actually backed with
+      huge pages ("huge_page_bytes").
+  )doc";
+
+static const auto DOC_HugePages_to_string = R"doc(
+  Return a human readable summary of the use of huge pages.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* HUGE_PAGES_DOCS_ */
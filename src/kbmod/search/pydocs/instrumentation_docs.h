@@ -0,0 +1,123 @@
+#ifndef INSTRUMENTATION_DOCS_
+#define INSTRUMENTATION_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_Instrumentation = R"doc(
+  The global registry of phase timings and counters. Every thread accumulates
+  into its own storage and the data is merged when a report is requested.
+  Enabled by default.
+  )doc";
+
+static const auto DOC_Instrumentation_is_enabled = R"doc(
+  Return whether the timings and counters are being recorded.
+  )doc";
+
+static const auto DOC_Instrumentation_set_enabled = R"doc(
+  Enable or disable the recording of timings and counters.
+
+  Parameters
+  ----------
+  enabled : `bool`
+      Whether to record.
+  )doc";
+
+static const auto DOC_Instrumentation_reset = R"doc(
+  Clear all of the recorded timings and counters, and the phases active on
+  the calling thread.
+  )doc";
+
+static const auto DOC_Instrumentation_add_counter = R"doc(
+  Add to a named counter.
+
+  Parameters
+  ----------
+  name : `str`
+      The name of the counter.
+  value : `int`
+      The (non-negative) amount to add.
+  )doc";
+
+static const auto DOC_Instrumentation_get_report = R"doc(
+  Return all of the data recorded since the last reset.
+
+  Returns
+  -------
+  report : `dict`
+      A dictionary with a "phases" entry mapping each phase path (such as
+      "run_search/grid_search/psi_phi") to a dictionary of its "calls",
+      "total_seconds", "min_seconds" and "max_seconds", a "counters"
+      entry mapping each counter name to its value and a "hardware" entry
+      mapping each phase measured with ``PerfCounters`` to its "cycles",
+      "instructions", "cache_misses", "branch_misses" and "ipc".
+  )doc";
+
+static const auto DOC_Instrumentation_is_tracing = R"doc(
+  Return whether the timed phases are being recorded as trace events.
+  )doc";
+
+static const auto DOC_Instrumentation_set_tracing = R"doc(
+  Enable or disable the recording of trace events. Each ``ScopedTimer`` that
+  completes while tracing (and the instrumentation) is enabled adds an event to
+  its thread's timeline. Tracing has no cost while it is disabled.
+
+  Parameters
+  ----------
+  tracing : `bool`
+      Whether to record trace events.
+  )doc";
+
+static const auto DOC_Instrumentation_num_trace_events = R"doc(
+  Return the number of trace events recorded since the last reset.
+  )doc";
+
+static const auto DOC_Instrumentation_write_trace = R"doc(
+  Write the recorded trace events to a Chrome Trace Event JSON file, which can
+  be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+
+  Parameters
+  ----------
+  filename : `str`
+      The name of the output file.
+
+  Raises
+  ------
+  RuntimeError:
+      If the file cannot be opened.
+  )doc";
+
+static const auto DOC_Instrumentation_to_string = R"doc(
+  Return a human readable summary of the recorded data.
+  )doc";
+
+static const auto DOC_ScopedTimer = R"doc(
+  Time a phase of the run with a monotonic clock. The phase is nested under
+  the phases already active on the same thread and its duration is recorded
+  in the ``Instrumentation`` registry when the timer is stopped. Can be used
+  as a context manager. The timer starts when it is created.
+
+  Parameters
+  ----------
+  name : `str`
+      The name of the phase.
+  parent : `str`, optional
+      The phase to nest under if no phase is active on the current thread,
+      such as in a worker thread.
+  )doc";
+
+static const auto DOC_ScopedTimer_stop = R"doc(
+  Stop the timer and record the duration. Later calls have no effect.
+  )doc";
+
+static const auto DOC_ScopedTimer_read = R"doc(
+  Read the elapsed time without stopping the timer.
+
+  Returns
+  -------
+  duration : `float`
+      The elapsed time in seconds.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* INSTRUMENTATION_DOCS_ */
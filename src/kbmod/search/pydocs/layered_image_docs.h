@@ -3,18 +3,23 @@
 
 namespace pydocs {
 static const auto DOC_LayeredImage = R"doc(
-  Creates a layered_image out of individual `RawImage` layers.
+  Creates a layered_image out of individual `RawImage` layers or out of
+  the pixel arrays of each layer.
 
   Parameters
   ----------
-  sci : `RawImage`
-      The `RawImage` for the science layer.
-  var : `RawImage`
-      The `RawImage` for the cariance layer.
-  msk : `RawImage`
-      The `RawImage` for the mask layer.
+  sci : `RawImage` or `numpy.ndarray`
+      The science layer.
+  var : `RawImage` or `numpy.ndarray`
+      The variance layer.
+  msk : `RawImage` or `numpy.ndarray`
+      The mask layer.
   psf : `PSF`
       The PSF for the image.
+  obs_time : `float`, optional
+      The observation time. Only used when the layers are given as arrays,
+      in which case the array data is converted to float32 once and then
+      moved into the layers without any further copies.
 
   Raises
   ------
@@ -30,6 +35,33 @@ static const auto DOC_LayeredImage_get_psf = R"doc(
   Returns the PSF object.
   )doc";
 
+static const auto DOC_LayeredImage_set_psf_grid = R"doc(
+  Sets a spatially varying PSF. While set, the grid is used instead of the
+  single PSF by ``convolve_psf()``, ``generate_psi_image()`` and
+  ``generate_phi_image()`` (which then convolve on the CPU).
+
+  Parameters
+  ----------
+  grid : `PSFGrid`
+      The PSF grid. Must have the same size as the image.
+
+  Raises
+  ------
+  Raises a ``RuntimeError`` if the grid's size does not match the image.
+  )doc";
+
+static const auto DOC_LayeredImage_get_psf_grid = R"doc(
+  Returns the PSF grid (empty if none is set).
+  )doc";
+
+static const auto DOC_LayeredImage_has_psf_grid = R"doc(
+  Returns True if a spatially varying PSF is set.
+  )doc";
+
+static const auto DOC_LayeredImage_clear_psf_grid = R"doc(
+  Removes the PSF grid, so the single PSF is used again.
+  )doc";
+
 static const auto DOC_LayeredImage_mask_pixel = R"doc(
   Apply masking to a single pixel. Applies to all three layers so that
   it can be used before or after ``apply_mask()``. 
@@ -113,8 +145,9 @@ static const auto DOC_LayeredImage_set_variance = R"doc(
   )doc";
 
 static const auto DOC_LayeredImage_convolve_psf = R"doc(
-  Convolves the PSF stored within the LayeredImage with the science and variance
-  layers (uses the PSF-squared for the variance). Modifies the layers in place.
+  Convolves the PSF stored within the LayeredImage (or its PSF grid, if one is
+  set) with the science and variance layers (uses the PSF-squared for the
+  variance). Modifies the layers in place.
   )doc";
 
 static const auto DOC_LayeredImage_convolve_given_psf = R"doc(
@@ -212,7 +245,7 @@ static const auto DOC_LayeredImage_generate_psi_image = R"doc(
   resulting image is science[p] / variance[p]. To handle masked bits
   apply_mask() must be called before the psi image is generated. Otherwise,
   all pixels are used.
-  Convolves the resulting image with the PSF.
+  Convolves the resulting image with the PSF (or the PSF grid, if one is set).
 
   Returns
   -------
@@ -225,7 +258,7 @@ static const auto DOC_LayeredImage_generate_phi_image = R"doc(
   resulting image is 1.0 / variance[p]. To handle masked bits
   apply_mask() must be called before the phi image is generated. Otherwise,
   all pixels are used.
-  Convolves the resulting image with the PSF.
+  Convolves the resulting image with the PSF (or the PSF grid, if one is set).
 
   Returns
   -------
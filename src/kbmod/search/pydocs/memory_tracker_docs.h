@@ -0,0 +1,58 @@
+#ifndef MEMORY_TRACKER_DOCS_
+#define MEMORY_TRACKER_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_MemoryTracker = R"doc(
+  The accounting of the memory held by the major data structures (the
+  "raw_image" layers, the "psi_phi" array, the "trajectory_list", the
+  "stamps" and the scratch "arena" of each thread) along with the resident set size (RSS) of the process and the RSS
+  high-water mark of each ``MemoryStage``.
+  )doc";
+
+static const auto DOC_MemoryTracker_reset = R"doc(
+  Restart each category's peak at its current usage and clear the stage data.
+  )doc";
+
+static const auto DOC_MemoryTracker_get_rss_bytes = R"doc(
+  Return the resident set size of the process in bytes (0 if unavailable).
+  )doc";
+
+static const auto DOC_MemoryTracker_get_peak_rss_bytes = R"doc(
+  Return the RSS high-water mark of the process in bytes (0 if unavailable).
+  )doc";
+
+static const auto DOC_MemoryTracker_get_report = R"doc(
+  Return the memory usage.
+
+  Returns
+  -------
+  report : `dict`
+      A dictionary with a "categories" entry mapping each category name to a
+      dictionary of its "current_bytes" and "peak_bytes", a
+      "stage_peak_rss_bytes" entry mapping each stage name to its RSS
+      high-water mark, and the current "rss_bytes" and "peak_rss_bytes".
+  )doc";
+
+static const auto DOC_MemoryTracker_to_string = R"doc(
+  Return a human readable summary of the memory usage.
+  )doc";
+
+static const auto DOC_MemoryStage = R"doc(
+  Record the RSS high-water mark of a stage of the run, such as "grid_search",
+  in the ``MemoryTracker``. Stages can be nested. Can be used as a context
+  manager. The stage starts when it is created.
+
+  Parameters
+  ----------
+  name : `str`
+      The name of the stage.
+  )doc";
+
+static const auto DOC_MemoryStage_stop = R"doc(
+  End the stage and record its peak. Later calls have no effect.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* MEMORY_TRACKER_DOCS_ */
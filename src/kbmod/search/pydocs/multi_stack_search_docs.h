@@ -0,0 +1,37 @@
+#ifndef MULTI_STACK_SEARCH_DOCS_
+#define MULTI_STACK_SEARCH_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_search_stacks = R"doc(
+  Search several image stacks for the same candidate velocities at once.
+
+  Each stack is searched with its own ``StackSearch`` (and its starting bounds,
+  sigma-G and encoding settings). The starting rows of all of the stacks are
+  split into tiles that run together on the thread pool, so small stacks and
+  the edges of large ones do not leave cores idle. The searches run on the CPU
+  and score trajectories exactly as the GPU search does.
+
+  Parameters
+  ----------
+  searches : `list` of `StackSearch`
+      The searches to run. Each may only appear once.
+  candidates : `list` of `Trajectory` or `TrajectoryGenerator`
+      The candidate velocities shared by all of the searches.
+  min_observations : `int`
+      The minimum number of valid observations for a result.
+
+  Notes
+  -----
+  The results of each search are kept in its ``StackSearch`` (sorted by
+  likelihood), where they are read with ``get_results`` as after ``search``.
+
+  Raises
+  ------
+  RuntimeError:
+      If a search is listed more than once.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* MULTI_STACK_SEARCH_DOCS_ */
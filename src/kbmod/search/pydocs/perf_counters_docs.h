@@ -0,0 +1,38 @@
+#ifndef PERF_COUNTERS_DOCS_
+#define PERF_COUNTERS_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_PerfCounters = R"doc(
+  Opt-in hardware performance counters (Linux ``perf_event_open``). When enabled,
+  the search, psi/phi and convolution phases record their cycles, instructions,
+  cache misses and branch misses in the ``Instrumentation`` report. The counters
+  follow the calling thread only. Where the counters are unavailable, enabling
+  them has no effect.
+  )doc";
+
+static const auto DOC_PerfCounters_set_enabled = R"doc(
+  Enable or disable the hardware counters.
+
+  Parameters
+  ----------
+  enabled : `bool`
+      Whether to record the hardware counters.
+
+  Returns
+  -------
+  enabled : `bool`
+      Whether the counters are now enabled. Always False if they are unavailable.
+  )doc";
+
+static const auto DOC_PerfCounters_is_enabled = R"doc(
+  Return whether the hardware counters are being recorded.
+  )doc";
+
+static const auto DOC_PerfCounters_is_available = R"doc(
+  Return whether the hardware counters can be used on this host.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* PERF_COUNTERS_DOCS_ */
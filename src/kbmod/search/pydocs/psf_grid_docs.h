@@ -0,0 +1,117 @@
+#ifndef PSF_GRID_DOCS_
+#define PSF_GRID_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_PSFGrid = R"doc(
+  A spatially varying PSF sampled on a coarse grid over an image.
+
+  The image is split into ``grid_cols`` x ``grid_rows`` equal cells and each
+  cell has the PSF measured at its center. Between the cell centers the PSF
+  is either bilinearly interpolated from the four closest cells or taken from
+  the cell containing the pixel.
+
+  Parameters
+  ----------
+  width : `int`
+      The width of the image in pixels.
+  height : `int`
+      The height of the image in pixels.
+  grid_cols : `int`
+      The number of cells along the x axis.
+  grid_rows : `int`
+      The number of cells along the y axis.
+  psfs : `list` of `PSF`
+      One PSF per cell in row-major order (``grid_cols`` per row). The PSFs
+      may have different sizes.
+  interpolate : `bool`
+      Interpolate between the cell centers (True) or use the PSF of the
+      pixel's cell (False). Default: True
+
+  Notes
+  -----
+  Images are convolved with a grid in tiles of at most 64 x 64 pixels that
+  never cross a cell boundary. Each tile uses the PSF at its center and reads
+  its halo from the rest of the image, and the tiles run in parallel on the
+  CPU.
+
+  Raises
+  ------
+  Raises a ``RuntimeError`` if the number of PSFs does not match the grid or
+  the grid has more cells than the image has pixels.
+  )doc";
+
+static const auto DOC_PSFGrid_empty = R"doc(
+  Returns True if the grid has no PSFs (as when created without arguments).
+  )doc";
+
+static const auto DOC_PSFGrid_get_width = R"doc(
+  Returns the width of the image in pixels.
+  )doc";
+
+static const auto DOC_PSFGrid_get_height = R"doc(
+  Returns the height of the image in pixels.
+  )doc";
+
+static const auto DOC_PSFGrid_get_grid_cols = R"doc(
+  Returns the number of cells along the x axis.
+  )doc";
+
+static const auto DOC_PSFGrid_get_grid_rows = R"doc(
+  Returns the number of cells along the y axis.
+  )doc";
+
+static const auto DOC_PSFGrid_get_psf = R"doc(
+  Returns the PSF of a cell.
+
+  Parameters
+  ----------
+  col : `int`
+      The column of the cell.
+  row : `int`
+      The row of the cell.
+  )doc";
+
+static const auto DOC_PSFGrid_get_interpolate = R"doc(
+  Returns True if the PSF is interpolated between the cell centers.
+  )doc";
+
+static const auto DOC_PSFGrid_set_interpolate = R"doc(
+  Set whether to interpolate the PSF between the cell centers.
+
+  Parameters
+  ----------
+  interpolate : `bool`
+      Interpolate (True) or use the PSF of the pixel's cell (False).
+  )doc";
+
+static const auto DOC_PSFGrid_get_max_radius = R"doc(
+  Returns the largest radius of the grid's PSFs.
+  )doc";
+
+static const auto DOC_PSFGrid_get_psf_at = R"doc(
+  Returns the PSF at a pixel.
+
+  Parameters
+  ----------
+  x : `float`
+      The x coordinate of the pixel.
+  y : `float`
+      The y coordinate of the pixel.
+
+  Returns
+  -------
+  psf : `PSF`
+      The PSF of the pixel's cell or the interpolated PSF. An interpolated
+      PSF is as large as the largest PSF it is made from.
+  )doc";
+
+static const auto DOC_PSFGrid_get_tile_bounds = R"doc(
+  Returns the boundaries of the convolution tiles along the axis: the cell
+  boundaries and steps of at most 64 pixels between them, starting at 0 and
+  ending at the size of the image.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* PSF_GRID_DOCS_ */
@@ -87,6 +87,10 @@ static const auto DOC_PsiPhiArray_get_gpu_array_allocated = R"doc(
   A Boolean indicating whether the gpu data (psi/phi) array exists.
   )doc";
 
+static const auto DOC_PsiPhiArray_get_cpu_huge_page_bytes = R"doc(
+  The number of bytes of the cpu data (psi/phi) array that are backed by huge pages.
+  )doc";
+
 static const auto DOC_PsiPhiArray_get_cpu_time_array_allocated = R"doc(
   A Boolean indicating whether the cpu time array exists.
   )doc";
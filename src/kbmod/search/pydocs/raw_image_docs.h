@@ -352,6 +352,30 @@ static const auto DOC_RawImage_convolve_cpu = R"doc(
       Point Spread Function.
   )doc";
 
+static const auto DOC_RawImage_convolve_psf_grid = R"doc(
+  Convolve the image with a spatially varying PSF on the CPU.
+
+  Convolves in-place, one tile at a time with the PSF at the tile's center.
+
+  Parameters
+  ----------
+  grid : `PSFGrid`
+      The PSF grid. Must have the same size as the image.
+  )doc";
+
+static const auto DOC_RawImage_convolve_psf_grid_squared = R"doc(
+  Convolve the image with the element-wise square of a spatially varying PSF
+  (for variance images) on the CPU.
+
+  Convolves in-place, one tile at a time with the squared PSF at the tile's
+  center.
+
+  Parameters
+  ----------
+  grid : `PSFGrid`
+      The PSF grid. Must have the same size as the image.
+  )doc";
+
 } /* namespace pydocs */
 
 #endif /* RAWIMAGE_DOCS */
@@ -7,7 +7,16 @@ static const auto DOC_StackSearch = R"doc(
   )doc";
 
 static const auto DOC_StackSearch_search = R"doc(
-  todo
+  Search each starting pixel for the given candidate trajectories (velocities).
+  Runs on the GPU when there is one and otherwise on the CPU thread pool.
+
+  Parameters
+  ----------
+  candidates : `list` of `Trajectory` or `TrajectoryGenerator`
+      The candidate velocities to test at each pixel. A native
+      ``TrajectoryGenerator`` produces the candidates directly in C++.
+  min_observations : `int`
+      The minimum number of valid observations for a result.
   )doc";
 
 static const auto DOC_StackSearch_set_min_obs = R"doc(
@@ -90,6 +99,17 @@ static const auto DOC_StackSearch_set_start_bounds_y = R"doc(
   Raises a ``RunTimeError`` if invalid bounds are provided (x_max > x_min).
   )doc";
 
+static const auto DOC_StackSearch_set_candidate_reordering = R"doc(
+  Enable or disable reordering the candidate velocities along a space-filling
+  curve of their endpoint offsets before the search. Consecutive evaluations
+  then share most of the psi/phi cache lines. The set of results is unchanged.
+
+  Parameters
+  ----------
+  reorder : `bool`
+      Whether to reorder the candidates.
+  )doc";
+
 static const auto DOC_StackSearch_set_debug = R"doc(
   Set whether to dislpay debug output.
 
@@ -191,12 +211,8 @@ static const auto DOC_StackSearch_clear_results = R"doc(
   )doc";
 
 static const auto DOC_StackSearch_evaluate_single_trajectory = R"doc(
-  Performs the evaluation of a single Trajectory object. Modifies the object
-  in-place.
-
-  Note
-  ----
-  Runs on the CPU, but requires CUDA compiler.
+  Performs the evaluation of a single Trajectory object on the CPU. Modifies
+  the object in-place.
 
   Parameters
   ----------
@@ -205,11 +221,7 @@ static const auto DOC_StackSearch_evaluate_single_trajectory = R"doc(
    )doc";
 
 static const auto DOC_StackSearch_search_linear_trajectory = R"doc(
-  Performs the evaluation of a linear trajectory in pixel space.
-
-  Note
-  ----
-  Runs on the CPU, but requires CUDA compiler.
+  Performs the evaluation of a linear trajectory in pixel space on the CPU.
 
   Parameters
   ----------
@@ -228,5 +240,60 @@ static const auto DOC_StackSearch_search_linear_trajectory = R"doc(
       The trajectory object with statistics set.
    )doc";
 
+static const auto DOC_StackSearch_evaluate_trajectories = R"doc(
+  Score a batch of trajectories on the CPU in parallel. The scores match those
+  of the GPU search (including the ``min_observations`` and sigma-G settings).
+
+  Parameters
+  ----------
+  trjs : `list` of `kb.Trajectory`, `numpy.ndarray` or `list` of tuples
+      The trajectories to evaluate: either Trajectory objects or an N x 4
+      array of (x, y, vx, vy) with the starting pixels truncated to integers.
+
+  Returns
+  -------
+  result : `list` of `kb.Trajectory` or `tuple`
+      For Trajectory objects, copies with the statistics set. For an array,
+      the (lh, flux, obs_count) arrays of the trajectories.
+   )doc";
+
+static const auto DOC_StackSearch_refine_results = R"doc(
+  Refine the best results of the last search on the CPU. Starting from each
+  result, a pattern search scores the neighbouring trajectories (one pixel and
+  one velocity step away) and moves to the best one, halving the velocity step
+  when none is better. The results are then re-sorted by likelihood.
+
+  Parameters
+  ----------
+  num_results : `int`
+      The number of results to refine (from the top of the list).
+  velocity_step : `float`
+      The first velocity step in pixels per day.
+  min_velocity_step : `float`
+      The smallest velocity step in pixels per day.
+  max_iterations : `int`
+      The largest number of steps for each result.
+   )doc";
+
+static const auto DOC_StackSearch_set_psf_variants = R"doc(
+  Search with several PSFs, such as a few widths around the expected seeing.
+  Each PSF is used for all of the images instead of their own PSFs. The psi and
+  phi planes of each image are computed once and convolved with every PSF,
+  giving one psi/phi array per PSF. The search scores each candidate with all
+  of them and keeps the best, recording its position in the list in the
+  result's ``psf_index``. Single evaluations, refinement and the psi/phi curves
+  use the ``psf_index`` of the given trajectory.
+
+  Parameters
+  ----------
+  psfs : `list` of `PSF`
+      The PSF variants (at most 256). An empty list goes back to the images'
+      own PSFs.
+   )doc";
+
+static const auto DOC_StackSearch_get_num_psf_variants = R"doc(
+  Return the number of PSF variants (0 when the images' own PSFs are used).
+   )doc";
+
 }  // namespace pydocs
 #endif /* STACKSEARCH_DOCS */
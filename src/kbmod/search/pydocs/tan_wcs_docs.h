@@ -0,0 +1,140 @@
+#ifndef TAN_WCS_DOCS_
+#define TAN_WCS_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_TanWCS = R"doc(
+  A gnomonic (TAN) projection WCS with optional SIP distortion polynomials.
+  Supports equatorial coordinates with the default LONPOLE of 180 degrees.
+  Pixel coordinates are 0-based (as in astropy's ``pixel_to_world``) and sky
+  coordinates are in degrees. Use ``kbmod.wcs_utils.make_native_tan_wcs`` to
+  build one from an astropy WCS.
+
+  Parameters
+  ----------
+  crpix1 : `float`
+      The (1-based) reference pixel in x.
+  crpix2 : `float`
+      The (1-based) reference pixel in y.
+  crval1 : `float`
+      The RA of the reference pixel (in degrees).
+  crval2 : `float`
+      The declination of the reference pixel (in degrees).
+  cd : `numpy.ndarray`
+      The 2x2 matrix mapping intermediate pixel coordinates to degrees.
+
+  Raises
+  ------
+  RuntimeError:
+      If the CD matrix is singular.
+  )doc";
+
+static const auto DOC_TanWCS_set_sip = R"doc(
+  Set the forward SIP distortion coefficients.
+
+  Parameters
+  ----------
+  a : `numpy.ndarray`
+      The square matrix of A coefficients where entry (p, q) multiplies u^p v^q.
+  b : `numpy.ndarray`
+      The square matrix of B coefficients.
+  )doc";
+
+static const auto DOC_TanWCS_set_inverse_sip = R"doc(
+  Set the inverse SIP distortion coefficients. These are only used as a starting
+  point for the iterative inversion of the forward polynomials.
+
+  Parameters
+  ----------
+  ap : `numpy.ndarray`
+      The square matrix of AP coefficients.
+  bp : `numpy.ndarray`
+      The square matrix of BP coefficients.
+  )doc";
+
+static const auto DOC_TanWCS_pixel_to_sky = R"doc(
+  Convert a single pixel position to (RA, dec) in degrees.
+
+  Parameters
+  ----------
+  x : `float`
+      The x pixel coordinate.
+  y : `float`
+      The y pixel coordinate.
+
+  Returns
+  -------
+  coords : `tuple`
+      The (RA, dec) of the pixel.
+  )doc";
+
+static const auto DOC_TanWCS_sky_to_pixel = R"doc(
+  Convert a single (RA, dec) position, in degrees, to pixel coordinates.
+  Returns NaNs for points that do not project (90 degrees or more from the
+  reference point).
+
+  Parameters
+  ----------
+  ra : `float`
+      The right ascension.
+  dec : `float`
+      The declination.
+
+  Returns
+  -------
+  coords : `tuple`
+      The (x, y) pixel coordinates.
+  )doc";
+
+static const auto DOC_TanWCS_pixels_to_sky = R"doc(
+  Convert arrays of pixel positions to (RA, dec) in degrees in parallel.
+
+  Parameters
+  ----------
+  x : `numpy.ndarray`
+      The x pixel coordinates.
+  y : `numpy.ndarray`
+      The y pixel coordinates.
+
+  Returns
+  -------
+  coords : `tuple` of `numpy.ndarray`
+      The arrays of RA and dec.
+  )doc";
+
+static const auto DOC_TanWCS_sky_to_pixels = R"doc(
+  Convert arrays of (RA, dec), in degrees, to pixel positions in parallel.
+
+  Parameters
+  ----------
+  ra : `numpy.ndarray`
+      The right ascensions.
+  dec : `numpy.ndarray`
+      The declinations.
+
+  Returns
+  -------
+  coords : `tuple` of `numpy.ndarray`
+      The arrays of x and y pixel coordinates.
+  )doc";
+
+static const auto DOC_TanWCS_predict_skypos = R"doc(
+  Predict the (RA, dec) of each trajectory at each time in parallel.
+
+  Parameters
+  ----------
+  trjs : `list` of `Trajectory`
+      The trajectories.
+  dt : `list` of `float`
+      The time of each observation relative to the trajectories' start.
+
+  Returns
+  -------
+  coords : `tuple` of `numpy.ndarray`
+      Two arrays of shape (number of trajectories, number of times) holding
+      the predicted RA and dec.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* TAN_WCS_DOCS_ */
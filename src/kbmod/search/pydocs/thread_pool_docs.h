@@ -0,0 +1,70 @@
+#ifndef THREAD_POOL_DOCS_
+#define THREAD_POOL_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_ThreadPool = R"doc(
+  The process-wide work-stealing thread pool that runs all of the CPU parallel
+  work in the search core. Its size (set by ``num_cores`` in ``run_search``)
+  controls the number of threads used by the C++ code.
+  )doc";
+
+static const auto DOC_ThreadPool_get_num_threads = R"doc(
+  Return the number of threads in the pool, including the calling thread.
+  Defaults to the number of cores the process may run on (its CPU affinity).
+  )doc";
+
+static const auto DOC_ThreadPool_set_num_threads = R"doc(
+  Resize the pool. Must not be called while parallel work is running.
+
+  Parameters
+  ----------
+  num_threads : `int`
+      The number of threads to use, including the calling thread. A value of
+      1 runs everything on the calling thread.
+
+  Raises
+  ------
+  RuntimeError:
+      If num_threads is less than 1.
+  )doc";
+
+static const auto DOC_ThreadPool_get_bind_threads = R"doc(
+  Return whether the pool's workers are bound to cores. Binding only happens
+  on machines with more than one NUMA node.
+  )doc";
+
+static const auto DOC_ThreadPool_set_bind_threads = R"doc(
+  Set whether to bind the pool's workers to cores, spread over the NUMA nodes
+  in order. Restarts the workers. Has no effect on single-node machines.
+
+  Parameters
+  ----------
+  bind : `bool`
+      Whether to bind the workers.
+  )doc";
+
+static const auto DOC_ThreadPool_get_num_numa_nodes = R"doc(
+  Return the number of NUMA nodes with CPUs this process may run on (1 on
+  machines without NUMA information).
+  )doc";
+
+static const auto DOC_ThreadPool_get_deterministic = R"doc(
+  Return whether the parallel reductions give bitwise identical results for
+  any number of threads.
+  )doc";
+
+static const auto DOC_ThreadPool_set_deterministic = R"doc(
+  Set whether the parallel reductions (such as the bounds used to encode the
+  psi and phi values) split their work into fixed blocks combined in a fixed order, which
+  makes the results independent of the number of threads. On by default.
+
+  Parameters
+  ----------
+  enable : `bool`
+      Whether to use deterministic reductions.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* THREAD_POOL_DOCS_ */
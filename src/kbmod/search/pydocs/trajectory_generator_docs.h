@@ -0,0 +1,102 @@
+#ifndef TRAJECTORY_GENERATOR_DOCS_
+#define TRAJECTORY_GENERATOR_DOCS_
+
+namespace pydocs {
+
+static const auto DOC_TrajectoryGenerator = R"doc(
+  The base class for the native generators of candidate trajectories. The
+  candidates are generated in C++ and passed directly to ``StackSearch.search``
+  without creating a Python object per candidate.
+  )doc";
+
+static const auto DOC_TrajectoryGenerator_size = R"doc(
+  Return the number of candidate trajectories produced by the generator.
+  )doc";
+
+static const auto DOC_TrajectoryGenerator_generate = R"doc(
+  Generate all the candidate trajectories.
+
+  Returns
+  -------
+  candidates : `list` of `Trajectory`
+      The candidate trajectories with only the velocities set.
+  )doc";
+
+static const auto DOC_KBMODV1Generator = R"doc(
+  Generate a grid defined by velocities and angles. Produces the same
+  candidates, in the same order, as ``KBMODV1Search``.
+
+  Parameters
+  ----------
+  vel_steps : `int`
+      The number of velocity steps.
+  min_vel : `float`
+      The minimum velocity magnitude (in pixels per day)
+  max_vel : `float`
+      The maximum velocity magnitude (in pixels per day)
+  ang_steps : `int`
+      The number of angle steps.
+  min_ang : `float`
+      The minimum angle (in radians)
+  max_ang : `float`
+      The maximum angle (in radians)
+
+  Raises
+  ------
+  RuntimeError:
+      If the number of steps or the bounds are invalid.
+  )doc";
+
+static const auto DOC_VelocityGridGenerator = R"doc(
+  Generate a grid defined by steps in velocity space. Produces the same
+  candidates, in the same order, as ``VelocityGridSearch``.
+
+  Parameters
+  ----------
+  vx_steps : `int`
+      The number of velocity steps in the x direction.
+  min_vx : `float`
+      The minimum x velocity (in pixels per day)
+  max_vx : `float`
+      The maximum x velocity (in pixels per day)
+  vy_steps : `int`
+      The number of velocity steps in the y direction.
+  min_vy : `float`
+      The minimum y velocity (in pixels per day)
+  max_vy : `float`
+      The maximum y velocity (in pixels per day)
+
+  Raises
+  ------
+  RuntimeError:
+      If the number of steps or the bounds are invalid.
+  )doc";
+
+static const auto DOC_RandomVelocityGenerator = R"doc(
+  Generate velocities sampled uniformly from the given bounds. The sequence
+  is fully determined by the seed.
+
+  Parameters
+  ----------
+  min_vx : `float`
+      The minimum x velocity (in pixels per day)
+  max_vx : `float`
+      The maximum x velocity (in pixels per day)
+  min_vy : `float`
+      The minimum y velocity (in pixels per day)
+  max_vy : `float`
+      The maximum y velocity (in pixels per day)
+  num_samples : `int`
+      The number of samples to generate.
+  seed : `int`
+      The seed of the random number generator.
+
+  Raises
+  ------
+  RuntimeError:
+      If the bounds or the number of samples are invalid.
+  )doc";
+
+}  // namespace pydocs
+
+#endif /* TRAJECTORY_GENERATOR_DOCS_ */
@@ -152,6 +152,22 @@ static const auto DOC_TrajectoryList_sort_by_obs_count = R"doc(
   Raises a ``RuntimeError`` the data is on GPU.
   )doc";
 
+static const auto DOC_TrajectoryList_sort_by_endpoint_locality = R"doc(
+  Sort the data along a space-filling (Z-order) curve of the trajectories'
+  endpoint offsets, ``(vx * time_span, vy * time_span)`` rounded to whole
+  pixels. Consecutive trajectories then read nearby pixels at each time step.
+  The sort is stable. The data must reside on the CPU.
+
+  Parameters
+  ----------
+  time_span : `float`
+      The time between the first and last observation.
+
+  Raises
+  ------
+  Raises a ``RuntimeError`` the data is on GPU or the time span is negative.
+  )doc";
+
 static const auto DOC_TrajectoryList_filter_by_likelihood = R"doc(
   Sort the data in order of decreasing likelihood and drop everything less than
   a given threshold. The data must reside on the CPU.
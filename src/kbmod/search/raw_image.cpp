@@ -4,29 +4,54 @@ namespace search {
 using Index = indexing::Index;
 using Point = indexing::Point;
 
-RawImage::RawImage() : width(0), height(0), obstime(-1.0), image() {}
+// Images at least this large are written with a static partition of their rows,
+// so their pages are first touched on the NUMA nodes of the threads that use them.
+constexpr int64_t FIRST_TOUCH_MIN_PIXELS = 1 << 20;
+
+// Resize an image, advising the kernel to back large images with huge pages
+// before their pages are first touched.
+static void resize_image(Image& image, int64_t height, int64_t width) {
+    image.resize(height, width);
+    if (height * width >= FIRST_TOUCH_MIN_PIXELS) {
+        HugePages::advise(image.data(), image.size() * sizeof(float));
+    }
+}
 
-RawImage::RawImage(Image& img, double obs_time) {
+// Call body(y) for each row, in parallel for large images.
+template <typename Body>
+static void for_each_row(int64_t height, int64_t width, Body body) {
+    if (height * width >= FIRST_TOUCH_MIN_PIXELS) {
+        parallel_for_static(0, height, body);
+    } else {
+        for (int64_t y = 0; y < height; ++y) body(y);
+    }
+}
+
+RawImage::RawImage() : width(0), height(0), obstime(-1.0), image(), memory(MEM_RAW_IMAGE) {}
+
+RawImage::RawImage(Image& img, double obs_time) : memory(MEM_RAW_IMAGE) {
     image = std::move(img);
     height = image.rows();
     width = image.cols();
     obstime = obs_time;
+    update_memory();
 }
 
 RawImage::RawImage(unsigned w, unsigned h, float value, double obs_time)
-        : width(w), height(h), obstime(obs_time) {
-    if (value != 0.0f)
-        image = Image::Constant(height, width, value);
-    else
-        image = Image::Zero(height, width);
+        : width(w), height(h), obstime(obs_time), memory(MEM_RAW_IMAGE) {
+    resize_image(image, height, width);
+    for_each_row(height, width, [&](int64_t y) { image.row(y).setConstant(value); });
+    update_memory();
 }
 
 // Copy constructor
-RawImage::RawImage(const RawImage& old) {
+RawImage::RawImage(const RawImage& old) : memory(old.memory) {
     width = old.get_width();
     height = old.get_height();
-    image = old.get_image();
     obstime = old.get_obstime();
+
+    resize_image(image, height, width);
+    for_each_row(height, width, [&](int64_t y) { image.row(y) = old.image.row(y); });
 }
 
 // Move constructor
@@ -34,7 +59,8 @@ RawImage::RawImage(RawImage&& source)
         : width(source.width),
           height(source.height),
           obstime(source.obstime),
-          image(std::move(source.image)) {}
+          image(std::move(source.image)),
+          memory(std::move(source.memory)) {}
 
 // Copy assignment
 RawImage& RawImage::operator=(const RawImage& source) {
@@ -42,6 +68,7 @@ RawImage& RawImage::operator=(const RawImage& source) {
     height = source.height;
     image = source.image;
     obstime = source.obstime;
+    memory = source.memory;
     return *this;
 }
 
@@ -52,6 +79,11 @@ RawImage& RawImage::operator=(RawImage&& source) {
         height = source.height;
         image = std::move(source.image);
         obstime = source.obstime;
+        memory.set_category(source.memory.get_category());
+
+        // Eigen may swap the buffers instead of freeing ours, so recount both.
+        update_memory();
+        source.update_memory();
     }
     return *this;
 }
@@ -134,7 +166,19 @@ RawImage RawImage::create_stamp(const Point& p, const int radius, const bool kee
     if (radius < 0) throw std::runtime_error("stamp radius must be at least 0");
 
     const int dim = radius * 2 + 1;
-    Image stamp = Image::Constant(dim, dim, NO_DATA);
+    Image stamp(dim, dim);
+    fill_stamp(p, radius, keep_no_data, stamp);
+
+    RawImage result = RawImage(stamp);
+    result.set_memory_category(MEM_STAMPS);
+    return result;
+}
+
+void RawImage::fill_stamp(const Point& p, const int radius, const bool keep_no_data, ImageRef stamp) const {
+    if (radius < 0) throw std::runtime_error("stamp radius must be at least 0");
+    const int dim = radius * 2 + 1;
+    if (stamp.rows() != dim || stamp.cols() != dim) throw std::runtime_error("Wrong size stamp buffer.");
+    stamp.setConstant(NO_DATA);
 
     // Eigen gets unhappy if the stamp does not overlap at all. In this case, skip
     // the computation and leave the entire stamp set to NO_DATA.
@@ -148,9 +192,13 @@ RawImage RawImage::create_stamp(const Point& p, const int radius, const bool kee
         stamp.block(anchor.i, anchor.j, h, w) = image.block(corner.i, corner.j, h, w);
     }
 
-    RawImage result = RawImage(stamp);
-    if (!keep_no_data) result.replace_masked_values(0.0);
-    return result;
+    if (!keep_no_data) {
+        for (int y = 0; y < dim; ++y) {
+            for (int x = 0; x < dim; ++x) {
+                if (!pixel_value_valid(stamp(y, x))) stamp(y, x) = 0.0;
+            }
+        }
+    }
 }
 
 inline void RawImage::add(const Index& idx, const float value) {
@@ -169,14 +217,25 @@ void RawImage::interpolated_add(const Point& p, const float value) {
 }
 
 std::array<float, 2> RawImage::compute_bounds() const {
-    float min_val = FLT_MAX;
-    float max_val = -FLT_MAX;
-
-    for (auto elem : image.reshaped())
-        if (pixel_value_valid(elem)) {
-            min_val = std::min(min_val, elem);
-            max_val = std::max(max_val, elem);
-        }
+    const float* pixels = image.data();
+    std::array<float, 2> bounds = parallel_reduce(
+            0, image.size(), std::array<float, 2>{FLT_MAX, -FLT_MAX},
+            [pixels](int64_t lo, int64_t hi) {
+                float min_val = FLT_MAX;
+                float max_val = -FLT_MAX;
+                for (int64_t p = lo; p < hi; ++p) {
+                    if (pixel_value_valid(pixels[p])) {
+                        min_val = std::min(min_val, pixels[p]);
+                        max_val = std::max(max_val, pixels[p]);
+                    }
+                }
+                return std::array<float, 2>{min_val, max_val};
+            },
+            [](const std::array<float, 2>& a, const std::array<float, 2>& b) {
+                return std::array<float, 2>{std::min(a[0], b[0]), std::max(a[1], b[1])};
+            });
+    const float min_val = bounds[0];
+    const float max_val = bounds[1];
 
     // Assert that we have seen at least some valid data.
     assert(max_val != -FLT_MAX);
@@ -185,42 +244,83 @@ std::array<float, 2> RawImage::compute_bounds() const {
     return {min_val, max_val};
 }
 
-void RawImage::convolve_cpu(PSF& psf) {
-    Image result = Image::Zero(height, width);
+// The convolution of the pixel (x, y) of image with a (2*psf_rad+1)^2 kernel,
+// renormalized for the neighbours without valid data.
+static inline float convolve_pixel(const Image& image, int x, int y, const float* kernel, int psf_rad,
+                                   float psf_total) {
+    const int width = image.cols();
+    const int height = image.rows();
+    const int psf_dim = 2 * psf_rad + 1;
+
+    // Pixels with invalid data (e.g. NO_DATA or NaN) do not change.
+    if (!pixel_value_valid(image(y, x))) return image(y, x);
+
+    float sum = 0.0;
+    float psf_portion = 0.0;
+    for (int j = -psf_rad; j <= psf_rad; j++) {
+        for (int i = -psf_rad; i <= psf_rad; i++) {
+            if ((x + i >= 0) && (x + i < width) && (y + j >= 0) && (y + j < height)) {
+                float current_pixel = image(y + j, x + i);
+                // note that convention for index access is flipped for PSF
+                if (pixel_value_valid(current_pixel)) {
+                    float current_psf = kernel[(j + psf_rad) * psf_dim + i + psf_rad];
+                    psf_portion += current_psf;
+                    sum += current_pixel * current_psf;
+                }
+            }
+        }  // for i
+    }      // for j
+    return (psf_portion == 0) ? NO_DATA : (sum * psf_total) / psf_portion;
+}
 
-    const int psf_rad = psf.get_radius();
-    const float psf_total = psf.get_sum();
+void RawImage::convolve_kernel_cpu(const float* kernel, int psf_rad, float psf_total) {
+    // Every pixel of the result is written below.
+    Image result;
+    resize_image(result, height, width);
 
-    for (int y = 0; y < height; ++y) {
+    for_each_row(height, width, [&](int64_t y) {
         for (int x = 0; x < width; ++x) {
-            // Pixels with invalid data (e.g. NO_DATA or NaN) do not change.
-            if (!pixel_value_valid(image(y, x))) {
-                result(y, x) = image(y, x);
-                continue;
-            }
+            result(y, x) = convolve_pixel(image, x, y, kernel, psf_rad, psf_total);
+        }
+    });
+    image = std::move(result);
+}
 
-            float sum = 0.0;
-            float psf_portion = 0.0;
-            for (int j = -psf_rad; j <= psf_rad; j++) {
-                for (int i = -psf_rad; i <= psf_rad; i++) {
-                    if ((x + i >= 0) && (x + i < width) && (y + j >= 0) && (y + j < height)) {
-                        float current_pixel = image(y + j, x + i);
-                        // note that convention for index access is flipped for PSF
-                        if (pixel_value_valid(current_pixel)) {
-                            float current_psf = psf.get_value(i + psf_rad, j + psf_rad);
-                            psf_portion += current_psf;
-                            sum += current_pixel * current_psf;
-                        }
-                    }
-                }  // for i
-            }      // for j
-            if (psf_portion == 0) {
-                result(y, x) = NO_DATA;
-            } else {
-                result(y, x) = (sum * psf_total) / psf_portion;
+void RawImage::convolve_grid(const PSFGrid& grid, bool squared) {
+    if (grid.get_width() != (int)width || grid.get_height() != (int)height) {
+        throw std::runtime_error("PSF grid size does not match the image size.");
+    }
+    ScopedTimer phase_timer("convolve_psf_grid");
+    PerfCounterScope perf_counters(phase_timer.get_path());
+
+    const std::vector<int> bounds_x = grid.get_tile_bounds_x();
+    const std::vector<int> bounds_y = grid.get_tile_bounds_y();
+    const int64_t tiles_per_row = bounds_x.size() - 1;
+    const int64_t num_tiles = tiles_per_row * (bounds_y.size() - 1);
+    const int max_dim = 2 * grid.get_max_radius() + 1;
+
+    // Each tile reads its halo from the whole source image, so the pixels near
+    // a tile's edge see their real neighbours without copying any overlap.
+    Image result;
+    resize_image(result, height, width);
+    parallel_for(0, num_tiles, [&](int64_t t) {
+        const int x0 = bounds_x[t % tiles_per_row];
+        const int x1 = bounds_x[t % tiles_per_row + 1];
+        const int y0 = bounds_y[t / tiles_per_row];
+        const int y1 = bounds_y[t / tiles_per_row + 1];
+
+        ArenaScope scratch;
+        float* kernel = scratch.arena().allocate_array<float>(max_dim * max_dim);
+        int radius = 0;
+        const float kernel_sum =
+                grid.fill_kernel(0.5f * (x0 + x1 - 1), 0.5f * (y0 + y1 - 1), squared, kernel, radius);
+
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                result(y, x) = convolve_pixel(image, x, y, kernel, radius, kernel_sum);
             }
-        }  // for x
-    }      // for y
+        }
+    });
     image = std::move(result);
 }
 
@@ -231,15 +331,45 @@ extern "C" void deviceConvolve(float* source_img, float* result_img, int width,
                                int psf_size, int psf_dim, int psf_radius, float psf_sum);
 #endif
 
-void RawImage::convolve(PSF psf) {
+void RawImage::convolve_kernel(const float* kernel, int radius, float kernel_sum) {
+    ScopedTimer phase_timer("convolve");
+    PerfCounterScope perf_counters(phase_timer.get_path());
 #ifdef HAVE_CUDA
-    deviceConvolve(image.data(), image.data(), get_width(), get_height(), psf.data(), psf.get_size(),
-                   psf.get_dim(), psf.get_radius(), psf.get_sum());
+    const int dim = 2 * radius + 1;
+    deviceConvolve(image.data(), image.data(), get_width(), get_height(), const_cast<float*>(kernel),
+                   dim * dim, dim, radius, kernel_sum);
 #else
-    convolve_cpu(psf);
+    convolve_kernel_cpu(kernel, radius, kernel_sum);
 #endif
 }
 
+void RawImage::convolve(const PSF& psf) {
+    convolve_kernel(psf.get_kernel().data(), psf.get_radius(), psf.get_sum());
+}
+
+void RawImage::convolve_cpu(const PSF& psf) {
+    convolve_kernel_cpu(psf.get_kernel().data(), psf.get_radius(), psf.get_sum());
+}
+
+void RawImage::convolve_squared(const PSF& psf) {
+    // Square the kernel in scratch space instead of copying the PSF. The sum is
+    // accumulated in the same order as PSF::square_psf().
+    ArenaScope scratch;
+    const int size = psf.get_size();
+    const std::vector<float>& kernel = psf.get_kernel();
+    float* squared = scratch.arena().allocate_array<float>(size);
+    float squared_sum = 0.0;
+    for (int i = 0; i < size; ++i) {
+        squared[i] = kernel[i] * kernel[i];
+        squared_sum += squared[i];
+    }
+    convolve_kernel(squared, psf.get_radius(), squared_sum);
+}
+
+void RawImage::convolve_psf_grid(const PSFGrid& grid) { convolve_grid(grid, false); }
+
+void RawImage::convolve_psf_grid_squared(const PSFGrid& grid) { convolve_grid(grid, true); }
+
 void RawImage::apply_mask(int flags, const RawImage& mask) {
     for (unsigned int j = 0; j < height; ++j) {
         for (unsigned int i = 0; i < width; ++i) {
@@ -353,106 +483,118 @@ bool RawImage::center_is_local_max(double flux_thresh, bool local_max) const {
     return center_val / sum >= flux_thresh;
 }
 
-// it makes no sense to return RawImage here because there is no
-// obstime by definition of operation, but I guess it's out of
-// scope for this PR because it requires updating layered_image
-// and image stack
-RawImage create_median_image(const std::vector<RawImage>& images) {
-    int num_images = images.size();
-    assert(num_images > 0);
-
-    int width = images[0].get_width();
-    int height = images[0].get_height();
-    for (auto& img : images) {
-        assert(img.get_width() == width and img.get_height() == height);
-    }
+ImageMap create_arena_image(Arena& arena, int height, int width) {
+    return ImageMap(arena.allocate_array<float>((uint64_t)height * width), height, width);
+}
 
-    Image result = Image::Zero(height, width);
+void median_of_images(const float* const* images, int num_images, int num_pixels, float* result) {
+    ArenaScope scratch;
+    float* pix_array = scratch.arena().allocate_array<float>(num_images);
 
-    std::vector<float> pix_array(num_images);
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int num_unmasked = 0;
-            for (auto& img : images) {
-                // Only used the unmasked array.
-                if (img.pixel_has_data({y, x})) {
-                    pix_array[num_unmasked] = img.get_pixel({y, x});
-                    num_unmasked += 1;
-                }
+    for (int p = 0; p < num_pixels; ++p) {
+        int num_unmasked = 0;
+        for (int i = 0; i < num_images; ++i) {
+            // Only used the unmasked array.
+            if (pixel_value_valid(images[i][p])) {
+                pix_array[num_unmasked] = images[i][p];
+                num_unmasked += 1;
             }
+        }
 
-            if (num_unmasked > 0) {
-                std::sort(pix_array.begin(), pix_array.begin() + num_unmasked);
-
-                // If we have an even number of elements, take the mean of the two
-                // middle ones.
-                int median_ind = num_unmasked / 2;
-                if (num_unmasked % 2 == 0) {
-                    float ave_middle = (pix_array[median_ind] + pix_array[median_ind - 1]) / 2.0;
-                    result(y, x) = ave_middle;
-                } else {
-                    result(y, x) = pix_array[median_ind];
-                }
+        if (num_unmasked > 0) {
+            std::sort(pix_array, pix_array + num_unmasked);
+
+            // If we have an even number of elements, take the mean of the two
+            // middle ones.
+            int median_ind = num_unmasked / 2;
+            if (num_unmasked % 2 == 0) {
+                result[p] = (pix_array[median_ind] + pix_array[median_ind - 1]) / 2.0;
             } else {
-                // We use a 0.0 value if there is no data to allow for visualization
-                // and value based filtering.
-                result(y, x) = 0.0;
+                result[p] = pix_array[median_ind];
             }
-        }  // for x
-    }      // for y
-    return RawImage(result);
+        } else {
+            // We use a 0.0 value if there is no data to allow for visualization
+            // and value based filtering.
+            result[p] = 0.0;
+        }
+    }
 }
 
-RawImage create_summed_image(const std::vector<RawImage>& images) {
-    int num_images = images.size();
-    assert(num_images > 0);
-
-    int width = images[0].get_width();
-    int height = images[0].get_height();
-    for (auto& img : images) assert(img.get_width() == width and img.get_height() == height);
-
-    Image result = Image::Zero(height, width);
-    for (auto& img : images) {
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                if (img.pixel_has_data({y, x})) {
-                    result(y, x) += img.get_pixel({y, x});
-                }
+void mean_of_images(const float* const* images, int num_images, int num_pixels, float* result) {
+    for (int p = 0; p < num_pixels; ++p) {
+        float sum = 0.0;
+        float count = 0.0;
+        for (int i = 0; i < num_images; ++i) {
+            if (pixel_value_valid(images[i][p])) {
+                count += 1.0;
+                sum += images[i][p];
             }
         }
+        result[p] = (count > 0.0) ? sum / count : 0.0;  // use 0 for visualization purposes
     }
-    return RawImage(result);
 }
 
-RawImage create_mean_image(const std::vector<RawImage>& images) {
+void sum_of_images(const float* const* images, int num_images, int num_pixels, float* result) {
+    for (int p = 0; p < num_pixels; ++p) {
+        float sum = 0.0;
+        for (int i = 0; i < num_images; ++i) {
+            if (pixel_value_valid(images[i][p])) sum += images[i][p];
+        }
+        result[p] = sum;
+    }
+}
+
+// Check that the images have the same size and list their pixels in an arena.
+static const float** image_pixel_pointers(const std::vector<RawImage>& images, Arena& arena) {
     int num_images = images.size();
-    assert(num_images > 0);
+    assertm(num_images > 0, "No images to combine.");
+
+    const float** pixels = arena.allocate_array<const float*>(num_images);
+    for (int i = 0; i < num_images; ++i) {
+        assertm(images[i].get_width() == images[0].get_width() and
+                        images[i].get_height() == images[0].get_height(),
+                "Can not combine images with different dimensions.");
+        pixels[i] = images[i].get_image().data();
+    }
+    return pixels;
+}
 
-    int width = images[0].get_width();
-    int height = images[0].get_height();
-    for (auto& img : images)
-        assertm(img.get_width() == width and img.get_height() == height,
-                "Can not sum images with different dimensions.");
+// Coadd the images with combine(images, num_images, num_pixels, result) over
+// blocks of pixels in parallel. The blocks are the fixed ones of the deterministic
+// reductions and each pixel is combined over the images in order, so the result
+// does not depend on the number of threads.
+template <typename Combine>
+static RawImage coadd_images(const std::vector<RawImage>& images, Combine combine) {
+    ArenaScope scratch;
+    const float** pixels = image_pixel_pointers(images, scratch.arena());
+    const int num_images = images.size();
+    Image result(images[0].get_height(), images[0].get_width());
+    float* result_pixels = result.data();
+
+    std::vector<int64_t> bounds = reduction_range(0, result.size());
+    parallel_for(0, bounds.size() - 1, [&](int64_t c) {
+        ArenaScope block_scratch;
+        const float** block = block_scratch.arena().allocate_array<const float*>(num_images);
+        for (int i = 0; i < num_images; ++i) block[i] = pixels[i] + bounds[c];
+        combine(block, num_images, bounds[c + 1] - bounds[c], result_pixels + bounds[c]);
+    });
+    return RawImage(result);
+}
 
-    Image result = Image::Zero(height, width);
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float sum = 0.0;
-            float count = 0.0;
-            for (auto& img : images) {
-                if (img.pixel_has_data({y, x})) {
-                    count += 1.0;
-                    sum += img.get_pixel({y, x});
-                }
-            }
+// it makes no sense to return RawImage here because there is no
+// obstime by definition of operation, but I guess it's out of
+// scope for this PR because it requires updating layered_image
+// and image stack
+RawImage create_median_image(const std::vector<RawImage>& images) {
+    return coadd_images(images, median_of_images);
+}
 
-            if (count > 0.0)
-                result(y, x) = sum / count;
-            else
-                result(y, x) = 0.0;  // use 0 for visualization purposes
-        }                            // for x
-    }                                // for y
-    return RawImage(result);
+RawImage create_summed_image(const std::vector<RawImage>& images) {
+    return coadd_images(images, sum_of_images);
+}
+
+RawImage create_mean_image(const std::vector<RawImage>& images) {
+    return coadd_images(images, mean_of_images);
 }
 
 #ifdef Py_PYTHON_H
@@ -530,6 +672,9 @@ static void raw_image_bindings(py::module& m) {
             .def("apply_mask", &rie::apply_mask, pydocs::DOC_RawImage_apply_mask)
             .def("convolve_gpu", &rie::convolve, pydocs::DOC_RawImage_convolve_gpu)
             .def("convolve_cpu", &rie::convolve_cpu, pydocs::DOC_RawImage_convolve_cpu)
+            .def("convolve_psf_grid", &rie::convolve_psf_grid, pydocs::DOC_RawImage_convolve_psf_grid)
+            .def("convolve_psf_grid_squared", &rie::convolve_psf_grid_squared,
+                 pydocs::DOC_RawImage_convolve_psf_grid_squared)
             // python interface adapters
             .def("create_stamp",
                  [](rie& cls, float x, float y, int radius, bool keep_no_data) {
@@ -9,10 +9,17 @@
 
 #include <Eigen/Core>
 
+#include "arena.h"
 #include "common.h"
 #include "geom.h"
+#include "huge_pages.h"
+#include "instrumentation.h"
+#include "memory_tracker.h"
+#include "perf_counters.h"
 #include "psf.h"
+#include "psf_grid.h"
 #include "pydocs/raw_image_docs.h"
+#include "thread_pool.h"
 
 namespace search {
 using Index = indexing::Index;
@@ -23,6 +30,9 @@ using ImageI = Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajo
 using ImageRef = Eigen::Ref<Image>;
 using ImageIRef = Eigen::Ref<Image>;
 
+// An image whose pixels live in memory owned elsewhere, such as an Arena.
+using ImageMap = Eigen::Map<Image>;
+
 class RawImage {
 public:
     explicit RawImage();
@@ -41,7 +51,14 @@ public:
     unsigned get_npixels() const { return width * height; }
     const Image& get_image() const { return image; }
     Image& get_image() { return image; }
-    void set_image(Image& other) { image = other; }
+    void set_image(Image& other) {
+        image = other;
+        update_memory();
+    }
+
+    // The memory category the pixels are accounted under (raw_image by default).
+    MemoryCategory get_memory_category() const { return memory.get_category(); }
+    void set_memory_category(MemoryCategory category) { memory.set_category(category); }
 
     inline bool contains(const Index& idx) const {
         return idx.i >= 0 && idx.i < height && idx.j >= 0 && idx.j < width;
@@ -92,6 +109,10 @@ public:
     // keep_no_data indicates whether to use the NO_DATA flag or replace with 0.0.
     RawImage create_stamp(const Point& p, const int radius, const bool keep_no_data) const;
 
+    // Write the stamp into an existing (2*radius+1) x (2*radius+1) image, such as
+    // one from create_arena_image().
+    void fill_stamp(const Point& p, const int radius, const bool keep_no_data, ImageRef stamp) const;
+
     // pixel modifiers
     void add(const Index& idx, const float value);
     void add(const Point& p, const float value);
@@ -101,8 +122,17 @@ public:
     std::array<float, 2> compute_bounds() const;
 
     // Convolve the image with a point spread function.
-    void convolve(PSF psf);
-    void convolve_cpu(PSF& psf);
+    void convolve(const PSF& psf);
+    void convolve_cpu(const PSF& psf);
+
+    // Convolve with the element-wise square of the PSF (for variance images)
+    // without copying the PSF.
+    void convolve_squared(const PSF& psf);
+
+    // Convolve with a spatially varying PSF (or its square), tile by tile on the
+    // CPU. The grid must have the size of the image.
+    void convolve_psf_grid(const PSFGrid& grid);
+    void convolve_psf_grid_squared(const PSFGrid& grid);
 
     // Masks out the array of the image where 'flags' is a bit vector of mask flags
     // to apply (use 0xFFFFFF to apply all flags).
@@ -124,12 +154,30 @@ public:
     virtual ~RawImage(){};
 
 private:
+    void update_memory() { memory.set((uint64_t)image.size() * sizeof(float)); }
+
+    // Convolve with a (2*radius+1) x (2*radius+1) kernel whose values sum to kernel_sum.
+    void convolve_kernel(const float* kernel, int radius, float kernel_sum);
+    void convolve_kernel_cpu(const float* kernel, int radius, float kernel_sum);
+    void convolve_grid(const PSFGrid& grid, bool squared);
+
     unsigned width;
     unsigned height;
     double obstime;
     Image image;
+    TrackedBytes memory;
 };
 
+// Allocate an uninitialized height x width image in an arena.
+ImageMap create_arena_image(Arena& arena, int height, int width);
+
+// Combine images of num_pixels pixels each into result, skipping the pixels
+// without valid data (and using 0.0 where no image has data). The median's
+// scratch space comes from the calling thread's arena.
+void median_of_images(const float* const* images, int num_images, int num_pixels, float* result);
+void mean_of_images(const float* const* images, int num_images, int num_pixels, float* result);
+void sum_of_images(const float* const* images, int num_images, int num_pixels, float* result);
+
 // Helper functions for creating composite images.
 RawImage create_median_image(const std::vector<RawImage>& images);
 RawImage create_summed_image(const std::vector<RawImage>& images);
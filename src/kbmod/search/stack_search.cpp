@@ -4,9 +4,6 @@ namespace search {
 #ifdef HAVE_CUDA
 extern "C" void deviceSearchFilter(PsiPhiArray& psi_phi_array, SearchParameters params,
                                    TrajectoryList& trj_to_search, TrajectoryList& results);
-
-extern "C" void evaluateTrajectory(PsiPhiArrayMeta psi_phi_meta, void* psi_phi_vect, float* image_times,
-                                   SearchParameters params, Trajectory* candidate);
 #endif
 
 // This logger is often used in this module so we might as well declare it
@@ -18,6 +15,7 @@ auto rs_logger = logging::getLogger("kbmod.search.run_search");
 StackSearch::StackSearch(ImageStack& imstack) : stack(imstack), results(0) {
     debug_info = false;
     psi_phi_generated = false;
+    reorder_candidates = false;
 
     // Default The Thresholds.
     params.min_observations = 0;
@@ -101,6 +99,14 @@ void StackSearch::set_start_bounds_y(int y_min, int y_max) {
     params.y_start_max = y_max;
 }
 
+void StackSearch::set_candidate_reordering(bool reorder) { reorder_candidates = reorder; }
+
+void StackSearch::set_psf_variants(const std::vector<PSF>& psfs) {
+    if (psfs.size() > 256) throw std::runtime_error("At most 256 PSF variants are supported.");
+    clear_psi_phi();
+    psf_variants = psfs;
+}
+
 // --------------------------------------------
 // Data precomputation functions
 // --------------------------------------------
@@ -108,7 +114,25 @@ void StackSearch::set_start_bounds_y(int y_min, int y_max) {
 void StackSearch::prepare_psi_phi() {
     if (!psi_phi_generated) {
         DebugTimer timer = DebugTimer("preparing Psi and Phi images", rs_logger);
-        fill_psi_phi_array_from_image_stack(psi_phi_array, stack, params.encode_num_bytes, debug_info);
+        ScopedTimer phase_timer("prepare_psi_phi");
+        PerfCounterScope perf_counters(phase_timer.get_path());
+        if (psf_variants.empty()) {
+            fill_psi_phi_array_from_image_stack(psi_phi_array, stack, params.encode_num_bytes, debug_info);
+        } else {
+            for (size_t p = 1; p < psf_variants.size(); ++p) variant_psi_phi.emplace_back(new PsiPhiArray());
+            fill_psi_phi_arrays_for_psfs(get_all_psi_phi(), stack, psf_variants, params.encode_num_bytes,
+                                         debug_info);
+        }
+        for (PsiPhiArray* array : get_all_psi_phi()) {
+            add_counter("bytes_allocated", array->get_total_array_size());
+        }
+
+        // Record whether the kernel gave us the huge pages we asked for.
+        uint64_t huge_page_bytes = psi_phi_array.get_cpu_huge_page_bytes();
+        add_counter("huge_page_bytes", huge_page_bytes);
+        LOG_DEBUG(rs_logger, std::to_string(huge_page_bytes) + " of " +
+                                     std::to_string(psi_phi_array.get_total_array_size()) +
+                                     " bytes of the PsiPhi array are on huge pages.");
         timer.stop();
         psi_phi_generated = true;
     }
@@ -123,24 +147,44 @@ void StackSearch::prepare_psi_phi() {
 void StackSearch::clear_psi_phi() {
     if (psi_phi_generated) {
         psi_phi_array.clear();
+        variant_psi_phi.clear();
         psi_phi_generated = false;
     }
 }
 
+PsiPhiArray& StackSearch::get_psi_phi(int psf_index) {
+    if (psf_index == 0) return psi_phi_array;
+    if (psf_index < 0 || psf_index > (int)variant_psi_phi.size()) {
+        throw std::runtime_error("Invalid PSF variant " + std::to_string(psf_index));
+    }
+    return *variant_psi_phi[psf_index - 1];
+}
+
+std::vector<PsiPhiArray*> StackSearch::get_all_psi_phi() {
+    std::vector<PsiPhiArray*> arrays = {&psi_phi_array};
+    for (auto& array : variant_psi_phi) arrays.push_back(array.get());
+    return arrays;
+}
+
 // --------------------------------------------
 // Core search functions
 // --------------------------------------------
 
 void StackSearch::evaluate_single_trajectory(Trajectory& trj) {
     prepare_psi_phi();
-    if (!psi_phi_array.cpu_array_allocated()) std::runtime_error("Data not allocated.");
+    evaluate_trajectory_cpu(get_psi_phi(trj.psf_index), params, trj);
+}
 
-#ifdef HAVE_CUDA
-    evaluateTrajectory(psi_phi_array.get_meta_data(), psi_phi_array.get_cpu_array_ptr(),
-                       psi_phi_array.get_cpu_time_array_ptr(), params, &trj);
-#else
-    throw std::runtime_error("CUDA installation is needed for single trajectory search.");
-#endif
+void StackSearch::evaluate_trajectories(std::vector<Trajectory>& trjs) {
+    prepare_psi_phi();
+    if (variant_psi_phi.empty()) {
+        evaluate_trajectories_cpu(psi_phi_array, params, trjs.data(), trjs.size());
+    } else {
+        // Each trajectory is scored with its own variant.
+        parallel_for(0, trjs.size(), [&](int64_t i) {
+            evaluate_trajectory_cpu(get_psi_phi(trjs[i].psf_index), params, trjs[i]);
+        });
+    }
 }
 
 Trajectory StackSearch::search_linear_trajectory(short x, short y, float vx, float vy) {
@@ -156,75 +200,211 @@ Trajectory StackSearch::search_linear_trajectory(short x, short y, float vx, flo
 }
 
 void StackSearch::search(std::vector<Trajectory>& search_list, int min_observations) {
+    TrajectoryList candidates(search_list);
+    search_candidates(candidates, min_observations);
+}
+
+void StackSearch::search(const TrajectoryGenerator& generator, int min_observations) {
+    DebugTimer gen_timer = DebugTimer("generating candidates", rs_logger);
+    ScopedTimer phase_timer("generate_candidates");
+    LOG_INFO(rs_logger, generator.to_string());
+    TrajectoryList candidates(0);
+    generator.fill_list(candidates);
+    phase_timer.stop();
+    gen_timer.stop();
+
+    search_candidates(candidates, min_observations);
+}
+
+void StackSearch::search_candidates(TrajectoryList& search_list, int min_observations) {
     DebugTimer core_timer = DebugTimer("core search", rs_logger);
+    ScopedTimer core_phase("core_search");
 
     DebugTimer psi_phi_timer = DebugTimer("creating psi/phi buffers", rs_logger);
+    ScopedTimer psi_phi_phase("psi_phi");
     prepare_psi_phi();
+#ifdef HAVE_CUDA
     psi_phi_array.move_to_gpu();
+#endif
+    psi_phi_phase.stop();
     psi_phi_timer.stop();
 
-    // Allocate a vector for the results and move it onto the GPU.
-    int search_width = params.x_start_max - params.x_start_min;
-    int search_height = params.y_start_max - params.y_start_min;
-    int num_search_pixels = search_width * search_height;
-    int max_results = num_search_pixels * RESULTS_PER_PIXEL;
-    // staple C++
-    std::stringstream logmsg;
-    logmsg << "Searching X=[" << params.x_start_min << ", " << params.x_start_max << "] "
-           << "Y=[" << params.y_start_min << ", " << params.y_start_max << "]\n"
-           << "Allocating space for " << max_results << " results.";
-    rs_logger->info(logmsg.str());
-
-    results.resize(max_results);
+    // Allocate a vector for the results (on the GPU if there is one).
+    allocate_results();
+#ifdef HAVE_CUDA
     results.move_to_gpu();
+#endif
 
-    // Allocate space for the search list and move that to the GPU.
-    int num_to_search = search_list.size();
-
-    logmsg.str("");
-    logmsg << search_list.size() << " trajectories...";
-    rs_logger->info(logmsg.str());
+    // Optionally order the candidates so consecutive evaluations touch nearby psi/phi
+    // pixels. The results are reported by velocity, so the order does not change them.
+    if (reorder_candidates && psi_phi_array.get_num_times() > 0) {
+        DebugTimer reorder_timer = DebugTimer("reordering candidates", rs_logger);
+        ScopedTimer reorder_phase("reorder_candidates");
+        float time_span = 0.0;
+        for (int i = 0; i < psi_phi_array.get_num_times(); ++i) {
+            time_span = std::max(time_span, std::fabs(psi_phi_array.read_time(i)));
+        }
+        search_list.sort_by_endpoint_locality(time_span);
+        reorder_timer.stop();
+    }
 
-    TrajectoryList gpu_search_list(search_list);
-    gpu_search_list.move_to_gpu();
+    LOG_INFO(rs_logger, std::to_string(search_list.get_size()) + " trajectories...");
 
     // Set the minimum number of observations.
     params.min_observations = min_observations;
 
-    // Do the actual search on the GPU.
+    // Do the actual search on the GPU or, without one, on the thread pool.
     DebugTimer search_timer = DebugTimer("search execution", rs_logger);
+    ScopedTimer search_phase("evaluate");
+    {
+        PerfCounterScope perf_counters(search_phase.get_path());
 #ifdef HAVE_CUDA
-    deviceSearchFilter(psi_phi_array, params, gpu_search_list, results);
+        search_list.move_to_gpu();
+        deviceSearchFilter(psi_phi_array, params, search_list, results);
+
+        // Search the other PSF variants one at a time and keep the best results of each pixel.
+        if (!variant_psi_phi.empty()) {
+            results.move_to_cpu();
+            TrajectoryList variant_results(results.get_size());
+            for (size_t v = 0; v < variant_psi_phi.size(); ++v) {
+                variant_psi_phi[v]->move_to_gpu();
+                variant_results.move_to_gpu();
+                deviceSearchFilter(*variant_psi_phi[v], params, search_list, variant_results);
+                variant_psi_phi[v]->clear_from_gpu();
+                variant_results.move_to_cpu();
+
+                std::vector<Trajectory>& variant_list = variant_results.get_list();
+                for (Trajectory& trj : variant_list) trj.psf_index = v + 1;
+                merge_pixel_results(results.get_list().data(), variant_list.data(),
+                                    results.get_size() / RESULTS_PER_PIXEL);
+            }
+        }
 #else
-    throw std::runtime_error("Non-GPU search is not implemented.");
+        const std::vector<Trajectory>& candidates = search_list.get_list();
+        const int search_height = get_search_height();
+        const int image_height = psi_phi_array.get_height();
+        ThreadPool& pool = ThreadPool::instance();
+        if (pool.get_bind_threads() && pool.get_num_numa_nodes() > 1 && image_height > 0) {
+            // Search each starting row from the worker whose static band of image rows
+            // first touched (and so placed) that row of the psi/phi data. The rows above
+            // and below the image go to the first and last bands.
+            parallel_for_static(0, image_height, [&](int64_t y) {
+                int row_begin = (y == 0) ? 0 : y - params.y_start_min;
+                int row_end = (y == image_height - 1) ? search_height : y + 1 - params.y_start_min;
+                row_begin = std::clamp(row_begin, 0, search_height);
+                row_end = std::clamp(row_end, 0, search_height);
+                if (row_begin < row_end) search_rows(candidates, row_begin, row_end);
+            });
+        } else {
+            parallel_for(0, search_height, [&](int64_t row) { search_rows(candidates, row, row + 1); });
+        }
 #endif
+    }
+    search_phase.stop();
     search_timer.stop();
 
+    // Each candidate is evaluated at every starting pixel, reading one psi/phi pair per time.
+    const uint64_t num_search_pixels = (uint64_t)get_search_width() * get_search_height();
+    const uint64_t num_evaluated = (uint64_t)search_list.get_size() * num_search_pixels;
+    add_counter("trajectories_evaluated", num_evaluated);
+    add_counter("pixels_read", num_evaluated * psi_phi_array.get_num_times());
+
+#ifdef HAVE_CUDA
     // Move data back to CPU to unallocate GPU space (this will happen automatically
-    // for gpu_search_list when the object goes out of scope, but we do it explicitly here).
+    // for search_list when the object goes out of scope, but we do it explicitly here).
     psi_phi_array.clear_from_gpu();
     results.move_to_cpu();
-    gpu_search_list.move_to_cpu();
+    search_list.move_to_cpu();
+#endif
+
+    sort_results();
+    core_timer.stop();
+}
 
+void StackSearch::allocate_results() {
+    const int max_results = get_search_width() * get_search_height() * RESULTS_PER_PIXEL;
+    LOG_INFO(rs_logger, "Searching X=[" + std::to_string(params.x_start_min) + ", " +
+                                std::to_string(params.x_start_max) + "] Y=[" +
+                                std::to_string(params.y_start_min) + ", " +
+                                std::to_string(params.y_start_max) + "]\nAllocating space for " +
+                                std::to_string(max_results) + " results.");
+    results.resize(max_results);
+    add_counter("bytes_allocated", (uint64_t)max_results * sizeof(Trajectory));
+}
+
+void StackSearch::sort_results() {
     DebugTimer sort_timer = DebugTimer("Sorting results", rs_logger);
+    ScopedTimer sort_phase("sort_results");
     results.sort_by_likelihood();
+    sort_phase.stop();
     sort_timer.stop();
-    core_timer.stop();
+    add_counter("results_kept", results.get_size());
+}
+
+int StackSearch::start_cpu_search(int min_observations) {
+    prepare_psi_phi();
+    params.min_observations = min_observations;
+    allocate_results();
+    return get_search_height();
+}
+
+void StackSearch::search_rows(const std::vector<Trajectory>& candidates, int row_begin, int row_end) {
+    if (results.on_gpu()) throw std::runtime_error("Results must be on the CPU for a CPU search.");
+    const uint64_t num_results = (uint64_t)get_search_width() * get_search_height() * RESULTS_PER_PIXEL;
+    if ((uint64_t)results.get_size() != num_results) {
+        throw std::runtime_error("Results not allocated. Call start_cpu_search first.");
+    }
+    search_rows_cpu(get_all_psi_phi(), params, candidates.data(), candidates.size(), row_begin, row_end,
+                    results.get_list().data());
+}
+
+void StackSearch::finish_cpu_search() { sort_results(); }
+
+void StackSearch::refine_results(int num_results, float velocity_step, float min_velocity_step,
+                                 int max_iterations) {
+    if (num_results <= 0) return;
+    if (results.on_gpu()) throw std::runtime_error("Results must be on the CPU to refine.");
+
+    DebugTimer refine_timer = DebugTimer("refining results", rs_logger);
+    ScopedTimer refine_phase("refine_results");
+    prepare_psi_phi();
+
+    RefineParameters refine;
+    refine.velocity_step = velocity_step;
+    refine.min_velocity_step = min_velocity_step;
+    refine.max_iterations = max_iterations;
+
+    // The results are sorted by likelihood, so the best come first.
+    std::vector<Trajectory>& trjs = results.get_list();
+    const uint64_t num_refined = std::min<uint64_t>(num_results, trjs.size());
+    if (variant_psi_phi.empty()) {
+        refine_trajectories_cpu(psi_phi_array, params, refine, trjs.data(), num_refined);
+    } else {
+        // Each result is refined with the variant it was found with.
+        parallel_for(0, num_refined, [&](int64_t i) {
+            refine_trajectory_cpu(get_psi_phi(trjs[i].psf_index), params, refine, trjs[i]);
+        });
+    }
+    add_counter("results_refined", num_refined);
+
+    results.sort_by_likelihood();
+    refine_timer.stop();
 }
 
 std::vector<float> StackSearch::extract_psi_or_phi_curve(Trajectory& trj, bool extract_psi) {
     prepare_psi_phi();
+    PsiPhiArray& psi_phi = get_psi_phi(trj.psf_index);
 
     const int num_times = stack.img_count();
     std::vector<float> result(num_times, 0.0);
 
     for (int i = 0; i < num_times; ++i) {
-        float time = psi_phi_array.read_time(i);
+        float time = psi_phi.read_time(i);
 
         // Query the center of the predicted location's pixel.
         Point pred_pt = {trj.get_x_pos(time) + 0.5f, trj.get_y_pos(time) + 0.5f};
         Index pred_idx = pred_pt.to_index();
-        PsiPhi psi_phi_val = psi_phi_array.read_psi_phi(i, pred_idx.i, pred_idx.j);
+        PsiPhi psi_phi_val = psi_phi.read_psi_phi(i, pred_idx.i, pred_idx.j);
 
         float value = (extract_psi) ? psi_phi_val.psi : psi_phi_val.phi;
         if (pixel_value_valid(value)) {
@@ -252,6 +432,42 @@ void StackSearch::set_results(const std::vector<Trajectory>& new_results) {
 }
 
 #ifdef Py_PYTHON_H
+using TrajectoryArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+// Score an N x 4 array of (x, y, vx, vy) and return the lh, flux and obs_count arrays.
+static py::tuple evaluate_trajectory_array(StackSearch& s, TrajectoryArray values) {
+    if (values.ndim() != 2 || values.shape(1) != 4) {
+        throw std::runtime_error("Trajectories must be an array of shape (N, 4).");
+    }
+    const int64_t num_trjs = values.shape(0);
+    auto data = values.unchecked<2>();
+    std::vector<Trajectory> trjs(num_trjs);
+    for (int64_t i = 0; i < num_trjs; ++i) {
+        trjs[i].x = (short)data(i, 0);
+        trjs[i].y = (short)data(i, 1);
+        trjs[i].vx = data(i, 2);
+        trjs[i].vy = data(i, 3);
+    }
+
+    {
+        py::gil_scoped_release release;
+        s.evaluate_trajectories(trjs);
+    }
+
+    py::array_t<float> lh(num_trjs);
+    py::array_t<float> flux(num_trjs);
+    py::array_t<int> obs_count(num_trjs);
+    auto lh_out = lh.mutable_unchecked<1>();
+    auto flux_out = flux.mutable_unchecked<1>();
+    auto obs_out = obs_count.mutable_unchecked<1>();
+    for (int64_t i = 0; i < num_trjs; ++i) {
+        lh_out(i) = trjs[i].lh;
+        flux_out(i) = trjs[i].flux;
+        obs_out(i) = trjs[i].obs_count;
+    }
+    return py::make_tuple(lh, flux, obs_count);
+}
+
 static void stack_search_bindings(py::module& m) {
     using tj = search::Trajectory;
     using pf = search::PSF;
@@ -261,11 +477,27 @@ static void stack_search_bindings(py::module& m) {
 
     py::class_<ks>(m, "StackSearch", pydocs::DOC_StackSearch)
             .def(py::init<is&>())
-            .def("search", &ks::search, pydocs::DOC_StackSearch_search)
+            .def("search", py::overload_cast<std::vector<tj>&, int>(&ks::search),
+                 pydocs::DOC_StackSearch_search)
+            .def("search", py::overload_cast<const search::TrajectoryGenerator&, int>(&ks::search),
+                 pydocs::DOC_StackSearch_search)
             .def("evaluate_single_trajectory", &ks::evaluate_single_trajectory,
                  pydocs::DOC_StackSearch_evaluate_single_trajectory)
             .def("search_linear_trajectory", &ks::search_linear_trajectory,
                  pydocs::DOC_StackSearch_search_linear_trajectory)
+            .def(
+                    "evaluate_trajectories",
+                    [](ks& s, std::vector<tj> trjs) {
+                        s.evaluate_trajectories(trjs);
+                        return trjs;
+                    },
+                    pydocs::DOC_StackSearch_evaluate_trajectories)
+            .def("evaluate_trajectories", &evaluate_trajectory_array,
+                 pydocs::DOC_StackSearch_evaluate_trajectories)
+            .def("refine_results", &ks::refine_results, py::arg("num_results"),
+                 py::arg("velocity_step") = 1.0, py::arg("min_velocity_step") = 0.05,
+                 py::arg("max_iterations") = 100, py::call_guard<py::gil_scoped_release>(),
+                 pydocs::DOC_StackSearch_refine_results)
             .def("set_min_obs", &ks::set_min_obs, pydocs::DOC_StackSearch_set_min_obs)
             .def("set_min_lh", &ks::set_min_lh, pydocs::DOC_StackSearch_set_min_lh)
             .def("enable_gpu_sigmag_filter", &ks::enable_gpu_sigmag_filter,
@@ -273,6 +505,11 @@ static void stack_search_bindings(py::module& m) {
             .def("enable_gpu_encoding", &ks::enable_gpu_encoding, pydocs::DOC_StackSearch_enable_gpu_encoding)
             .def("set_start_bounds_x", &ks::set_start_bounds_x, pydocs::DOC_StackSearch_set_start_bounds_x)
             .def("set_start_bounds_y", &ks::set_start_bounds_y, pydocs::DOC_StackSearch_set_start_bounds_y)
+            .def("set_candidate_reordering", &ks::set_candidate_reordering,
+                 pydocs::DOC_StackSearch_set_candidate_reordering)
+            .def("set_psf_variants", &ks::set_psf_variants, pydocs::DOC_StackSearch_set_psf_variants)
+            .def("get_num_psf_variants", &ks::get_num_psf_variants,
+                 pydocs::DOC_StackSearch_get_num_psf_variants)
             .def("set_debug", &ks::set_debug, pydocs::DOC_StackSearch_set_debug)
             .def("get_num_images", &ks::num_images, pydocs::DOC_StackSearch_get_num_images)
             .def("get_image_width", &ks::get_image_width, pydocs::DOC_StackSearch_get_image_width)
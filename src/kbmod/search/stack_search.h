@@ -8,6 +8,7 @@
 #include <fstream>
 #include <sstream>  // formatting log msgs
 #include <chrono>
+#include <memory>
 #include <stdexcept>
 #include <assert.h>
 #include <float.h>
@@ -17,11 +18,16 @@
 #include "debug_timer.h"
 #include "geom.h"
 #include "image_stack.h"
+#include "instrumentation.h"
+#include "perf_counters.h"
 #include "psf.h"
 #include "psi_phi_array_ds.h"
 #include "psi_phi_array_utils.h"
 #include "pydocs/stack_search_docs.h"
 #include "stamp_creator.h"
+#include "thread_pool.h"
+#include "trajectory_evaluator.h"
+#include "trajectory_generator.h"
 #include "trajectory_list.h"
 
 namespace search {
@@ -46,11 +52,36 @@ public:
     void enable_gpu_encoding(int num_bytes);
     void set_start_bounds_x(int x_min, int x_max);
     void set_start_bounds_y(int y_min, int y_max);
+    void set_candidate_reordering(bool reorder);
+
+    // Search with several PSFs, each used for all of the images instead of their
+    // own PSFs. Candidates are scored with every PSF and the results keep the best
+    // in psf_index. An empty list goes back to the images' PSFs.
+    void set_psf_variants(const std::vector<PSF>& psfs);
+    int get_num_psf_variants() const { return psf_variants.size(); }
 
     // The primary search functions
     void evaluate_single_trajectory(Trajectory& trj);
+    void evaluate_trajectories(std::vector<Trajectory>& trjs);
     Trajectory search_linear_trajectory(short x, short y, float vx, float vy);
     void search(std::vector<Trajectory>& search_list, int min_observations);
+    void search(const TrajectoryGenerator& generator, int min_observations);
+
+    // Refine the velocities of the best num_results results and re-sort them.
+    void refine_results(int num_results, float velocity_step, float min_velocity_step, int max_iterations);
+
+    // The size of the area of starting pixels.
+    int get_search_width() const { return params.x_start_max - params.x_start_min; }
+    int get_search_height() const { return params.y_start_max - params.y_start_min; }
+
+    // The steps of a grid search on the CPU, used by search_stacks to schedule the
+    // searches of several stacks on one thread pool. start_cpu_search prepares the
+    // psi/phi data and allocates the results, search_rows searches a band of
+    // starting rows (from any thread, for disjoint bands) and finish_cpu_search
+    // sorts the results. Returns the number of rows to search.
+    int start_cpu_search(int min_observations);
+    void search_rows(const std::vector<Trajectory>& candidates, int row_begin, int row_end);
+    void finish_cpu_search();
 
     // Gets the vector of result trajectories from the grid search.
     std::vector<Trajectory> get_results(int start, int end);
@@ -70,16 +101,29 @@ public:
 
 protected:
     std::vector<float> extract_psi_or_phi_curve(Trajectory& trj, bool extract_psi);
+    void search_candidates(TrajectoryList& search_list, int min_observations);
+    void allocate_results();
+    void sort_results();
+
+    // The psi/phi data of a PSF variant and of all of them (in order).
+    PsiPhiArray& get_psi_phi(int psf_index);
+    std::vector<PsiPhiArray*> get_all_psi_phi();
 
     // Core data and search parameters
     ImageStack stack;
     SearchParameters params;
     bool debug_info;
+    bool reorder_candidates;
 
     // Precomputed and cached search data
     bool psi_phi_generated;
     PsiPhiArray psi_phi_array;
 
+    // The PSF variants and the psi/phi data of the variants after the first
+    // (whose data is in psi_phi_array).
+    std::vector<PSF> psf_variants;
+    std::vector<std::unique_ptr<PsiPhiArray>> variant_psi_phi;
+
     // Results from the grid search.
     TrajectoryList results;
 };
@@ -8,6 +8,9 @@ void deviceGetCoadds(const unsigned int num_images, const unsigned int width, co
                      std::vector<std::vector<bool>>& use_index_vect, float* results);
 #endif
 
+// The number of trajectories per timed batch when coadding on the CPU.
+constexpr int STAMP_TIMING_BATCH = 64;
+
 StampCreator::StampCreator() {}
 
 std::vector<RawImage> StampCreator::create_stamps(ImageStack& stack, const Trajectory& trj, int radius,
@@ -31,6 +34,62 @@ std::vector<RawImage> StampCreator::create_stamps(ImageStack& stack, const Traje
     return stamps;
 }
 
+// Write the stamps at the used times into an arena and list their pixels.
+// Returns the number of stamps.
+static int create_arena_stamps(ImageStack& stack, const Trajectory& trj, int radius, bool keep_no_data,
+                               const std::vector<bool>& use_index, Arena& arena, const float**& pixels) {
+    if (use_index.size() > 0 && use_index.size() != stack.img_count()) {
+        throw std::runtime_error("Wrong size use_index passed into create_stamps()");
+    }
+    bool use_all_stamps = use_index.size() == 0;
+    const int dim = 2 * radius + 1;
+
+    int num_times = stack.img_count();
+    pixels = arena.allocate_array<const float*>(num_times);
+    int num_stamps = 0;
+    for (int i = 0; i < num_times; ++i) {
+        if (use_all_stamps || use_index[i]) {
+            float time = stack.get_zeroed_time(i);
+            Point pos{trj.x + time * trj.vx, trj.y + time * trj.vy};
+
+            ImageMap stamp = create_arena_image(arena, dim, dim);
+            stack.get_single_image(i).get_science().fill_stamp(pos, radius, keep_no_data, stamp);
+            pixels[num_stamps++] = stamp.data();
+        }
+    }
+    return num_stamps;
+}
+
+// Coadd the stamps of a trajectory using scratch space from the thread's arena,
+// so the only allocation is the returned image.
+static RawImage coadd_arena_stamps(ImageStack& stack, const Trajectory& trj, int radius, bool keep_no_data,
+                                   const std::vector<bool>& use_index, StampType type) {
+    ArenaScope scratch;
+    Arena& arena = scratch.arena();
+    const float** pixels = nullptr;
+    int num_stamps = create_arena_stamps(stack, trj, radius, keep_no_data, use_index, arena, pixels);
+
+    const int dim = 2 * radius + 1;
+    Image result(dim, dim);
+    switch (type) {
+        case STAMP_MEDIAN:
+            median_of_images(pixels, num_stamps, dim * dim, result.data());
+            break;
+        case STAMP_MEAN:
+            mean_of_images(pixels, num_stamps, dim * dim, result.data());
+            break;
+        case STAMP_SUM:
+            sum_of_images(pixels, num_stamps, dim * dim, result.data());
+            break;
+        default:
+            throw std::runtime_error("Invalid stamp coadd type.");
+    }
+
+    RawImage coadd(result);
+    coadd.set_memory_category(MEM_STAMPS);
+    return coadd;
+}
+
 // For stamps used for visualization we replace invalid pixels with zeros
 // and return all the stamps (regardless of whether individual timesteps
 // have been filtered).
@@ -43,26 +102,28 @@ std::vector<RawImage> StampCreator::get_stamps(ImageStack& stack, const Trajecto
 // invalid pixels tagged (so we can filter it out of mean/median).
 RawImage StampCreator::get_median_stamp(ImageStack& stack, const Trajectory& trj, int radius,
                                         const std::vector<bool>& use_index) {
-    return create_median_image(create_stamps(stack, trj, radius, true /*=keep_no_data*/, use_index));
+    return coadd_arena_stamps(stack, trj, radius, true /*=keep_no_data*/, use_index, STAMP_MEDIAN);
 }
 
 // For creating coadded stamps, we do not interpolate the pixel values and keep
 // invalid pixels tagged (so we can filter it out of mean/median).
 RawImage StampCreator::get_mean_stamp(ImageStack& stack, const Trajectory& trj, int radius,
                                       const std::vector<bool>& use_index) {
-    return create_mean_image(create_stamps(stack, trj, radius, true /*=keep_no_data*/, use_index));
+    return coadd_arena_stamps(stack, trj, radius, true /*=keep_no_data*/, use_index, STAMP_MEAN);
 }
 
 // For creating summed stamps, we do not interpolate the pixel values and replace
 // invalid pixels with zero (which is the same as filtering it out for the sum).
 RawImage StampCreator::get_summed_stamp(ImageStack& stack, const Trajectory& trj, int radius,
                                         const std::vector<bool>& use_index) {
-    return create_summed_image(create_stamps(stack, trj, radius, false /*=keep_no_data*/, use_index));
+    return coadd_arena_stamps(stack, trj, radius, false /*=keep_no_data*/, use_index, STAMP_SUM);
 }
 
 std::vector<RawImage> StampCreator::get_coadded_stamps(ImageStack& stack, std::vector<Trajectory>& t_array,
                                                        std::vector<std::vector<bool>>& use_index_vect,
                                                        const StampParameters& params, bool use_gpu) {
+    ScopedTimer phase_timer("coadd_stamps");
+    add_counter("stamps_coadded", t_array.size());
     if (use_gpu) {
 #ifdef HAVE_CUDA
         return get_coadded_stamps_gpu(stack, t_array, use_index_vect, params);
@@ -80,30 +141,25 @@ std::vector<RawImage> StampCreator::get_coadded_stamps_cpu(ImageStack& stack,
     const int num_trajectories = t_array.size();
     std::vector<RawImage> results(num_trajectories);
 
+    std::unique_ptr<ScopedTimer> batch_timer = nullptr;
     for (int i = 0; i < num_trajectories; ++i) {
-        std::vector<RawImage> stamps =
-                StampCreator::create_stamps(stack, t_array[i], params.radius, true, use_index_vect[i]);
-
-        RawImage coadd(1, 1);
-        switch (params.stamp_type) {
-            case STAMP_MEDIAN:
-                coadd = create_median_image(stamps);
-                break;
-            case STAMP_MEAN:
-                coadd = create_mean_image(stamps);
-                break;
-            case STAMP_SUM:
-                coadd = create_summed_image(stamps);
-                break;
-            default:
-                throw std::runtime_error("Invalid stamp coadd type.");
+        // Time the work in batches so they show up on the trace timeline.
+        // The previous batch must be stopped before the next one starts.
+        if (i % STAMP_TIMING_BATCH == 0) {
+            batch_timer.reset();
+            batch_timer.reset(new ScopedTimer("stamp_batch"));
         }
 
+        // The individual stamps live in the thread's arena, which is rewound after
+        // each trajectory.
+        RawImage coadd = coadd_arena_stamps(stack, t_array[i], params.radius, true, use_index_vect[i],
+                                            params.stamp_type);
+
         // Do the filtering if needed.
         if (params.do_filtering && filter_stamp(coadd, params)) {
             results[i] = RawImage(1, 1, NO_DATA);
         } else {
-            results[i] = coadd;
+            results[i] = std::move(coadd);
         }
     }
 
@@ -171,6 +227,7 @@ std::vector<RawImage> StampCreator::get_coadded_stamps_gpu(ImageStack& stack,
     const int stamp_width = 2 * params.radius + 1;
     const int stamp_ppi = stamp_width * stamp_width;
     std::vector<float> stamp_data(stamp_ppi * num_trajectories);
+    TrackedBytes stamp_memory(MEM_STAMPS, stamp_data.size() * sizeof(float));
 
     // Do the co-adds.
 #ifdef HAVE_CUDA
@@ -206,6 +263,7 @@ std::vector<RawImage> StampCreator::get_coadded_stamps_gpu(ImageStack& stack,
 
         Image tmp = Eigen::Map<Image>(current_pixels.data(), stamp_width, stamp_width);
         RawImage current_image = RawImage(tmp);
+        current_image.set_memory_category(MEM_STAMPS);
 
         if (params.do_filtering && filter_stamp(current_image, params)) {
             results[t] = RawImage(1, 1, NO_DATA);
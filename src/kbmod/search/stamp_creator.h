@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "image_stack.h"
+#include "instrumentation.h"
 #include "pydocs/stamp_creator_docs.h"
 
 namespace search {
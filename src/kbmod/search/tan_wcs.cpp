@@ -0,0 +1,228 @@
+#include "tan_wcs.h"
+
+namespace search {
+
+constexpr double DEG_TO_RAD = M_PI / 180.0;
+constexpr double RAD_TO_DEG = 180.0 / M_PI;
+
+// The FITS SIP convention allows polynomials up to order 9.
+constexpr int MAX_SIP_ORDER = 9;
+
+// Stop the SIP inversion once the correction is below this (in pixels).
+constexpr double SIP_INVERSION_TOL = 1e-10;
+constexpr int SIP_INVERSION_MAX_ITERS = 50;
+
+// Evaluate sum_{p+q <= order} coeffs(p, q) * u^p * v^q and, optionally, its partial
+// derivatives with respect to u and v.
+static double eval_sip_poly(const CoordMatrix& coeffs, int order, double u, double v, double* d_du = nullptr,
+                            double* d_dv = nullptr) {
+    double u_pow[MAX_SIP_ORDER + 1];
+    double v_pow[MAX_SIP_ORDER + 1];
+    u_pow[0] = 1.0;
+    v_pow[0] = 1.0;
+    for (int i = 1; i <= order; ++i) {
+        u_pow[i] = u_pow[i - 1] * u;
+        v_pow[i] = v_pow[i - 1] * v;
+    }
+
+    double value = 0.0;
+    double du = 0.0;
+    double dv = 0.0;
+    for (int p = 0; p <= order; ++p) {
+        for (int q = 0; q <= order - p; ++q) {
+            const double c = coeffs(p, q);
+            if (c == 0.0) continue;
+            value += c * u_pow[p] * v_pow[q];
+            if (p > 0) du += c * p * u_pow[p - 1] * v_pow[q];
+            if (q > 0) dv += c * q * u_pow[p] * v_pow[q - 1];
+        }
+    }
+    if (d_du != nullptr) *d_du = du;
+    if (d_dv != nullptr) *d_dv = dv;
+    return value;
+}
+
+static int check_sip_shape(const CoordMatrix& a, const CoordMatrix& b) {
+    if (a.rows() != a.cols() || b.rows() != b.cols() || a.rows() != b.rows()) {
+        throw std::runtime_error("SIP coefficient matrices must be square and of the same size.");
+    }
+    if (a.rows() - 1 > MAX_SIP_ORDER) throw std::runtime_error("SIP order is too large.");
+    return a.rows() - 1;
+}
+
+TanWCS::TanWCS(double crpix1, double crpix2, double crval1, double crval2, const Eigen::Matrix2d& cd)
+        : crpix1(crpix1), crpix2(crpix2), cd(cd), sip_order(0), inv_sip_order(0) {
+    if (std::fabs(cd.determinant()) == 0.0) throw std::runtime_error("Singular CD matrix.");
+    cd_inv = cd.inverse();
+
+    ra0 = crval1 * DEG_TO_RAD;
+    dec0 = crval2 * DEG_TO_RAD;
+    sin_dec0 = std::sin(dec0);
+    cos_dec0 = std::cos(dec0);
+}
+
+void TanWCS::set_sip(const CoordMatrix& a, const CoordMatrix& b) {
+    sip_order = check_sip_shape(a, b);
+    sip_a = a;
+    sip_b = b;
+}
+
+void TanWCS::set_inverse_sip(const CoordMatrix& ap, const CoordMatrix& bp) {
+    inv_sip_order = check_sip_shape(ap, bp);
+    sip_ap = ap;
+    sip_bp = bp;
+}
+
+void TanWCS::apply_sip(double u, double v, double& u_out, double& v_out) const {
+    u_out = u;
+    v_out = v;
+    if (sip_order > 0) {
+        u_out += eval_sip_poly(sip_a, sip_order, u, v);
+        v_out += eval_sip_poly(sip_b, sip_order, u, v);
+    }
+}
+
+void TanWCS::invert_sip(double u_dist, double v_dist, double& u, double& v) const {
+    u = u_dist;
+    v = v_dist;
+    if (sip_order == 0) return;
+
+    // Start from the inverse polynomials if we have them.
+    if (inv_sip_order > 0) {
+        u += eval_sip_poly(sip_ap, inv_sip_order, u_dist, v_dist);
+        v += eval_sip_poly(sip_bp, inv_sip_order, u_dist, v_dist);
+    }
+
+    for (int iter = 0; iter < SIP_INVERSION_MAX_ITERS; ++iter) {
+        double da_du, da_dv, db_du, db_dv;
+        double f_u = u + eval_sip_poly(sip_a, sip_order, u, v, &da_du, &da_dv) - u_dist;
+        double f_v = v + eval_sip_poly(sip_b, sip_order, u, v, &db_du, &db_dv) - v_dist;
+
+        // Solve the 2x2 Jacobian system for the Newton step.
+        double j11 = 1.0 + da_du;
+        double j12 = da_dv;
+        double j21 = db_du;
+        double j22 = 1.0 + db_dv;
+        double det = j11 * j22 - j12 * j21;
+        if (det == 0.0) break;
+
+        double step_u = (j22 * f_u - j12 * f_v) / det;
+        double step_v = (j11 * f_v - j21 * f_u) / det;
+        u -= step_u;
+        v -= step_v;
+        if (std::fabs(step_u) < SIP_INVERSION_TOL && std::fabs(step_v) < SIP_INVERSION_TOL) break;
+    }
+}
+
+std::pair<double, double> TanWCS::pixel_to_sky(double x, double y) const {
+    // Intermediate pixel coordinates (relative to the 1-based reference pixel).
+    double u, v;
+    apply_sip(x + 1.0 - crpix1, y + 1.0 - crpix2, u, v);
+
+    // Projection plane coordinates in radians.
+    double xi = (cd(0, 0) * u + cd(0, 1) * v) * DEG_TO_RAD;
+    double eta = (cd(1, 0) * u + cd(1, 1) * v) * DEG_TO_RAD;
+
+    // Inverse gnomonic projection.
+    double denom = cos_dec0 - eta * sin_dec0;
+    double ra = ra0 + std::atan2(xi, denom);
+    double dec = std::atan2(sin_dec0 + eta * cos_dec0, std::sqrt(xi * xi + denom * denom));
+
+    ra = std::fmod(ra * RAD_TO_DEG, 360.0);
+    if (ra < 0.0) ra += 360.0;
+    return {ra, dec * RAD_TO_DEG};
+}
+
+std::pair<double, double> TanWCS::sky_to_pixel(double ra, double dec) const {
+    const double ra_rad = ra * DEG_TO_RAD;
+    const double dec_rad = dec * DEG_TO_RAD;
+    const double sin_dec = std::sin(dec_rad);
+    const double cos_dec = std::cos(dec_rad);
+    const double cos_dra = std::cos(ra_rad - ra0);
+
+    // Points at or beyond 90 degrees from the reference point do not project.
+    const double cos_c = sin_dec0 * sin_dec + cos_dec0 * cos_dec * cos_dra;
+    if (cos_c <= 0.0) return {NAN, NAN};
+
+    // Gnomonic projection to the projection plane (in degrees).
+    double xi = cos_dec * std::sin(ra_rad - ra0) / cos_c * RAD_TO_DEG;
+    double eta = (cos_dec0 * sin_dec - sin_dec0 * cos_dec * cos_dra) / cos_c * RAD_TO_DEG;
+
+    double u_dist = cd_inv(0, 0) * xi + cd_inv(0, 1) * eta;
+    double v_dist = cd_inv(1, 0) * xi + cd_inv(1, 1) * eta;
+
+    double u, v;
+    invert_sip(u_dist, v_dist, u, v);
+    return {u + crpix1 - 1.0, v + crpix2 - 1.0};
+}
+
+std::pair<CoordVector, CoordVector> TanWCS::pixels_to_sky(const CoordVector& x, const CoordVector& y) const {
+    if (x.size() != y.size()) throw std::runtime_error("Mismatched coordinate array sizes.");
+    const int num_pts = x.size();
+    CoordVector ra(num_pts);
+    CoordVector dec(num_pts);
+
+    parallel_for(0, num_pts, [&](int64_t i) {
+        auto res = pixel_to_sky(x[i], y[i]);
+        ra[i] = res.first;
+        dec[i] = res.second;
+    });
+    return {ra, dec};
+}
+
+std::pair<CoordVector, CoordVector> TanWCS::sky_to_pixels(const CoordVector& ra,
+                                                          const CoordVector& dec) const {
+    if (ra.size() != dec.size()) throw std::runtime_error("Mismatched coordinate array sizes.");
+    const int num_pts = ra.size();
+    CoordVector x(num_pts);
+    CoordVector y(num_pts);
+
+    parallel_for(0, num_pts, [&](int64_t i) {
+        auto res = sky_to_pixel(ra[i], dec[i]);
+        x[i] = res.first;
+        y[i] = res.second;
+    });
+    return {x, y};
+}
+
+std::pair<CoordMatrix, CoordMatrix> TanWCS::predict_skypos(const std::vector<Trajectory>& trjs,
+                                                           const std::vector<double>& dt) const {
+    const int num_trjs = trjs.size();
+    const int num_times = dt.size();
+    CoordMatrix ra(num_trjs, num_times);
+    CoordMatrix dec(num_trjs, num_times);
+
+    parallel_for(0, num_trjs, [&](int64_t i) {
+        const Trajectory& trj = trjs[i];
+        for (int t = 0; t < num_times; ++t) {
+            auto res = pixel_to_sky(trj.x + trj.vx * dt[t], trj.y + trj.vy * dt[t]);
+            ra(i, t) = res.first;
+            dec(i, t) = res.second;
+        }
+    });
+    return {ra, dec};
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static void tan_wcs_bindings(py::module& m) {
+    using tw = search::TanWCS;
+
+    py::class_<tw>(m, "TanWCS", pydocs::DOC_TanWCS)
+            .def(py::init<double, double, double, double, const Eigen::Matrix2d&>(), py::arg("crpix1"),
+                 py::arg("crpix2"), py::arg("crval1"), py::arg("crval2"), py::arg("cd"))
+            .def("set_sip", &tw::set_sip, pydocs::DOC_TanWCS_set_sip)
+            .def("set_inverse_sip", &tw::set_inverse_sip, pydocs::DOC_TanWCS_set_inverse_sip)
+            .def_property_readonly("has_sip", &tw::has_sip)
+            .def("pixel_to_sky", &tw::pixel_to_sky, pydocs::DOC_TanWCS_pixel_to_sky)
+            .def("sky_to_pixel", &tw::sky_to_pixel, pydocs::DOC_TanWCS_sky_to_pixel)
+            .def("pixels_to_sky", &tw::pixels_to_sky, pydocs::DOC_TanWCS_pixels_to_sky)
+            .def("sky_to_pixels", &tw::sky_to_pixels, pydocs::DOC_TanWCS_sky_to_pixels)
+            .def("predict_skypos", &tw::predict_skypos, pydocs::DOC_TanWCS_predict_skypos);
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
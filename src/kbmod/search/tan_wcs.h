@@ -0,0 +1,90 @@
+/*
+ * tan_wcs.h
+ *
+ * A minimal gnomonic (TAN) projection WCS with optional SIP distortion
+ * polynomials. Supports the subset of FITS WCS used by the KBMOD images
+ * (equatorial RA/Dec, LONPOLE = 180, CD or PC+CDELT linear terms) and
+ * converts batches of pixel or sky coordinates in parallel.
+ *
+ * Pixel coordinates are 0-based, matching astropy's pixel_to_world and
+ * world_to_pixel. Sky coordinates are in degrees.
+ *
+ * Created on: October 17, 2026
+ */
+
+#ifndef TAN_WCS_H_
+#define TAN_WCS_H_
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "thread_pool.h"
+#include "pydocs/tan_wcs_docs.h"
+
+namespace search {
+
+using CoordVector = Eigen::VectorXd;
+using CoordMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+class TanWCS {
+public:
+    // crpix is 1-based (as in the FITS header), crval is in degrees and cd
+    // maps the intermediate pixel coordinates to degrees.
+    TanWCS(double crpix1, double crpix2, double crval1, double crval2, const Eigen::Matrix2d& cd);
+
+    // Set the forward (A, B) SIP coefficients. Entry (p, q) is the coefficient
+    // of u^p * v^q, matching the A_p_q / B_p_q header keywords.
+    void set_sip(const CoordMatrix& a, const CoordMatrix& b);
+
+    // Set the inverse (AP, BP) SIP coefficients, used as the initial guess of
+    // the iterative inversion of the forward polynomials.
+    void set_inverse_sip(const CoordMatrix& ap, const CoordMatrix& bp);
+
+    bool has_sip() const { return sip_order > 0; }
+
+    // Single point conversions.
+    std::pair<double, double> pixel_to_sky(double x, double y) const;
+    std::pair<double, double> sky_to_pixel(double ra, double dec) const;
+
+    // Batch conversions (computed in parallel).
+    std::pair<CoordVector, CoordVector> pixels_to_sky(const CoordVector& x, const CoordVector& y) const;
+    std::pair<CoordVector, CoordVector> sky_to_pixels(const CoordVector& ra, const CoordVector& dec) const;
+
+    // Predict the (RA, Dec) of each trajectory at each time offset (relative to
+    // the trajectory's starting position). Returns two [num_trajectories x
+    // num_times] matrices of RA and Dec.
+    std::pair<CoordMatrix, CoordMatrix> predict_skypos(const std::vector<Trajectory>& trjs,
+                                                       const std::vector<double>& dt) const;
+
+private:
+    // Apply the forward SIP polynomial to the intermediate pixel coordinates.
+    void apply_sip(double u, double v, double& u_out, double& v_out) const;
+
+    // Invert the forward SIP polynomial with Newton's method.
+    void invert_sip(double u_dist, double v_dist, double& u, double& v) const;
+
+    double crpix1;
+    double crpix2;
+    double ra0;   // radians
+    double dec0;  // radians
+    double sin_dec0;
+    double cos_dec0;
+    Eigen::Matrix2d cd;
+    Eigen::Matrix2d cd_inv;
+
+    int sip_order;
+    CoordMatrix sip_a;
+    CoordMatrix sip_b;
+    int inv_sip_order;
+    CoordMatrix sip_ap;
+    CoordMatrix sip_bp;
+};
+
+} /* namespace search */
+
+#endif /* TAN_WCS_H_ */
@@ -0,0 +1,416 @@
+#include "thread_pool.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef __unix__
+#include <pthread.h>
+#endif
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+namespace search {
+
+// The index of the calling thread's queue (-1 for threads outside the pool).
+static thread_local int worker_index = -1;
+
+// A thread waiting on a TaskGroup yields this many times when it finds no task
+// to run, and then sleeps for (at most) WAIT_SLEEP at a time. The sleep is
+// bounded because tasks that the thread could run do not wake it.
+constexpr int WAIT_SPINS = 64;
+constexpr std::chrono::microseconds WAIT_SLEEP(200);
+
+std::atomic<bool> ThreadPool::deterministic(true);
+
+#ifdef __linux__
+// Parse a sysfs CPU list such as "0-3,8-11".
+static std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+#endif
+
+std::vector<std::vector<int>> get_numa_node_cpus() {
+    std::vector<std::vector<int>> nodes;
+    std::vector<int> allowed;
+
+#ifdef __linux__
+    cpu_set_t allowed_set;
+    CPU_ZERO(&allowed_set);
+    if (sched_getaffinity(0, sizeof(allowed_set), &allowed_set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed_set)) allowed.push_back(cpu);
+        }
+    }
+
+    // Each node directory lists its CPUs. Keep only the ones we may run on.
+    std::vector<int> node_ids;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(dir)) {
+            int id;
+            if (sscanf(entry->d_name, "node%d", &id) == 1) node_ids.push_back(id);
+        }
+        closedir(dir);
+    }
+    std::sort(node_ids.begin(), node_ids.end());
+
+    for (int id : node_ids) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+        std::string text;
+        if (!std::getline(file, text)) continue;
+
+        std::vector<int> cpus;
+        for (int cpu : parse_cpu_list(text)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) cpus.push_back(cpu);
+        }
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+#endif
+
+    if (nodes.empty()) nodes.push_back(allowed);
+    return nodes;
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool() : num_threads(1), bind_threads(true), num_pending(0), stopping(false) {
+    node_cpus = get_numa_node_cpus();
+
+    // Use the cores the process may run on, which can be fewer than the machine's.
+    int num_cores = 0;
+    for (const std::vector<int>& cpus : node_cpus) num_cores += cpus.size();
+    if (num_cores == 0) num_cores = std::thread::hardware_concurrency();
+    num_threads = std::max(num_cores, 1);
+    start_workers();
+
+#ifdef __unix__
+    pthread_atfork(nullptr, nullptr, &ThreadPool::reset_after_fork);
+#endif
+}
+
+ThreadPool::~ThreadPool() { stop_workers(); }
+
+void ThreadPool::set_num_threads(int new_num_threads) {
+    if (new_num_threads < 1) throw std::runtime_error("The thread pool needs at least one thread.");
+    if (worker_index >= 0) throw std::runtime_error("The thread pool cannot be resized from a worker.");
+    if (new_num_threads == num_threads) return;
+
+    stop_workers();
+    num_threads = new_num_threads;
+    start_workers();
+}
+
+void ThreadPool::set_bind_threads(bool bind) {
+    if (worker_index >= 0) throw std::runtime_error("The thread pool cannot be changed from a worker.");
+    if (bind == bind_threads) return;
+
+    stop_workers();
+    bind_threads = bind;
+    start_workers();
+}
+
+bool ThreadPool::in_worker() { return worker_index >= 0; }
+
+void ThreadPool::start_workers() {
+    stopping = false;
+    queues.clear();
+    for (int i = 0; i < num_threads; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    // The calling thread does its share of the work, so start one fewer worker.
+    for (int i = 0; i < num_threads - 1; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+void ThreadPool::stop_workers() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+
+    // Run anything still queued so no task group waits forever.
+    std::function<void()> task;
+    while (pop_task(-1, task)) task();
+    for (auto& queue : queues) {
+        while (!queue->pinned.empty()) {
+            task = std::move(queue->pinned.front());
+            queue->pinned.pop_front();
+            queue->num_pinned -= 1;
+            task();
+        }
+    }
+}
+
+void ThreadPool::reset_after_fork() {
+    // Only the forking thread exists in the child. Leak the workers' handles (joining
+    // or destroying them would fail) and the queues (whose locks may be held) and run
+    // everything on the calling thread.
+    ThreadPool& pool = instance();
+    new std::vector<std::thread>(std::move(pool.workers));
+    for (auto& queue : pool.queues) queue.release();
+    pool.workers.clear();
+    pool.queues.clear();
+    pool.queues.push_back(std::make_unique<TaskQueue>());
+    pool.num_pending = 0;
+    pool.num_threads = 1;
+    new (&pool.sleep_lock) std::mutex();
+    new (&pool.wake) std::condition_variable();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    // Workers push onto their own queue. Other threads use the last queue, which
+    // belongs to no worker.
+    int index = (worker_index >= 0) ? worker_index : queues.size() - 1;
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        num_pending += 1;
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::submit_to_worker(int worker, std::function<void()> task) {
+    if (worker < 0 || worker >= (int)workers.size()) {
+        throw std::runtime_error("Invalid worker " + std::to_string(worker));
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[worker]->lock);
+        queues[worker]->pinned.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        queues[worker]->num_pinned += 1;
+    }
+    // Only one worker can take the task, so wake them all.
+    wake.notify_all();
+}
+
+bool ThreadPool::pop_task(int index, std::function<void()>& task) {
+    // Take the oldest pinned task or the newest task from our own queue.
+    if (index >= 0) {
+        std::lock_guard<std::mutex> guard(queues[index]->lock);
+        if (!queues[index]->pinned.empty()) {
+            task = std::move(queues[index]->pinned.front());
+            queues[index]->pinned.pop_front();
+            queues[index]->num_pinned -= 1;
+            return true;
+        }
+        if (!queues[index]->tasks.empty()) {
+            task = std::move(queues[index]->tasks.back());
+            queues[index]->tasks.pop_back();
+            num_pending -= 1;
+            return true;
+        }
+    }
+
+    // Steal the oldest task from another queue.
+    const int num_queues = queues.size();
+    const int start = (index >= 0) ? index + 1 : 0;
+    for (int offset = 0; offset < num_queues; ++offset) {
+        int victim = (start + offset) % num_queues;
+        if (victim == index) continue;
+
+        std::lock_guard<std::mutex> guard(queues[victim]->lock);
+        if (!queues[victim]->tasks.empty()) {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+            num_pending -= 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::try_run_one() {
+    std::function<void()> task;
+    if (!pop_task(worker_index, task)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::bind_worker(int index) {
+#ifdef __linux__
+    // Binding only helps to keep threads near their memory.
+    const int num_nodes = node_cpus.size();
+    const int num_workers = num_threads - 1;
+    if (!bind_threads || num_nodes < 2 || num_workers < 1) return;
+
+    // Spread the workers over the nodes in order, so neighbouring bands of a
+    // static partition share a node, and over the cores within each node.
+    const int node = (index * num_nodes) / num_workers;
+    const int first_on_node = (node * num_workers + num_nodes - 1) / num_nodes;
+    const std::vector<int>& cpus = node_cpus[node];
+    if (cpus.empty()) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[(index - first_on_node) % cpus.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+void ThreadPool::worker_loop(int index) {
+    worker_index = index;
+    bind_worker(index);
+    std::function<void()> task;
+    while (true) {
+        if (pop_task(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        TaskQueue& own = *queues[index];
+        wake.wait(guard, [this, &own]() { return stopping || num_pending > 0 || own.num_pinned > 0; });
+        if (stopping) return;
+    }
+}
+
+TaskGroup::~TaskGroup() {
+    // Never leave tasks running that refer to the group.
+    wait_for_tasks();
+}
+
+void TaskGroup::run_task(const std::function<void()>& task) {
+    try {
+        task();
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(error_lock_);
+        if (error_ == nullptr) error_ = std::current_exception();
+    }
+
+    // Count the task as done under the lock, so a waiter that sees the last one
+    // finish cannot destroy the group before this thread is done notifying.
+    std::lock_guard<std::mutex> guard(done_lock_);
+    if (--outstanding_ == 0) done_.notify_all();
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    outstanding_ += 1;
+    pool_.submit([this, task = std::move(task)]() { run_task(task); });
+}
+
+void TaskGroup::run_on_worker(int worker, std::function<void()> task) {
+    outstanding_ += 1;
+    pool_.submit_to_worker(worker, [this, task = std::move(task)]() { run_task(task); });
+}
+
+void TaskGroup::wait_for_tasks() {
+    int num_idle = 0;
+    while (outstanding_ > 0) {
+        if (pool_.try_run_one()) {
+            num_idle = 0;
+        } else if (++num_idle < WAIT_SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::unique_lock<std::mutex> guard(done_lock_);
+            done_.wait_for(guard, WAIT_SLEEP, [this]() { return outstanding_ == 0; });
+        }
+    }
+
+    // Wait for the thread that finished the last task to release the lock.
+    std::lock_guard<std::mutex> guard(done_lock_);
+}
+
+void TaskGroup::wait() {
+    wait_for_tasks();
+
+    if (error_ != nullptr) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+std::vector<int64_t> chunk_range(int64_t begin, int64_t end, int64_t min_chunk) {
+    const int64_t size = std::max<int64_t>(end - begin, 0);
+    const int64_t max_chunks = 4 * (int64_t)ThreadPool::instance().get_num_threads();
+    int64_t num_chunks = std::min(max_chunks, size / std::max<int64_t>(min_chunk, 1));
+    num_chunks = std::max<int64_t>(num_chunks, 1);
+
+    // Spread the remainder over the first chunks.
+    std::vector<int64_t> bounds(num_chunks + 1);
+    for (int64_t c = 0; c <= num_chunks; ++c) {
+        bounds[c] = begin + (size * c) / num_chunks;
+    }
+    return bounds;
+}
+
+std::vector<int64_t> reduction_range(int64_t begin, int64_t end, int64_t min_chunk) {
+    if (!ThreadPool::get_deterministic()) return chunk_range(begin, end, min_chunk);
+
+    const int64_t block = std::max(min_chunk, REDUCTION_BLOCK);
+    std::vector<int64_t> bounds;
+    for (int64_t lo = begin; lo < end; lo += block) bounds.push_back(lo);
+    bounds.push_back(std::max(begin, end));
+    if (bounds.size() == 1) bounds.push_back(begin);
+    return bounds;
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static void thread_pool_bindings(py::module& m) {
+    using tp = search::ThreadPool;
+
+    py::class_<tp, std::unique_ptr<tp, py::nodelete>>(m, "ThreadPool", pydocs::DOC_ThreadPool)
+            .def_static(
+                    "get_num_threads", []() { return tp::instance().get_num_threads(); },
+                    pydocs::DOC_ThreadPool_get_num_threads)
+            .def_static(
+                    "set_num_threads",
+                    [](int num_threads) {
+                        py::gil_scoped_release release;
+                        tp::instance().set_num_threads(num_threads);
+                    },
+                    pydocs::DOC_ThreadPool_set_num_threads)
+            .def_static(
+                    "get_bind_threads", []() { return tp::instance().get_bind_threads(); },
+                    pydocs::DOC_ThreadPool_get_bind_threads)
+            .def_static(
+                    "set_bind_threads",
+                    [](bool bind) {
+                        py::gil_scoped_release release;
+                        tp::instance().set_bind_threads(bind);
+                    },
+                    pydocs::DOC_ThreadPool_set_bind_threads)
+            .def_static(
+                    "get_num_numa_nodes", []() { return tp::instance().get_num_numa_nodes(); },
+                    pydocs::DOC_ThreadPool_get_num_numa_nodes)
+            .def_static("get_deterministic", &tp::get_deterministic,
+                        pydocs::DOC_ThreadPool_get_deterministic)
+            .def_static("set_deterministic", &tp::set_deterministic,
+                        pydocs::DOC_ThreadPool_set_deterministic);
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
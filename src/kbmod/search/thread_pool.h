@@ -0,0 +1,275 @@
+/*
+ * thread_pool.h
+ *
+ * The process-wide work-stealing thread pool used for all of the CPU parallel
+ * work in the search core. Each worker owns a deque of tasks: it runs its own
+ * tasks newest first and, when it runs out, steals the oldest tasks of the
+ * other workers. Threads waiting on a TaskGroup run pending tasks, and only
+ * sleep after a short spin finds none, so parallel loops can be nested without
+ * deadlocking or starting more threads than the pool's size.
+ *
+ * The size of the pool counts the calling thread, so a pool of size 1 has no
+ * workers and runs everything inline. The size is set from Python (the
+ * num_cores configuration parameter) and defaults to the number of cores the
+ * process may run on (its CPU affinity, which container and batch system
+ * limits set).
+ *
+ * On machines with more than one NUMA node the workers are bound to cores,
+ * spread over the nodes in order, and parallel_for_static gives each worker the
+ * same band of a range every time. Buffers written and read with the same
+ * static partition are first touched (and so placed) on the node of the
+ * threads that use them.
+ *
+ * Reductions are deterministic by default: parallel_reduce splits its range
+ * into fixed-size blocks that do not depend on the number of threads and
+ * combines the block values in a fixed pairwise tree. Floating point results
+ * are then bitwise identical for any pool size.
+ *
+ * Created on: October 18, 2026
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pydocs/thread_pool_docs.h"
+
+namespace search {
+
+// The CPUs of each NUMA node that this process may run on. Machines without NUMA
+// information are treated as a single node with all of the allowed CPUs.
+std::vector<std::vector<int>> get_numa_node_cpus();
+
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+
+    // The number of threads that run tasks, including the calling thread.
+    int get_num_threads() const { return num_threads; }
+    int get_num_workers() const { return workers.size(); }
+
+    // Resize the pool (at least 1). Must not be called while tasks are running.
+    void set_num_threads(int new_num_threads);
+
+    // Whether the workers are bound to cores. Binding only happens on machines
+    // with more than one NUMA node.
+    bool get_bind_threads() const { return bind_threads; }
+    void set_bind_threads(bool bind);
+    int get_num_numa_nodes() const { return node_cpus.size(); }
+
+    // Whether the calling thread is one of the pool's workers.
+    static bool in_worker();
+
+    // Whether parallel_reduce gives the same result for any number of threads
+    // (on by default). Off, reductions use one chunk per share of the threads.
+    static bool get_deterministic() { return deterministic; }
+    static void set_deterministic(bool enable) { deterministic = enable; }
+
+    // Queue a task. Use a TaskGroup to wait for tasks.
+    void submit(std::function<void()> task);
+
+    // Queue a task that only the given worker may run.
+    void submit_to_worker(int worker, std::function<void()> task);
+
+    // Run one pending task on the calling thread. Returns false if none was found.
+    bool try_run_one();
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+private:
+    ThreadPool();
+
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+
+        // Tasks that cannot be stolen.
+        std::deque<std::function<void()>> pinned;
+        std::atomic<int64_t> num_pinned{0};
+    };
+
+    void start_workers();
+    void stop_workers();
+    void worker_loop(int index);
+    bool pop_task(int index, std::function<void()>& task);
+    void bind_worker(int index);
+
+    // Forget the workers in a forked child, where the threads no longer exist.
+    static void reset_after_fork();
+
+    int num_threads;
+    bool bind_threads;
+    std::vector<std::vector<int>> node_cpus;
+
+    // One queue per worker and a final one for tasks submitted by other threads.
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<int64_t> num_pending;
+    bool stopping;
+
+    static std::atomic<bool> deterministic;
+};
+
+// A set of tasks that can be waited on together. Waiting runs pending tasks (from
+// any group) on the calling thread. The first exception thrown by a task is
+// rethrown by wait().
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::instance()) : pool_(pool), outstanding_(0) {}
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void run_on_worker(int worker, std::function<void()> task);
+    void wait();
+
+private:
+    // Run the task, keeping its exception, and count it as done.
+    void run_task(const std::function<void()>& task);
+
+    // Run pending tasks until the group's tasks are done, sleeping on done_
+    // when a bounded spin finds nothing to run.
+    void wait_for_tasks();
+
+    ThreadPool& pool_;
+    std::atomic<int64_t> outstanding_;
+    std::mutex error_lock_;
+    std::exception_ptr error_;
+    std::mutex done_lock_;
+    std::condition_variable done_;
+};
+
+// Split [begin, end) into contiguous chunks of at least min_chunk indices (about
+// four per thread) and return the chunk boundaries.
+std::vector<int64_t> chunk_range(int64_t begin, int64_t end, int64_t min_chunk = 1);
+
+// The number of indices in each block of a deterministic reduction.
+constexpr int64_t REDUCTION_BLOCK = 4096;
+
+// The chunk boundaries of a reduction over [begin, end). In deterministic mode
+// these are blocks of max(min_chunk, REDUCTION_BLOCK) indices (independent of
+// the pool), otherwise the chunks of chunk_range.
+std::vector<int64_t> reduction_range(int64_t begin, int64_t end, int64_t min_chunk = 1);
+
+// Call body(i) for every i in [begin, end), with the chunks of the range running
+// in parallel.
+template <typename Body>
+void parallel_for(int64_t begin, int64_t end, Body body, int64_t min_chunk = 1) {
+    if (end <= begin) return;
+    std::vector<int64_t> bounds = chunk_range(begin, end, min_chunk);
+    if (bounds.size() <= 2) {
+        for (int64_t i = begin; i < end; ++i) body(i);
+        return;
+    }
+
+    TaskGroup group;
+    for (size_t c = 0; c + 1 < bounds.size(); ++c) {
+        const int64_t lo = bounds[c];
+        const int64_t hi = bounds[c + 1];
+        group.run([lo, hi, &body]() {
+            for (int64_t i = lo; i < hi; ++i) body(i);
+        });
+    }
+    group.wait();
+}
+
+// Call body(i) for every i in [begin, end) with the range split into one
+// contiguous band per worker, where the k-th band always runs on the k-th
+// worker. Calls with the same range use the same threads for the same indices,
+// which keeps data first touched by one call local to the readers of the next.
+// Runs as parallel_for when called from a worker or when there are no workers.
+template <typename Body>
+void parallel_for_static(int64_t begin, int64_t end, Body body) {
+    if (end <= begin) return;
+    ThreadPool& pool = ThreadPool::instance();
+    const int64_t num_workers = pool.get_num_workers();
+    if (num_workers == 0 || ThreadPool::in_worker()) {
+        parallel_for(begin, end, body);
+        return;
+    }
+
+    TaskGroup group(pool);
+    const int64_t size = end - begin;
+    for (int64_t w = 0; w < num_workers; ++w) {
+        const int64_t lo = begin + (size * w) / num_workers;
+        const int64_t hi = begin + (size * (w + 1)) / num_workers;
+        if (lo == hi) continue;
+        group.run_on_worker(w, [lo, hi, &body]() {
+            for (int64_t i = lo; i < hi; ++i) body(i);
+        });
+    }
+    group.wait();
+}
+
+// Reduce over [begin, end): map(lo, hi) computes the value of each chunk (in
+// index order) and the chunk values are combined pairwise, neighbours first, so
+// the order of the operations only depends on the chunks (see reduction_range).
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(int64_t begin, int64_t end, T identity, Map map, Combine combine, int64_t min_chunk = 1) {
+    if (end <= begin) return identity;
+    std::vector<int64_t> bounds = reduction_range(begin, end, min_chunk);
+    const int64_t num_chunks = bounds.size() - 1;
+    std::vector<T> partials(num_chunks, identity);
+    parallel_for(0, num_chunks, [&](int64_t c) { partials[c] = map(bounds[c], bounds[c + 1]); });
+
+    for (int64_t stride = 1; stride < num_chunks; stride *= 2) {
+        for (int64_t c = 0; c + stride < num_chunks; c += 2 * stride) {
+            partials[c] = combine(partials[c], partials[c + stride]);
+        }
+    }
+    return partials[0];
+}
+
+// Sort the chunks of the range in parallel and then merge neighbouring chunks in
+// parallel rounds. With stable set, the result matches std::stable_sort.
+template <typename Iter, typename Compare>
+void parallel_sort(Iter first, Iter last, Compare comp, bool stable = false) {
+    constexpr int64_t MIN_SORT_CHUNK = 4096;
+    const int64_t size = last - first;
+    std::vector<int64_t> bounds = chunk_range(0, size, MIN_SORT_CHUNK);
+
+    parallel_for(0, bounds.size() - 1, [&](int64_t c) {
+        if (stable) {
+            std::stable_sort(first + bounds[c], first + bounds[c + 1], comp);
+        } else {
+            std::sort(first + bounds[c], first + bounds[c + 1], comp);
+        }
+    });
+
+    // Merge pairs of sorted runs until one is left. inplace_merge is stable.
+    while (bounds.size() > 2) {
+        const int64_t num_pairs = (bounds.size() - 1) / 2;
+        parallel_for(0, num_pairs, [&](int64_t p) {
+            std::inplace_merge(first + bounds[2 * p], first + bounds[2 * p + 1], first + bounds[2 * p + 2],
+                               comp);
+        });
+
+        std::vector<int64_t> merged;
+        for (size_t b = 0; b < bounds.size(); b += 2) merged.push_back(bounds[b]);
+        if (merged.back() != size) merged.push_back(size);
+        bounds.swap(merged);
+    }
+}
+
+} /* namespace search */
+
+#endif /* THREAD_POOL_H_ */
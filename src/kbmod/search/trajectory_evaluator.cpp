@@ -0,0 +1,383 @@
+#include "trajectory_evaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+#include "arena.h"
+#include "thread_pool.h"
+
+namespace search {
+
+// The smallest number of trajectories scored by one task.
+constexpr int64_t MIN_EVALUATION_CHUNK = 64;
+
+// Read the psi and phi values of a pixel (NO_DATA outside the images). NUM_BYTES
+// is the encoding, so the decoding is resolved at compile time.
+template <int NUM_BYTES>
+static inline PsiPhi read_psi_phi_cpu(const PsiPhiArrayMeta& meta, const void* data, int time, int row,
+                                      int col) {
+    if ((row < 0) || (col < 0) || (row >= meta.height) || (col >= meta.width)) return {NO_DATA, NO_DATA};
+
+    const uint64_t start_index = 2 * (meta.pixels_per_image * time + (uint64_t)row * meta.width + col);
+    if constexpr (NUM_BYTES == 4) {
+        const float* values = reinterpret_cast<const float*>(data);
+        return {values[start_index], values[start_index + 1]};
+    } else {
+        using Encoded = typename std::conditional<NUM_BYTES == 1, uint8_t, uint16_t>::type;
+        const Encoded* values = reinterpret_cast<const Encoded*>(data);
+        return {decode_uint_scalar((float)values[start_index], meta.psi_min_val, meta.psi_scale),
+                decode_uint_scalar((float)values[start_index + 1], meta.phi_min_val, meta.phi_scale)};
+    }
+}
+
+void sigmag_filtered_indices(const float* values, int num_values, float sgl0, float sgl1,
+                             float sigmag_coeff, float width, int* idx_array, int* min_keep_idx,
+                             int* max_keep_idx) {
+    // Nothing to keep from an empty light curve.
+    if (num_values <= 0) {
+        *min_keep_idx = 0;
+        *max_keep_idx = -1;
+        return;
+    }
+
+    // Clip the percentiles to [0.01, 99.99] to avoid invalid array accesses.
+    if (sgl0 < 0.0001) sgl0 = 0.0001;
+    if (sgl1 > 0.9999) sgl1 = 0.9999;
+
+    // Sort the indices with the same exchange sort as the kernel, so ties are
+    // broken the same way.
+    for (int j = 0; j < num_values; j++) idx_array[j] = j;
+    for (int j = 0; j < num_values; j++) {
+        for (int k = j + 1; k < num_values; k++) {
+            if (values[idx_array[j]] > values[idx_array[k]]) std::swap(idx_array[j], idx_array[k]);
+        }
+    }
+
+    // The indices of the sgl0, median and sgl1 percentiles.
+    const int pct_L = int(std::ceil(num_values * sgl0) + 0.001) - 1;
+    const int pct_H = int(std::ceil(num_values * sgl1) + 0.001) - 1;
+    const int median_ind = int(std::ceil(num_values * 0.5) + 0.001) - 1;
+
+    // Keep the values within +/- (width * sigma_g) of the median.
+    float sigma_g = sigmag_coeff * (values[idx_array[pct_H]] - values[idx_array[pct_L]]);
+    float min_value = values[idx_array[median_ind]] - width * sigma_g;
+    float max_value = values[idx_array[median_ind]] + width * sigma_g;
+
+    int start = 0;
+    while ((start < median_ind) && (values[idx_array[start]] < min_value)) ++start;
+    *min_keep_idx = start;
+
+    int end = median_ind + 1;
+    while ((end < num_values) && (values[idx_array[end]] <= max_value)) ++end;
+    *max_keep_idx = end - 1;
+}
+
+template <int NUM_BYTES>
+static void evaluate_encoded(const PsiPhiArrayMeta& meta, const void* data, const float* times,
+                             const SearchParameters& params, Trajectory& trj) {
+    ArenaScope scratch;
+    const int num_times = meta.num_times;
+    float* psi_array = scratch.arena().allocate_array<float>(num_times);
+    float* phi_array = scratch.arena().allocate_array<float>(num_times);
+    float psi_sum = 0.0;
+    float phi_sum = 0.0;
+
+    int num_seen = 0;
+    for (int i = 0; i < num_times; ++i) {
+        int current_x = trj.x + int(trj.vx * times[i] + 0.5);
+        int current_y = trj.y + int(trj.vy * times[i] + 0.5);
+
+        PsiPhi pixel_vals = read_psi_phi_cpu<NUM_BYTES>(meta, data, i, current_y, current_x);
+        if (pixel_value_valid(pixel_vals.psi) && pixel_value_valid(pixel_vals.phi)) {
+            psi_sum += pixel_vals.psi;
+            phi_sum += pixel_vals.phi;
+            psi_array[num_seen] = pixel_vals.psi;
+            phi_array[num_seen] = pixel_vals.phi;
+            num_seen += 1;
+        }
+    }
+    trj.obs_count = num_seen;
+    trj.lh = psi_sum / std::sqrt(phi_sum);
+    trj.flux = psi_sum / phi_sum;
+
+    // A trajectory that never lands on a valid pixel has no light curve to filter.
+    if (num_seen == 0 || !std::isfinite(trj.lh)) {
+        return;
+    }
+
+    // Skip the filtering of trajectories that cannot pass anyway.
+    if ((trj.obs_count < params.min_observations) || (params.do_sigmag_filter && trj.lh < params.min_lh)) {
+        return;
+    }
+
+    if (params.do_sigmag_filter) {
+        float* lc_array = scratch.arena().allocate_array<float>(num_seen);
+        int* idx_array = scratch.arena().allocate_array<int>(num_seen);
+        for (int i = 0; i < num_seen; ++i) {
+            lc_array[i] = (phi_array[i] != 0) ? (psi_array[i] / phi_array[i]) : 0;
+        }
+
+        int min_keep_idx = 0;
+        int max_keep_idx = num_seen - 1;
+        sigmag_filtered_indices(lc_array, num_seen, params.sgl_L, params.sgl_H, params.sigmag_coeff, 2.0,
+                                idx_array, &min_keep_idx, &max_keep_idx);
+
+        float new_psi_sum = 0.0;
+        float new_phi_sum = 0.0;
+        for (int i = min_keep_idx; i <= max_keep_idx; i++) {
+            new_psi_sum += psi_array[idx_array[i]];
+            new_phi_sum += phi_array[idx_array[i]];
+        }
+        trj.lh = new_psi_sum / std::sqrt(new_phi_sum);
+        trj.flux = new_psi_sum / new_phi_sum;
+    }
+}
+
+// Whether a is a better (valid) result than b.
+static inline bool is_better(const Trajectory& a, const Trajectory& b, int min_observations) {
+    if (a.obs_count < min_observations || !std::isfinite(a.lh)) return false;
+    if (b.obs_count < min_observations || !std::isfinite(b.lh)) return true;
+    return a.lh > b.lh;
+}
+
+template <int NUM_BYTES>
+static int refine_encoded(const PsiPhiArrayMeta& meta, const void* data, const float* times,
+                          const SearchParameters& params, const RefineParameters& refine, Trajectory& trj) {
+    evaluate_encoded<NUM_BYTES>(meta, data, times, params, trj);
+    int num_evaluated = 1;
+
+    float step = refine.velocity_step;
+    for (int iter = 0; iter < refine.max_iterations && step >= refine.min_velocity_step; ++iter) {
+        Trajectory best = trj;
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dvx = -1; dvx <= 1; ++dvx) {
+                    for (int dvy = -1; dvy <= 1; ++dvy) {
+                        if (dx == 0 && dy == 0 && dvx == 0 && dvy == 0) continue;
+
+                        Trajectory candidate = trj;
+                        candidate.x += dx;
+                        candidate.y += dy;
+                        candidate.vx += dvx * step;
+                        candidate.vy += dvy * step;
+                        evaluate_encoded<NUM_BYTES>(meta, data, times, params, candidate);
+                        ++num_evaluated;
+                        if (is_better(candidate, best, params.min_observations)) best = candidate;
+                    }
+                }
+            }
+        }
+
+        if (is_better(best, trj, params.min_observations)) {
+            trj = best;
+        } else {
+            step *= 0.5;
+        }
+    }
+    return num_evaluated;
+}
+
+template <int NUM_BYTES>
+static void search_rows_encoded(const std::vector<PsiPhiArray*>& psi_phi, const SearchParameters& params,
+                                const Trajectory* candidates, uint64_t num_candidates, int row_begin,
+                                int row_end, Trajectory* results) {
+    const int num_variants = psi_phi.size();
+    std::vector<const PsiPhiArrayMeta*> metas;
+    std::vector<const void*> data;
+    for (PsiPhiArray* array : psi_phi) {
+        metas.push_back(&array->get_meta_data());
+        data.push_back(array->get_cpu_array_ptr());
+    }
+    const float* times = psi_phi[0]->get_cpu_time_array_ptr();
+
+    const int search_width = params.x_start_max - params.x_start_min;
+    for (int row = row_begin; row < row_end; ++row) {
+        for (int col = 0; col < search_width; ++col) {
+            Trajectory* best = results + ((uint64_t)row * search_width + col) * RESULTS_PER_PIXEL;
+            for (int r = 0; r < RESULTS_PER_PIXEL; ++r) {
+                best[r] = Trajectory();
+                best[r].x = col + params.x_start_min;
+                best[r].y = row + params.y_start_min;
+                best[r].lh = -1.0;
+                best[r].obs_count = 0;
+            }
+
+            for (uint64_t t = 0; t < num_candidates; ++t) {
+                // Score the candidate with each variant and keep the best that passes.
+                Trajectory curr_trj;
+                bool found = false;
+                for (int v = 0; v < num_variants; ++v) {
+                    Trajectory variant_trj;
+                    variant_trj.x = col + params.x_start_min;
+                    variant_trj.y = row + params.y_start_min;
+                    variant_trj.vx = candidates[t].vx;
+                    variant_trj.vy = candidates[t].vy;
+                    variant_trj.psf_index = v;
+                    evaluate_encoded<NUM_BYTES>(*metas[v], data[v], times, params, variant_trj);
+
+                    if ((variant_trj.obs_count < params.min_observations) ||
+                        (params.do_sigmag_filter && variant_trj.lh < params.min_lh) ||
+                        !(variant_trj.lh > -1.0))
+                        continue;
+                    if (!found || variant_trj.lh > curr_trj.lh) curr_trj = variant_trj;
+                    found = true;
+                }
+                if (!found) continue;
+
+                // Insert into the sorted results as the kernel does.
+                for (int r = 0; r < RESULTS_PER_PIXEL; ++r) {
+                    if (curr_trj.lh > best[r].lh && curr_trj.lh > -1.0) std::swap(best[r], curr_trj);
+                }
+            }
+        }
+    }
+}
+
+template <int NUM_BYTES>
+static void evaluate_batch(PsiPhiArray& psi_phi, const SearchParameters& params, Trajectory* trjs,
+                           uint64_t count) {
+    const PsiPhiArrayMeta& meta = psi_phi.get_meta_data();
+    const void* data = psi_phi.get_cpu_array_ptr();
+    const float* times = psi_phi.get_cpu_time_array_ptr();
+    parallel_for(
+            0, count, [&](int64_t i) { evaluate_encoded<NUM_BYTES>(meta, data, times, params, trjs[i]); },
+            MIN_EVALUATION_CHUNK);
+}
+
+template <int NUM_BYTES>
+static void refine_batch(PsiPhiArray& psi_phi, const SearchParameters& params, const RefineParameters& refine,
+                         Trajectory* trjs, uint64_t count) {
+    const PsiPhiArrayMeta& meta = psi_phi.get_meta_data();
+    const void* data = psi_phi.get_cpu_array_ptr();
+    const float* times = psi_phi.get_cpu_time_array_ptr();
+    parallel_for(0, count, [&](int64_t i) {
+        refine_encoded<NUM_BYTES>(meta, data, times, params, refine, trjs[i]);
+    });
+}
+
+// Check the data and call the version of func for its encoding.
+template <typename Func>
+static void dispatch_encoding(PsiPhiArray& psi_phi, Trajectory* trjs, uint64_t count, Func func) {
+    if (!psi_phi.cpu_array_allocated()) throw std::runtime_error("PsiPhi data not allocated.");
+    if (count > 0 && trjs == nullptr) throw std::runtime_error("No trajectories to evaluate.");
+
+    switch (psi_phi.get_num_bytes()) {
+        case 1:
+            func(std::integral_constant<int, 1>());
+            break;
+        case 2:
+            func(std::integral_constant<int, 2>());
+            break;
+        case 4:
+            func(std::integral_constant<int, 4>());
+            break;
+        default:
+            throw std::runtime_error("Invalid PsiPhi encoding " + std::to_string(psi_phi.get_num_bytes()));
+    }
+}
+
+void evaluate_trajectories_cpu(PsiPhiArray& psi_phi, const SearchParameters& params, Trajectory* trjs,
+                               uint64_t count) {
+    dispatch_encoding(psi_phi, trjs, count,
+                      [&](auto num_bytes) { evaluate_batch<num_bytes()>(psi_phi, params, trjs, count); });
+}
+
+void evaluate_trajectory_cpu(PsiPhiArray& psi_phi, const SearchParameters& params, Trajectory& trj) {
+    evaluate_trajectories_cpu(psi_phi, params, &trj, 1);
+}
+
+static void check_refine_parameters(const RefineParameters& refine) {
+    if (refine.velocity_step <= 0.0 || refine.min_velocity_step <= 0.0) {
+        throw std::runtime_error("The refinement velocity steps must be positive.");
+    }
+}
+
+int refine_trajectory_cpu(PsiPhiArray& psi_phi, const SearchParameters& params,
+                          const RefineParameters& refine, Trajectory& trj) {
+    check_refine_parameters(refine);
+    int num_evaluated = 0;
+    const PsiPhiArrayMeta& meta = psi_phi.get_meta_data();
+    const void* data = psi_phi.get_cpu_array_ptr();
+    const float* times = psi_phi.get_cpu_time_array_ptr();
+    dispatch_encoding(psi_phi, &trj, 1, [&](auto num_bytes) {
+        num_evaluated = refine_encoded<num_bytes()>(meta, data, times, params, refine, trj);
+    });
+    return num_evaluated;
+}
+
+void refine_trajectories_cpu(PsiPhiArray& psi_phi, const SearchParameters& params,
+                             const RefineParameters& refine, Trajectory* trjs, uint64_t count) {
+    check_refine_parameters(refine);
+    dispatch_encoding(psi_phi, trjs, count, [&](auto num_bytes) {
+        refine_batch<num_bytes()>(psi_phi, params, refine, trjs, count);
+    });
+}
+
+void search_rows_cpu(const std::vector<PsiPhiArray*>& psi_phi, const SearchParameters& params,
+                     const Trajectory* candidates, uint64_t num_candidates, int row_begin, int row_end,
+                     Trajectory* results) {
+    if (psi_phi.empty() || psi_phi.size() > 256) throw std::runtime_error("Invalid number of PsiPhi arrays.");
+    if (num_candidates > 0 && candidates == nullptr) throw std::runtime_error("No candidates to search.");
+    if (row_begin < 0 || row_end > params.y_start_max - params.y_start_min) {
+        throw std::runtime_error("Search rows outside of the search area.");
+    }
+    for (PsiPhiArray* array : psi_phi) {
+        if (array == nullptr || !array->cpu_array_allocated()) {
+            throw std::runtime_error("PsiPhi data not allocated.");
+        }
+        PsiPhiArray* first = psi_phi[0];
+        if (array->get_num_bytes() != first->get_num_bytes() ||
+            array->get_num_times() != first->get_num_times() || array->get_width() != first->get_width() ||
+            array->get_height() != first->get_height()) {
+            throw std::runtime_error("PsiPhi arrays of a search must have the same size and encoding.");
+        }
+    }
+    if (row_end <= row_begin) return;
+
+    dispatch_encoding(*psi_phi[0], results, 1, [&](auto num_bytes) {
+        search_rows_encoded<num_bytes()>(psi_phi, params, candidates, num_candidates, row_begin, row_end,
+                                         results);
+    });
+}
+
+void merge_pixel_results(Trajectory* results, const Trajectory* other, uint64_t num_pixels) {
+    // Results with a likelihood of -1 or less are the placeholders of empty slots.
+    auto is_result = [](const Trajectory& trj) { return trj.lh > -1.0; };
+
+    for (uint64_t p = 0; p < num_pixels; ++p) {
+        Trajectory* a = results + p * RESULTS_PER_PIXEL;
+        const Trajectory* b = other + p * RESULTS_PER_PIXEL;
+        Trajectory merged[RESULTS_PER_PIXEL];
+        int num_merged = 0;
+        int i = 0;
+        int j = 0;
+        while (num_merged < RESULTS_PER_PIXEL) {
+            const bool a_left = (i < RESULTS_PER_PIXEL) && is_result(a[i]);
+            const bool b_left = (j < RESULTS_PER_PIXEL) && is_result(b[j]);
+            if (!a_left && !b_left) break;
+
+            // Take the better of the two heads (ties from results) and skip the velocities
+            // already taken, which were taken with a better (or equal) likelihood.
+            const Trajectory& next = (a_left && (!b_left || a[i].lh >= b[j].lh)) ? a[i++] : b[j++];
+            bool seen = false;
+            for (int m = 0; m < num_merged; ++m) {
+                if (merged[m].vx == next.vx && merged[m].vy == next.vy) seen = true;
+            }
+            if (!seen) merged[num_merged++] = next;
+        }
+
+        // Keep the placeholders of the empty slots.
+        for (int m = num_merged; m < RESULTS_PER_PIXEL; ++m) {
+            merged[m] = Trajectory();
+            merged[m].x = a[0].x;
+            merged[m].y = a[0].y;
+            merged[m].lh = -1.0;
+            merged[m].obs_count = 0;
+        }
+        std::copy(merged, merged + RESULTS_PER_PIXEL, a);
+    }
+}
+
+} /* namespace search */
@@ -0,0 +1,90 @@
+/*
+ * trajectory_evaluator.h
+ *
+ * Scoring of candidate trajectories on the CPU. Each trajectory is scored
+ * the same way as in the GPU search (the evaluateTrajectory kernel
+ * function): its psi and phi values are summed over the times where both are
+ * valid, and, with sigma-G filtering on, the sums are recomputed over the
+ * observations that pass the filter. Batches are scored in parallel on the
+ * thread pool, so refinement, known-object checks and interactive queries
+ * run without a GPU.
+ *
+ * The refinement improves the best results of a coarse grid search with a
+ * pattern search: each step scores the 80 neighbours of a trajectory in
+ * (x, y, vx, vy), one pixel and one velocity step away, and moves to the best
+ * one. When no neighbour is better the velocity step is halved, until it is
+ * below the minimum step.
+ *
+ * search_rows_cpu runs the grid search itself over a band of starting rows,
+ * keeping the RESULTS_PER_PIXEL best candidates of each pixel as the
+ * searchFilterImages kernel does. Each band runs on one thread, so bands of
+ * one or more searches can be scheduled together on the thread pool. With
+ * several psi/phi arrays (one per PSF variant) each candidate is scored against
+ * all of them in the same pass and keeps its best variant in psf_index.
+ *
+ * Created on: October 18, 2026
+ */
+
+#ifndef TRAJECTORY_EVALUATOR_H_
+#define TRAJECTORY_EVALUATOR_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "psi_phi_array_ds.h"
+
+namespace search {
+
+struct RefineParameters {
+    // The first and smallest velocity steps in pixels per day.
+    float velocity_step = 1.0;
+    float min_velocity_step = 0.05;
+    // The largest number of steps of the pattern search.
+    int max_iterations = 100;
+};
+
+// Set the obs_count, lh and flux of a trajectory from the psi/phi data.
+void evaluate_trajectory_cpu(PsiPhiArray& psi_phi, const SearchParameters& params, Trajectory& trj);
+
+// Score count trajectories in parallel.
+void evaluate_trajectories_cpu(PsiPhiArray& psi_phi, const SearchParameters& params, Trajectory* trjs,
+                               uint64_t count);
+
+// Move a trajectory to a local maximum of the likelihood (among trajectories
+// with at least params.min_observations observations). The trajectory is scored
+// first, so it is left scored even if no neighbour is better. Returns the number
+// of trajectories scored.
+int refine_trajectory_cpu(PsiPhiArray& psi_phi, const SearchParameters& params,
+                          const RefineParameters& refine, Trajectory& trj);
+
+// Refine count trajectories in parallel.
+void refine_trajectories_cpu(PsiPhiArray& psi_phi, const SearchParameters& params,
+                             const RefineParameters& refine, Trajectory* trjs, uint64_t count);
+
+// Search every candidate velocity from the starting pixels of the rows
+// [row_begin, row_end) of the search area (counted from params.y_start_min) on
+// the calling thread. results holds RESULTS_PER_PIXEL trajectories for each
+// pixel of the search area, in row-major order, with the best first. Each
+// candidate is scored with every array in psi_phi (which must share their size
+// and encoding) and keeps the best.
+void search_rows_cpu(const std::vector<PsiPhiArray*>& psi_phi, const SearchParameters& params,
+                     const Trajectory* candidates, uint64_t num_candidates, int row_begin, int row_end,
+                     Trajectory* results);
+
+// Merge the per-pixel results of another search of the same candidates (such
+// as one with a different PSF) into results, keeping the RESULTS_PER_PIXEL best
+// of each pixel with each velocity at most once. Gives the results of
+// search_rows_cpu with both sets of arrays.
+void merge_pixel_results(Trajectory* results, const Trajectory* other, uint64_t num_pixels);
+
+// The bounds [min_keep, max_keep] (in sorted order) of the values kept by the
+// sigma-G filter. idx_array is filled with the indices of the values in
+// ascending order. Matches SigmaGFilteredIndicesCU in the search kernel.
+void sigmag_filtered_indices(const float* values, int num_values, float sgl0, float sgl1,
+                             float sigmag_coeff, float width, int* idx_array, int* min_keep_idx,
+                             int* max_keep_idx);
+
+} /* namespace search */
+
+#endif /* TRAJECTORY_EVALUATOR_H_ */
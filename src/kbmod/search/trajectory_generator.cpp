@@ -0,0 +1,169 @@
+#include "trajectory_generator.h"
+
+namespace search {
+
+// -------------------------------------------
+// --- TrajectoryGenerator -------------------
+// -------------------------------------------
+
+void TrajectoryGenerator::fill_list(TrajectoryList& trj_list) const {
+    uint64_t num_trjs = size();
+    if (num_trjs > (uint64_t)std::numeric_limits<int>::max()) {
+        throw std::runtime_error("Too many candidate trajectories for a TrajectoryList.");
+    }
+    trj_list.resize((int)num_trjs);
+    fill(trj_list.get_list().data());
+}
+
+std::vector<Trajectory> TrajectoryGenerator::generate() const {
+    std::vector<Trajectory> result(size());
+    fill(result.data());
+    return result;
+}
+
+// -------------------------------------------
+// --- KBMODV1Generator ----------------------
+// -------------------------------------------
+
+KBMODV1Generator::KBMODV1Generator(int vel_steps, double min_vel, double max_vel, int ang_steps,
+                                   double min_ang, double max_ang)
+        : vel_steps(vel_steps), min_vel(min_vel), ang_steps(ang_steps), min_ang(min_ang) {
+    if (vel_steps < 1 || ang_steps < 1) {
+        throw std::runtime_error("KBMODV1Generator requires at least 1 step in each dimension");
+    }
+    if (max_vel < min_vel || max_ang < min_ang) {
+        throw std::runtime_error("Invalid KBMODV1Generator bounds.");
+    }
+    vel_stepsize = (max_vel - min_vel) / (double)vel_steps;
+    ang_stepsize = (max_ang - min_ang) / (double)ang_steps;
+}
+
+void KBMODV1Generator::fill(Trajectory* out) const {
+    // Angles are the outer loop and velocities the inner loop, matching KBMODV1Search.
+    const int64_t num_trjs = size();
+    parallel_for(0, num_trjs, [&](int64_t idx) {
+        int ang_i = idx / vel_steps;
+        int vel_i = idx % vel_steps;
+        double curr_ang = min_ang + ang_i * ang_stepsize;
+        double curr_vel = min_vel + vel_i * vel_stepsize;
+
+        Trajectory trj;
+        trj.vx = std::cos(curr_ang) * curr_vel;
+        trj.vy = std::sin(curr_ang) * curr_vel;
+        out[idx] = trj;
+    });
+}
+
+std::string KBMODV1Generator::to_string() const {
+    return "KBMODV1Generator: v=[" + std::to_string(min_vel) + ", " +
+           std::to_string(min_vel + vel_steps * vel_stepsize) + "), " + std::to_string(vel_steps) + " a=[" +
+           std::to_string(min_ang) + ", " + std::to_string(min_ang + ang_steps * ang_stepsize) + "), " +
+           std::to_string(ang_steps);
+}
+
+// -------------------------------------------
+// --- VelocityGridGenerator -----------------
+// -------------------------------------------
+
+VelocityGridGenerator::VelocityGridGenerator(int vx_steps, double min_vx, double max_vx, int vy_steps,
+                                             double min_vy, double max_vy)
+        : vx_steps(vx_steps), min_vx(min_vx), vy_steps(vy_steps), min_vy(min_vy) {
+    if (vx_steps < 2 || vy_steps < 2) {
+        throw std::runtime_error("VelocityGridGenerator requires at least 2 steps in each dimension");
+    }
+    if (max_vx < min_vx || max_vy < min_vy) {
+        throw std::runtime_error("Invalid VelocityGridGenerator bounds.");
+    }
+    vx_stepsize = (max_vx - min_vx) / (double)(vx_steps - 1);
+    vy_stepsize = (max_vy - min_vy) / (double)(vy_steps - 1);
+}
+
+void VelocityGridGenerator::fill(Trajectory* out) const {
+    // The y velocities are the outer loop, matching VelocityGridSearch.
+    const int64_t num_trjs = size();
+    parallel_for(0, num_trjs, [&](int64_t idx) {
+        int vy_i = idx / vx_steps;
+        int vx_i = idx % vx_steps;
+
+        Trajectory trj;
+        trj.vx = min_vx + vx_i * vx_stepsize;
+        trj.vy = min_vy + vy_i * vy_stepsize;
+        out[idx] = trj;
+    });
+}
+
+std::string VelocityGridGenerator::to_string() const {
+    return "VelocityGridGenerator: vx=[" + std::to_string(min_vx) + ", " +
+           std::to_string(min_vx + (vx_steps - 1) * vx_stepsize) + "], " + std::to_string(vx_steps) +
+           " vy=[" + std::to_string(min_vy) + ", " + std::to_string(min_vy + (vy_steps - 1) * vy_stepsize) +
+           "], " + std::to_string(vy_steps);
+}
+
+// -------------------------------------------
+// --- RandomVelocityGenerator ---------------
+// -------------------------------------------
+
+RandomVelocityGenerator::RandomVelocityGenerator(double min_vx, double max_vx, double min_vy, double max_vy,
+                                                 uint64_t num_samples, uint64_t seed)
+        : min_vx(min_vx),
+          max_vx(max_vx),
+          min_vy(min_vy),
+          max_vy(max_vy),
+          num_samples(num_samples),
+          seed(seed) {
+    if (max_vx < min_vx || max_vy < min_vy) {
+        throw std::runtime_error("Invalid RandomVelocityGenerator bounds.");
+    }
+    if (num_samples == 0) throw std::runtime_error("Invalid number of samples.");
+}
+
+void RandomVelocityGenerator::fill(Trajectory* out) const {
+    // Sampled serially so the sequence only depends on the seed.
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    for (uint64_t idx = 0; idx < num_samples; ++idx) {
+        Trajectory trj;
+        trj.vx = min_vx + unif(rng) * (max_vx - min_vx);
+        trj.vy = min_vy + unif(rng) * (max_vy - min_vy);
+        out[idx] = trj;
+    }
+}
+
+std::string RandomVelocityGenerator::to_string() const {
+    return "RandomVelocityGenerator: vx=[" + std::to_string(min_vx) + ", " + std::to_string(max_vx) +
+           "] vy=[" + std::to_string(min_vy) + ", " + std::to_string(max_vy) +
+           "] samples=" + std::to_string(num_samples) + " seed=" + std::to_string(seed);
+}
+
+// -------------------------------------------
+// --- Python definitions --------------------
+// -------------------------------------------
+
+#ifdef Py_PYTHON_H
+static void trajectory_generator_bindings(py::module &m) {
+    using tg = search::TrajectoryGenerator;
+    using kbg = search::KBMODV1Generator;
+    using vgg = search::VelocityGridGenerator;
+    using rvg = search::RandomVelocityGenerator;
+
+    py::class_<tg>(m, "TrajectoryGenerator", pydocs::DOC_TrajectoryGenerator)
+            .def("__len__", &tg::size)
+            .def("__str__", &tg::to_string)
+            .def("size", &tg::size, pydocs::DOC_TrajectoryGenerator_size)
+            .def("generate", &tg::generate, pydocs::DOC_TrajectoryGenerator_generate);
+    py::class_<kbg, tg>(m, "KBMODV1Generator", pydocs::DOC_KBMODV1Generator)
+            .def(py::init<int, double, double, int, double, double>(), py::arg("vel_steps"),
+                 py::arg("min_vel"), py::arg("max_vel"), py::arg("ang_steps"), py::arg("min_ang"),
+                 py::arg("max_ang"));
+    py::class_<vgg, tg>(m, "VelocityGridGenerator", pydocs::DOC_VelocityGridGenerator)
+            .def(py::init<int, double, double, int, double, double>(), py::arg("vx_steps"),
+                 py::arg("min_vx"), py::arg("max_vx"), py::arg("vy_steps"), py::arg("min_vy"),
+                 py::arg("max_vy"));
+    py::class_<rvg, tg>(m, "RandomVelocityGenerator", pydocs::DOC_RandomVelocityGenerator)
+            .def(py::init<double, double, double, double, uint64_t, uint64_t>(), py::arg("min_vx"),
+                 py::arg("max_vx"), py::arg("min_vy"), py::arg("max_vy"), py::arg("num_samples"),
+                 py::arg("seed"));
+}
+#endif /* Py_PYTHON_H */
+
+} /* namespace search */
@@ -0,0 +1,112 @@
+/*
+ * trajectory_generator.h
+ *
+ * Native generators for the candidate trajectories (velocities) tested at
+ * each starting pixel. These mirror the Python generators in
+ * kbmod/trajectory_generator.py, but write the candidates directly into
+ * a TrajectoryList so the search does not need to create a Python
+ * object per candidate.
+ *
+ * Created on: October 17, 2026
+ */
+
+#ifndef TRAJECTORY_GENERATOR_H_
+#define TRAJECTORY_GENERATOR_H_
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "thread_pool.h"
+#include "trajectory_list.h"
+#include "pydocs/trajectory_generator_docs.h"
+
+namespace search {
+
+class TrajectoryGenerator {
+public:
+    virtual ~TrajectoryGenerator(){};
+
+    // The number of candidate trajectories produced by the generator.
+    virtual uint64_t size() const = 0;
+
+    // Write the size() candidates into the memory starting at out.
+    virtual void fill(Trajectory* out) const = 0;
+
+    // Write the candidates into a TrajectoryList (resizing it).
+    void fill_list(TrajectoryList& trj_list) const;
+
+    // Return the candidates as a vector. Mostly used for testing.
+    std::vector<Trajectory> generate() const;
+
+    virtual std::string to_string() const = 0;
+};
+
+// A grid of velocity magnitudes and angles matching KBMODV1Search:
+// [min_vel, max_vel) in vel_steps and [min_ang, max_ang) in ang_steps.
+class KBMODV1Generator : public TrajectoryGenerator {
+public:
+    KBMODV1Generator(int vel_steps, double min_vel, double max_vel, int ang_steps, double min_ang,
+                     double max_ang);
+
+    uint64_t size() const override { return (uint64_t)vel_steps * (uint64_t)ang_steps; }
+    void fill(Trajectory* out) const override;
+    std::string to_string() const override;
+
+private:
+    int vel_steps;
+    double min_vel;
+    double vel_stepsize;
+    int ang_steps;
+    double min_ang;
+    double ang_stepsize;
+};
+
+// A grid of x and y velocities matching VelocityGridSearch: [min_vx, max_vx]
+// in vx_steps and [min_vy, max_vy] in vy_steps (inclusive end points).
+class VelocityGridGenerator : public TrajectoryGenerator {
+public:
+    VelocityGridGenerator(int vx_steps, double min_vx, double max_vx, int vy_steps, double min_vy,
+                          double max_vy);
+
+    uint64_t size() const override { return (uint64_t)vx_steps * (uint64_t)vy_steps; }
+    void fill(Trajectory* out) const override;
+    std::string to_string() const override;
+
+private:
+    int vx_steps;
+    double min_vx;
+    double vx_stepsize;
+    int vy_steps;
+    double min_vy;
+    double vy_stepsize;
+};
+
+// Uniformly sampled velocities matching RandomVelocitySearch. The samples
+// are fully determined by the seed.
+class RandomVelocityGenerator : public TrajectoryGenerator {
+public:
+    RandomVelocityGenerator(double min_vx, double max_vx, double min_vy, double max_vy, uint64_t num_samples,
+                            uint64_t seed);
+
+    uint64_t size() const override { return num_samples; }
+    void fill(Trajectory* out) const override;
+    std::string to_string() const override;
+
+private:
+    double min_vx;
+    double max_vx;
+    double min_vy;
+    double max_vy;
+    uint64_t num_samples;
+    uint64_t seed;
+};
+
+} /* namespace search */
+
+#endif /* TRAJECTORY_GENERATOR_H_ */
@@ -1,8 +1,9 @@
 #include "trajectory_list.h"
 #include "pydocs/trajectory_list_docs.h"
 
-#include <parallel/algorithm>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 
 namespace search {
 
@@ -10,7 +11,7 @@ namespace search {
 // --- Implementation of core data structure functions ---
 // -------------------------------------------------------
 
-TrajectoryList::TrajectoryList(int max_list_size) {
+TrajectoryList::TrajectoryList(int max_list_size) : memory(MEM_TRAJECTORY_LIST) {
     if (max_list_size < 0) {
         throw std::runtime_error("Invalid TrajectoryList size.");
     }
@@ -20,15 +21,17 @@ TrajectoryList::TrajectoryList(int max_list_size) {
     data_on_gpu = false;
     cpu_list.resize(max_size);
     gpu_array.resize(max_size);
+    update_memory();
 }
 
-TrajectoryList::TrajectoryList(const std::vector<Trajectory> &prev_list) {
+TrajectoryList::TrajectoryList(const std::vector<Trajectory> &prev_list) : memory(MEM_TRAJECTORY_LIST) {
     max_size = prev_list.size();
     cpu_list = prev_list;  // Do a full copy.
 
     // Start with the data on CPU.
     data_on_gpu = false;
     gpu_array.resize(max_size);
+    update_memory();
 }
 
 TrajectoryList::~TrajectoryList() {
@@ -46,6 +49,7 @@ void TrajectoryList::resize(int new_size) {
     cpu_list.resize(new_size);
     gpu_array.resize(new_size);
     max_size = new_size;
+    update_memory();
 }
 
 void TrajectoryList::set_trajectories(const std::vector<Trajectory> &new_values) {
@@ -71,14 +75,63 @@ std::vector<Trajectory> TrajectoryList::get_batch(int start, int count) {
 
 void TrajectoryList::sort_by_likelihood() {
     if (data_on_gpu) throw std::runtime_error("Data on GPU");
-    __gnu_parallel::sort(cpu_list.begin(), cpu_list.end(),
-                         [](Trajectory a, Trajectory b) { return b.lh < a.lh; });
+    parallel_sort(cpu_list.begin(), cpu_list.end(),
+                  [](const Trajectory& a, const Trajectory& b) { return b.lh < a.lh; });
 }
 
 void TrajectoryList::sort_by_obs_count() {
     if (data_on_gpu) throw std::runtime_error("Data on GPU");
-    __gnu_parallel::sort(cpu_list.begin(), cpu_list.end(),
-                         [](Trajectory a, Trajectory b) { return b.obs_count < a.obs_count; });
+    parallel_sort(cpu_list.begin(), cpu_list.end(),
+                  [](const Trajectory& a, const Trajectory& b) { return b.obs_count < a.obs_count; });
+}
+
+// Interleave the lower 32 bits of x and y into a 64 bit Morton (Z-order) code.
+static uint64_t morton_code(uint32_t x, uint32_t y) {
+    auto spread = [](uint64_t v) {
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFULL;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v << 2)) & 0x3333333333333333ULL;
+        v = (v | (v << 1)) & 0x5555555555555555ULL;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+void TrajectoryList::sort_by_endpoint_locality(float time_span) {
+    if (data_on_gpu) throw std::runtime_error("Data on GPU");
+    if (time_span < 0.0) throw std::runtime_error("Invalid time span.");
+
+    // Order the trajectories along a Z-order curve of their endpoint offsets (in whole
+    // pixels) so that consecutive trajectories read nearby pixels at each time step.
+    // The sort is stable, so trajectories with the same endpoint keep their order.
+    std::vector<int64_t> dx(max_size);
+    std::vector<int64_t> dy(max_size);
+    parallel_for(0, max_size, [&](int64_t i) {
+        dx[i] = std::lround(cpu_list[i].vx * time_span);
+        dy[i] = std::lround(cpu_list[i].vy * time_span);
+    });
+
+    // Offset by the smallest endpoint, so the codes start at zero. A fixed offset
+    // would put zero on a high bit of the code and split the common small offsets
+    // around it into distant parts of the curve.
+    const int64_t min_dx = (max_size > 0) ? *std::min_element(dx.begin(), dx.end()) : 0;
+    const int64_t min_dy = (max_size > 0) ? *std::min_element(dy.begin(), dy.end()) : 0;
+    std::vector<std::pair<uint64_t, int>> keys(max_size);
+    parallel_for(0, max_size, [&](int64_t i) {
+        const uint32_t x = std::min<int64_t>(dx[i] - min_dx, UINT32_MAX);
+        const uint32_t y = std::min<int64_t>(dy[i] - min_dy, UINT32_MAX);
+        keys[i] = {morton_code(x, y), (int)i};
+    });
+    using KeyPair = std::pair<uint64_t, int>;
+    parallel_sort(
+            keys.begin(), keys.end(), [](const KeyPair& a, const KeyPair& b) { return a.first < b.first; },
+            true /* stable */);
+
+    std::vector<Trajectory> sorted(max_size);
+    parallel_for(0, max_size, [&](int64_t i) { sorted[i] = cpu_list[keys[i].second]; });
+    cpu_list.swap(sorted);
+    update_memory();
 }
 
 void TrajectoryList::filter_by_likelihood(float min_likelihood) {
@@ -156,6 +209,8 @@ static void trajectory_list_binding(py::module &m) {
             .def("sort_by_likelihood", &trjl::sort_by_likelihood,
                  pydocs::DOC_TrajectoryList_sort_by_likelihood)
             .def("sort_by_obs_count", &trjl::sort_by_obs_count, pydocs::DOC_TrajectoryList_sort_by_obs_count)
+            .def("sort_by_endpoint_locality", &trjl::sort_by_endpoint_locality,
+                 pydocs::DOC_TrajectoryList_sort_by_endpoint_locality)
             .def("filter_by_likelihood", &trjl::filter_by_likelihood,
                  pydocs::DOC_TrajectoryList_filter_by_likelihood)
             .def("filter_by_obs_count", &trjl::filter_by_obs_count,
@@ -15,6 +15,8 @@
 
 #include "common.h"
 #include "gpu_array.h"
+#include "memory_tracker.h"
+#include "thread_pool.h"
 
 namespace search {
 
@@ -61,6 +63,7 @@ public:
     // Processing functions for sorting or filtering.
     void sort_by_likelihood();
     void sort_by_obs_count();
+    void sort_by_endpoint_locality(float time_span);
     void filter_by_likelihood(float min_likelihood);
     void filter_by_obs_count(int min_obs_count);
     void filter_by_valid();
@@ -74,11 +77,14 @@ public:
     inline Trajectory* get_gpu_list_ptr() { return gpu_array.get_ptr(); }
 
 private:
+    void update_memory() { memory.set((uint64_t)cpu_list.capacity() * sizeof(Trajectory)); }
+
     int max_size;
     bool data_on_gpu;
 
     std::vector<Trajectory> cpu_list;
     GPUArray<Trajectory> gpu_array;
+    TrackedBytes memory;
 };
 
 } /* namespace search */
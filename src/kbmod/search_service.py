@@ -0,0 +1,405 @@
+"""A long-lived local service that keeps a search's data resident and answers
+trajectory queries over a Unix socket.
+
+Preparing a stack for a search (masking and building the psi/phi arrays) can
+take minutes, while scoring a trajectory against the prepared data takes
+microseconds. The ``SearchService`` loads the data once and answers batched
+requests from ``SearchServiceClient``s, such as a ``TrajectoryExplorer`` in a
+notebook, so interactive sessions do not pay the setup cost again.
+
+The service is started from the command line with a WorkUnit file:
+
+    python -m kbmod.search_service --work_unit data.fits --socket /tmp/kbmod.sock
+
+Requests and responses are pickled dictionaries sent with
+``multiprocessing.connection``. The socket is only accessible to the user who
+started the service, since unpickling data from other users is not safe.
+"""
+
+import argparse
+import os
+import stat
+import time
+from multiprocessing.connection import Client, Listener
+
+import numpy as np
+
+from kbmod.search import Logging, StampCreator
+from kbmod.trajectory_explorer import TrajectoryExplorer
+from kbmod.trajectory_utils import make_trajectory
+from kbmod.work_unit import WorkUnit
+
+
+logger = Logging.getLogger(__name__)
+
+
+def _as_trajectory_array(trajectories):
+    """Convert a list of (x, y, vx, vy) tuples or an N x 4 array to a float array."""
+    trj_array = np.asarray(trajectories, dtype=np.float64)
+    if trj_array.ndim == 1 and trj_array.size == 4:
+        trj_array = trj_array.reshape(1, 4)
+    if trj_array.ndim != 2 or trj_array.shape[1] != 4:
+        raise ValueError(f"Trajectories must have shape (N, 4). Found {trj_array.shape}.")
+    return trj_array
+
+
+class SearchService:
+    """The server side of the search service. Holds the image stack and the
+    prepared psi/phi data of a single search.
+
+    Attributes
+    ----------
+    explorer : `TrajectoryExplorer`
+        The explorer holding the masked stack and the search object.
+    num_requests : `int`
+        The number of requests answered.
+    """
+
+    def __init__(self, im_stack, config=None):
+        """
+        Parameters
+        ----------
+        im_stack : `ImageStack`
+            The images to search.
+        config : `SearchConfiguration`, optional
+            The configuration parameters. If ``None`` uses the default
+            configuration parameters.
+        """
+        self.explorer = TrajectoryExplorer(im_stack, config=config)
+        self.num_requests = 0
+        self._prepared = False
+        self._handlers = {
+            "ping": self._handle_ping,
+            "info": self._handle_info,
+            "evaluate": self._handle_evaluate,
+            "psi_phi": self._handle_psi_phi,
+            "stamps": self._handle_stamps,
+            "evaluate_full": self._handle_evaluate_full,
+        }
+
+    @classmethod
+    def from_work_unit(cls, work):
+        """Create a service for the data and configuration of a WorkUnit."""
+        return cls(work.im_stack, config=work.config)
+
+    def initialize(self):
+        """Mask the images without building the psi/phi data."""
+        self.explorer.initialize_data()
+
+    def prepare(self):
+        """Mask the images and build the psi/phi data (if that has not already
+        been done)."""
+        if self._prepared:
+            return
+        start = time.time()
+        self.initialize()
+        self.explorer.search.prepare_psi_phi()
+        self._prepared = True
+        logger.info(f"Prepared the search data in {time.time() - start:.2f} seconds.")
+
+    def evaluate(self, trajectories):
+        """Score trajectories against the resident data.
+
+        Parameters
+        ----------
+        trajectories : array-like
+            The (x, y, vx, vy) of each trajectory.
+
+        Returns
+        -------
+        result : `dict`
+            The ``lh``, ``flux`` and ``obs_count`` arrays of the trajectories.
+        """
+        self.prepare()
+        trj_array = _as_trajectory_array(trajectories)
+        lh, flux, obs_count = self.explorer.search.evaluate_trajectories(trj_array.astype(np.float32))
+        return {"lh": lh, "flux": flux, "obs_count": obs_count}
+
+    def get_psi_phi_curves(self, trajectories):
+        """Compute the psi and phi curves of trajectories.
+
+        Parameters
+        ----------
+        trajectories : array-like
+            The (x, y, vx, vy) of each trajectory.
+
+        Returns
+        -------
+        result : `dict`
+            The ``psi`` and ``phi`` arrays with one row per trajectory.
+        """
+        self.prepare()
+        trj_array = _as_trajectory_array(trajectories)
+        search = self.explorer.search
+        psi = []
+        phi = []
+        for x, y, vx, vy in trj_array:
+            trj = make_trajectory(int(x), int(y), vx, vy)
+            psi.append(search.get_psi_curves(trj))
+            phi.append(search.get_phi_curves(trj))
+
+        num_times = search.get_num_images()
+        return {
+            "psi": np.array(psi, dtype=np.float32).reshape(len(psi), num_times),
+            "phi": np.array(phi, dtype=np.float32).reshape(len(phi), num_times),
+        }
+
+    def get_stamps(self, trajectories, radius=None):
+        """Cut the per-image stamps along trajectories.
+
+        Parameters
+        ----------
+        trajectories : array-like
+            The (x, y, vx, vy) of each trajectory.
+        radius : `int`, optional
+            The radius of the stamps. Defaults to the configuration's ``stamp_radius``.
+
+        Returns
+        -------
+        stamps : `numpy.ndarray`
+            The stamps as an array of shape (trajectories, times, 2 * radius + 1, 2 * radius + 1).
+        """
+        self.initialize()
+        if radius is None:
+            radius = self.explorer.config["stamp_radius"]
+        trj_array = _as_trajectory_array(trajectories)
+        width = 2 * radius + 1
+        num_times = self.explorer.im_stack.img_count()
+
+        stamps = np.zeros((trj_array.shape[0], num_times, width, width), dtype=np.float32)
+        for i, (x, y, vx, vy) in enumerate(trj_array):
+            trj = make_trajectory(int(x), int(y), vx, vy)
+            for t, stamp in enumerate(StampCreator.get_stamps(self.explorer.im_stack, trj, radius)):
+                stamps[i, t] = stamp.image
+        return stamps
+
+    def evaluate_full(self, trajectories, radius=None):
+        """Score trajectories and compute their psi and phi curves and stamps,
+        answering in one request what would otherwise take three.
+
+        Parameters
+        ----------
+        trajectories : array-like
+            The (x, y, vx, vy) of each trajectory.
+        radius : `int`, optional
+            The radius of the stamps. Defaults to the configuration's ``stamp_radius``.
+
+        Returns
+        -------
+        result : `dict`
+            The entries of ``evaluate`` and ``get_psi_phi_curves`` and the
+            ``stamps`` from ``get_stamps``.
+        """
+        result = self.evaluate(trajectories)
+        result.update(self.get_psi_phi_curves(trajectories))
+        result["stamps"] = self.get_stamps(trajectories, radius)
+        return result
+
+    def handle(self, request):
+        """Answer a single request.
+
+        Parameters
+        ----------
+        request : `dict`
+            The request, with the operation in ``op``.
+
+        Returns
+        -------
+        response : `dict`
+            The response. Failed requests have an ``error`` entry with the
+            error message.
+        """
+        self.num_requests += 1
+        op = request.get("op") if isinstance(request, dict) else None
+        if op not in self._handlers:
+            return {"error": f"Unknown request {op}"}
+        try:
+            return self._handlers[op](request)
+        except Exception as err:
+            logger.warning(f"Request {op} failed: {err}")
+            return {"error": f"{type(err).__name__}: {err}"}
+
+    def _handle_ping(self, request):
+        return {"ok": True}
+
+    def _handle_info(self, request):
+        im_stack = self.explorer.im_stack
+        return {
+            "num_times": im_stack.img_count(),
+            "width": im_stack.get_width(),
+            "height": im_stack.get_height(),
+            "zeroed_times": np.array(im_stack.build_zeroed_times()),
+            "num_requests": self.num_requests,
+        }
+
+    def _handle_evaluate(self, request):
+        return self.evaluate(request["trajectories"])
+
+    def _handle_psi_phi(self, request):
+        return self.get_psi_phi_curves(request["trajectories"])
+
+    def _handle_stamps(self, request):
+        return {"stamps": self.get_stamps(request["trajectories"], request.get("radius"))}
+
+    def _handle_evaluate_full(self, request):
+        return self.evaluate_full(request["trajectories"], request.get("radius"))
+
+    def serve(self, address, authkey=None):
+        """Answer requests on a Unix socket until a client asks the service to
+        shut down. Clients are served one at a time.
+
+        Parameters
+        ----------
+        address : `str`
+            The path of the socket. An existing socket at this path is replaced.
+        authkey : `bytes`, optional
+            A key that clients must present, in addition to the socket's
+            file permissions.
+
+        Raises
+        ------
+        FileExistsError
+            If something other than a socket exists at the path.
+        """
+        # Only replace a socket left by an earlier service, never another file.
+        if os.path.lexists(address) and not stat.S_ISSOCK(os.lstat(address).st_mode):
+            raise FileExistsError(f"{address} exists and is not a socket.")
+
+        self.prepare()
+        if os.path.lexists(address):
+            os.remove(address)
+
+        # Only the owner may connect.
+        old_umask = os.umask(0o077)
+        try:
+            listener = Listener(address, family="AF_UNIX", authkey=authkey)
+        finally:
+            os.umask(old_umask)
+
+        logger.info(f"Serving search requests on {address}")
+        running = True
+        with listener:
+            while running:
+                try:
+                    conn = listener.accept()
+                except Exception as err:
+                    logger.warning(f"Failed to accept a connection: {err}")
+                    continue
+
+                with conn:
+                    while True:
+                        try:
+                            request = conn.recv()
+                        except (EOFError, OSError):
+                            break
+
+                        if isinstance(request, dict) and request.get("op") == "shutdown":
+                            conn.send({"ok": True})
+                            running = False
+                            break
+                        conn.send(self.handle(request))
+
+        if os.path.exists(address):
+            os.remove(address)
+        logger.info(f"Stopped serving search requests after {self.num_requests} requests.")
+
+
+class SearchServiceClient:
+    """A connection to a running ``SearchService``.
+
+    Can be used as a context manager, which closes the connection on exit.
+    """
+
+    def __init__(self, address, authkey=None, timeout=None):
+        """
+        Parameters
+        ----------
+        address : `str`
+            The path of the service's socket.
+        authkey : `bytes`, optional
+            The service's key, if it has one.
+        timeout : `float`, optional
+            How long to wait (in seconds) for the service's socket to appear.
+            By default the socket must already exist.
+        """
+        if timeout is not None:
+            deadline = time.time() + timeout
+            while not os.path.exists(address) and time.time() < deadline:
+                time.sleep(0.05)
+        self._conn = Client(address, family="AF_UNIX", authkey=authkey)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        """Close the connection (the service keeps running)."""
+        if self._conn is not None:
+            self._conn.close()
+            self._conn = None
+
+    def request(self, op, **kwargs):
+        """Send a request and return the response.
+
+        Raises
+        ------
+        RuntimeError
+            If the service could not answer the request.
+        """
+        if self._conn is None:
+            raise RuntimeError("The connection to the search service is closed.")
+        kwargs["op"] = op
+        self._conn.send(kwargs)
+        response = self._conn.recv()
+        if "error" in response:
+            raise RuntimeError(f"Search service error: {response['error']}")
+        return response
+
+    def ping(self):
+        """Return ``True`` if the service is answering."""
+        return self.request("ping")["ok"]
+
+    def info(self):
+        """Return the size and times of the service's data."""
+        return self.request("info")
+
+    def evaluate(self, trajectories):
+        """Score trajectories. Returns a dictionary of ``lh``, ``flux`` and
+        ``obs_count`` arrays."""
+        return self.request("evaluate", trajectories=_as_trajectory_array(trajectories))
+
+    def get_psi_phi_curves(self, trajectories):
+        """Return a dictionary of ``psi`` and ``phi`` arrays with one row per trajectory."""
+        return self.request("psi_phi", trajectories=_as_trajectory_array(trajectories))
+
+    def get_stamps(self, trajectories, radius=None):
+        """Return the per-image stamps of each trajectory as a 4-d array."""
+        response = self.request("stamps", trajectories=_as_trajectory_array(trajectories), radius=radius)
+        return response["stamps"]
+
+    def evaluate_full(self, trajectories, radius=None):
+        """Score trajectories and return their curves and stamps in a single
+        round trip. Returns a dictionary of the ``lh``, ``flux``, ``obs_count``,
+        ``psi``, ``phi`` and ``stamps`` arrays."""
+        return self.request("evaluate_full", trajectories=_as_trajectory_array(trajectories), radius=radius)
+
+    def shutdown(self):
+        """Stop the service and close the connection."""
+        self.request("shutdown")
+        self.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Serve trajectory queries for a WorkUnit.")
+    parser.add_argument("--work_unit", required=True, help="The WorkUnit file to load.")
+    parser.add_argument("--socket", required=True, help="The path of the Unix socket to serve on.")
+    args = parser.parse_args()
+
+    service = SearchService.from_work_unit(WorkUnit.from_fits(args.work_unit))
+    service.serve(args.socket)
+
+
+if __name__ == "__main__":
+    main()
@@ -11,7 +11,7 @@ import numpy as np
 from scipy.signal import convolve2d
 
 from .standardizer import Standardizer, StandardizerConfig
-from kbmod.search import LayeredImage, RawImage, PSF
+from kbmod.search import LayeredImage, PSF
 
 
 __all__ = [
@@ -338,6 +338,5 @@ class ButlerStandardizer(Standardizer):
 
         imgs = []
         for sci, var, mask, psf, t in zip(sciences, variances, masks, psfs, mjds):
-            mask = mask.astype(np.float32)
-            imgs.append(LayeredImage(RawImage(sci, t), RawImage(var, t), RawImage(mask, t), psf))
+            imgs.append(LayeredImage(sci, var, mask, psf, t))
         return imgs
@@ -16,7 +16,7 @@ from astropy.wcs import WCS
 import numpy as np
 
 from ..standardizer import Standardizer, StandardizerConfig, ConfigurationError
-from kbmod.search import LayeredImage, RawImage, PSF
+from kbmod.search import LayeredImage, PSF
 
 
 __all__ = [
@@ -435,13 +435,11 @@ class FitsStandardizer(Standardizer):
         else:
             mjds = (meta["mjd"] for e in self.processable)
 
-        # Sci and var will be, potentially, loaded by AstroPy as float32 arrays
-        # already. Depends on the header keys really, but that's Standardizer's
-        # job. Lack of generics in CPP code forces casting of mask, making a
-        # copy. TODO: fix when/if CPP stuff is fixed.
+        # The arrays are converted to float32 (a no-op for sci and var that
+        # AstroPy already loaded as float32, a cast for the boolean mask) and
+        # then moved directly into the layers of the LayeredImage, without the
+        # intermediate RawImage copies.
         imgs = []
         for sci, var, mask, psf, t in zip(sciences, variances, masks, psfs, mjds):
-            # Converts nd array mask from bool to np.float32
-            mask = mask.astype(np.float32)
-            imgs.append(LayeredImage(RawImage(sci, t), RawImage(var, t), RawImage(mask, t), psf))
+            imgs.append(LayeredImage(sci, var, mask, psf, t))
         return imgs
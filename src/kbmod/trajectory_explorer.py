@@ -5,7 +5,7 @@ from kbmod.filters.sigma_g_filter import apply_single_clipped_sigma_g, SigmaGCli
 from kbmod.masking import apply_mask_operations
 from kbmod.result_list import ResultRow
 from kbmod.search import StackSearch, StampCreator, Logging
-from kbmod.trajectory_utils import make_trajectory_from_ra_dec
+from kbmod.trajectory_utils import make_trajectory, make_trajectory_from_ra_dec
 
 
 logger = Logging.getLogger(__name__)
@@ -22,19 +22,24 @@ class TrajectoryExplorer:
         Use verbose debug output.
     search : `kb.StackSearch`
         The search object (with cached data).
+    service : `SearchServiceClient` or `None`
+        A connection to a search service holding the data. When set, the
+        trajectories are evaluated by the service instead of locally.
     """
 
-    def __init__(self, img_stack, config=None, debug=False):
+    def __init__(self, img_stack, config=None, debug=False, service=None):
         """
         Parameters
         ----------
-        im_stack : `ImageStack`
-            The images to search.
+        im_stack : `ImageStack` or `None`
+            The images to search. May be ``None`` when using a service.
         config : `SearchConfiguration`, optional
             The configuration parameters. If ``None`` uses the default
             configuration parameters.
         debug : `bool`
             Use verbose debug output.
+        service : `SearchServiceClient`, optional
+            A connection to a ``SearchService`` with the data already prepared.
         """
         self._data_initalized = False
         self.im_stack = img_stack
@@ -43,6 +48,9 @@ class TrajectoryExplorer:
         else:
             self.config = config
         self.debug = debug
+        self.service = service
+        if img_stack is None and service is None:
+            raise ValueError("A TrajectoryExplorer needs either an ImageStack or a search service.")
 
         # Allocate and configure the StackSearch object.
         self.search = None
@@ -56,16 +64,16 @@ class TrajectoryExplorer:
         if self.config["do_mask"]:
             self.im_stack = apply_mask_operations(self.config, self.im_stack)
 
+        # Allocate the search structure.
+        self.search = StackSearch(self.im_stack)
+        self.search.set_debug(self.debug)
+
         # If we are using an encoded image representation on GPU, enable it and
         # set the parameters.
         if self.config["encode_num_bytes"] > 0:
             self.search.enable_gpu_encoding(self.config["encode_num_bytes"])
             logger.debug(f"Setting encoding = {self.config['encode_num_bytes']}")
 
-        # Allocate the search structure.
-        self.search = StackSearch(self.im_stack)
-        self.search.set_debug(self.debug)
-
         self._data_initalized = True
 
     def evaluate_linear_trajectory(self, x, y, vx, vy):
@@ -88,6 +96,8 @@ class TrajectoryExplorer:
         result : `ResultRow`
             The result data with all fields filled out.
         """
+        if self.service is not None:
+            return self._evaluate_with_service(x, y, vx, vy)
         self.initialize_data()
 
         # Evaluate the trajectory.
@@ -105,6 +115,24 @@ class TrajectoryExplorer:
 
         return result
 
+    def _evaluate_with_service(self, x, y, vx, vy):
+        """Evaluate a single linear trajectory with the search service."""
+        data = self.service.evaluate_full([(x, y, vx, vy)], self.config["stamp_radius"])
+
+        trj = make_trajectory(
+            x,
+            y,
+            vx,
+            vy,
+            flux=float(data["flux"][0]),
+            lh=float(data["lh"][0]),
+            obs_count=int(data["obs_count"][0]),
+        )
+        result = ResultRow(trj, data["psi"].shape[1])
+        result.set_psi_phi(data["psi"][0], data["phi"][0])
+        result.all_stamps = data["stamps"][0]
+        return result
+
     def evaluate_angle_trajectory(self, ra, dec, v_ra, v_dec, wcs):
         """Evaluate a single linear trajectory in angle space. Skips all the filtering
         steps and returns the raw data.
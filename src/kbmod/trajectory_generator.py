@@ -2,7 +2,12 @@ import abc
 import math
 import random
 
-from kbmod.search import Trajectory
+from kbmod.search import (
+    KBMODV1Generator,
+    RandomVelocityGenerator,
+    Trajectory,
+    VelocityGridGenerator,
+)
 from kbmod.trajectory_utils import make_trajectory
 
 
@@ -52,6 +57,19 @@ class TrajectoryGenerator(abc.ABC):
         """
         raise NotImplementedError()
 
+    def to_native(self):
+        """Create the equivalent native (C++) generator, if one exists.
+        Native generators produce the candidates directly in C++ so the search
+        does not create a Python ``Trajectory`` per candidate.
+
+        Returns
+        -------
+        generator : `kbmod.search.TrajectoryGenerator` or `None`
+            The native generator or ``None`` if this strategy has no
+            native counterpart.
+        """
+        return None
+
 
 class SingleVelocitySearch(TrajectoryGenerator):
     """Search a single velocity from each pixel."""
@@ -153,6 +171,18 @@ class VelocityGridSearch(TrajectoryGenerator):
                 vy = self.min_vy + vy_i * self.vy_stepsize
                 yield make_trajectory(vx=vx, vy=vy)
 
+    def to_native(self):
+        """Create the equivalent `kbmod.search.VelocityGridGenerator`.
+
+        Returns
+        -------
+        generator : `kbmod.search.VelocityGridGenerator`
+            The native generator producing the same candidates in the same order.
+        """
+        return VelocityGridGenerator(
+            self.vx_steps, self.min_vx, self.max_vx, self.vy_steps, self.min_vy, self.max_vy
+        )
+
 
 class KBMODV1Search(TrajectoryGenerator):
     """Search a grid defined by velocities and angles."""
@@ -224,11 +254,23 @@ class KBMODV1Search(TrajectoryGenerator):
 
                 yield make_trajectory(vx=vx, vy=vy)
 
+    def to_native(self):
+        """Create the equivalent `kbmod.search.KBMODV1Generator`.
+
+        Returns
+        -------
+        generator : `kbmod.search.KBMODV1Generator`
+            The native generator producing the same candidates in the same order.
+        """
+        return KBMODV1Generator(
+            self.vel_steps, self.min_vel, self.max_vel, self.ang_steps, self.min_ang, self.max_ang
+        )
+
 
 class RandomVelocitySearch(TrajectoryGenerator):
     """Search a grid defined by min/max bounds on pixel velocities."""
 
-    def __init__(self, min_vx, max_vx, min_vy, max_vy, max_samples=1_000_000, *args, **kwargs):
+    def __init__(self, min_vx, max_vx, min_vy, max_vy, max_samples=1_000_000, seed=None, *args, **kwargs):
         """Create a class KBMODV1Search.
 
         Parameters
@@ -244,6 +286,9 @@ class RandomVelocitySearch(TrajectoryGenerator):
         max_samples : `int`
             The maximum number of samples to generate. Used to avoid
             infinite loops in KBMOD code.
+        seed : `int`, optional
+            The seed of the native generator (see `to_native`). If ``None``
+            a seed is drawn from Python's ``random`` module.
         """
         super().__init__(*args, **kwargs)
         if max_vx < min_vx or max_vy < min_vy:
@@ -256,6 +301,7 @@ class RandomVelocitySearch(TrajectoryGenerator):
         self.min_vy = min_vy
         self.max_vy = max_vy
         self.samples_left = max_samples
+        self.seed = seed
 
     def __repr__(self):
         return (
@@ -292,3 +338,20 @@ class RandomVelocitySearch(TrajectoryGenerator):
             vx = self.min_vx + random.random() * (self.max_vx - self.min_vx)
             vy = self.min_vy + random.random() * (self.max_vy - self.min_vy)
             yield make_trajectory(vx=vx, vy=vy)
+
+    def to_native(self):
+        """Create a `kbmod.search.RandomVelocityGenerator` producing the
+        remaining number of samples. The native samples come from a different
+        random number generator than `generate`. Does not consume the samples.
+
+        Returns
+        -------
+        generator : `kbmod.search.RandomVelocityGenerator` or `None`
+            The native generator or ``None`` if there are no samples left.
+        """
+        if self.samples_left <= 0:
+            return None
+        seed = self.seed if self.seed is not None else random.getrandbits(64)
+        return RandomVelocityGenerator(
+            self.min_vx, self.max_vx, self.min_vy, self.max_vy, self.samples_left, seed
+        )
@@ -15,12 +15,14 @@ import numpy as np
 
 from astropy.coordinates import SkyCoord
 from astropy.wcs import WCS
+from astropy.wcs.utils import wcs_to_celestial_frame
 from yaml import dump, safe_load
 
 from kbmod.search import Trajectory
+from kbmod.wcs_utils import make_native_tan_wcs
 
 
-def make_trajectory(x=0, y=0, vx=0.0, vy=0.0, flux=0.0, lh=0.0, obs_count=0):
+def make_trajectory(x=0, y=0, vx=0.0, vy=0.0, flux=0.0, lh=0.0, obs_count=0, psf_index=0):
     """Create a Trajectory given the parameters with reasonable defaults.
 
     Parameters
@@ -39,6 +41,8 @@ def make_trajectory(x=0, y=0, vx=0.0, vy=0.0, flux=0.0, lh=0.0, obs_count=0):
        The computed likelihood of the trajectory (default = 0.0)
     obs_count : `int`
        The number of observations in a trajectory (default = 0)
+    psf_index : `int`
+       The PSF variant the trajectory is scored with (default = 0)
 
     Returns
     -------
@@ -53,6 +57,7 @@ def make_trajectory(x=0, y=0, vx=0.0, vy=0.0, flux=0.0, lh=0.0, obs_count=0):
     trj.flux = flux
     trj.lh = lh
     trj.obs_count = obs_count
+    trj.psf_index = psf_index
     trj.valid = True
     return trj
 
@@ -83,9 +88,17 @@ def make_trajectory_from_ra_dec(ra, dec, v_ra, v_dec, wcs):
         The resulting Trajectory object.
     """
     # Predict the pixel positions at t0 and t0 + 1
-    x0, y0 = wcs.world_to_pixel(SkyCoord(ra, dec, unit="deg"))
-    x1, y1 = wcs.world_to_pixel(SkyCoord(ra + v_ra, dec + v_dec, unit="deg"))
-    return make_trajectory(x=x0, y=y0, vx=(x1 - x0), vy=(y1 - y0))
+    tan_wcs = make_native_tan_wcs(wcs)
+    if tan_wcs is not None:
+        x0, y0 = tan_wcs.sky_to_pixel(ra, dec)
+        x1, y1 = tan_wcs.sky_to_pixel(ra + v_ra, dec + v_dec)
+    else:
+        x0, y0 = wcs.world_to_pixel(SkyCoord(ra, dec, unit="deg"))
+        x1, y1 = wcs.world_to_pixel(SkyCoord(ra + v_ra, dec + v_dec, unit="deg"))
+
+    # The native WCS returns Python floats, which do not convert to the integer
+    # pixel coordinates implicitly.
+    return make_trajectory(x=int(x0), y=int(y0), vx=float(x1 - x0), vy=float(y1 - y0))
 
 
 def trajectory_predict_skypos(trj, wcs, times):
@@ -111,17 +124,60 @@ def trajectory_predict_skypos(trj, wcs, times):
     result : `astropy.coordinates.SkyCoord`
         A SkyCoord with the transformed locations.
     """
-    dt = np.array(times)
+    dt = np.array(times, dtype=float)
     dt -= dt[0]
 
     # Predict locations in pixel space.
     x_vals = trj.x + trj.vx * dt
     y_vals = trj.y + trj.vy * dt
 
+    tan_wcs = make_native_tan_wcs(wcs)
+    if tan_wcs is not None:
+        ra, dec = tan_wcs.pixels_to_sky(x_vals, y_vals)
+        return SkyCoord(ra, dec, unit="deg", frame=wcs_to_celestial_frame(wcs))
+
     result = wcs.pixel_to_world(x_vals, y_vals)
     return result
 
 
+def trajectories_predict_skypos(trjs, wcs, times):
+    """Predict the (RA, dec) locations of many trajectories at different times.
+    Uses the native, parallel WCS when the projection is supported and a single
+    vectorized astropy call otherwise.
+
+    Parameters
+    ----------
+    trjs : `list` of `Trajectory`
+        The trajectories.
+    wcs : `astropy.wcs.WCS`
+        The WCS for the images.
+    times : `list` or `numpy.ndarray`
+        The times at which to predict the positions.
+
+    Returns
+    -------
+    ra, dec : `numpy.ndarray`, `numpy.ndarray`
+        Arrays of shape (number of trajectories, number of times) with the
+        predicted RA and dec (in degrees).
+    """
+    dt = np.array(times, dtype=float)
+    dt -= dt[0]
+
+    tan_wcs = make_native_tan_wcs(wcs)
+    if tan_wcs is not None:
+        return tan_wcs.predict_skypos(trjs, dt)
+
+    x0 = np.array([trj.x for trj in trjs], dtype=float)
+    y0 = np.array([trj.y for trj in trjs], dtype=float)
+    vx = np.array([trj.vx for trj in trjs], dtype=float)
+    vy = np.array([trj.vy for trj in trjs], dtype=float)
+    x_vals = x0[:, np.newaxis] + vx[:, np.newaxis] * dt[np.newaxis, :]
+    y_vals = y0[:, np.newaxis] + vy[:, np.newaxis] * dt[np.newaxis, :]
+
+    ra, dec = wcs.all_pix2world(x_vals, y_vals, 0)
+    return ra, dec
+
+
 def trajectory_from_np_object(result):
     """Transform a numpy object holding trajectory information
     into a trajectory object.
@@ -176,6 +232,8 @@ def trajectory_from_dict(trj_dict):
         trj.valid = bool(trj_dict["valid"])
     else:
         trj.valid = True
+    if "psf_index" in trj_dict:
+        trj.psf_index = int(trj_dict["psf_index"])
     return trj
 
 
@@ -219,5 +277,6 @@ def trajectory_to_yaml(trj):
         "lh": trj.lh,
         "obs_count": trj.obs_count,
         "valid": trj.valid,
+        "psf_index": trj.psf_index,
     }
     return dump(yaml_dict)
@@ -5,6 +5,8 @@ import astropy.units
 import astropy.wcs
 import numpy
 
+from kbmod.search import TanWCS
+
 
 def construct_wcs_tangent_projection(
     ref_val,
@@ -528,3 +530,69 @@ def wcs_fits_equal(wcs_a, wcs_b):
             return False
 
     return True
+
+
+def _pad_sip_matrices(mat_a, mat_b):
+    """Zero pad two SIP coefficient matrices to the same (square) size."""
+    size = max(mat_a.shape[0], mat_b.shape[0])
+    padded_a = numpy.zeros((size, size))
+    padded_a[: mat_a.shape[0], : mat_a.shape[1]] = mat_a
+    padded_b = numpy.zeros((size, size))
+    padded_b[: mat_b.shape[0], : mat_b.shape[1]] = mat_b
+    return padded_a, padded_b
+
+
+def make_native_tan_wcs(wcs):
+    """Create the native (C++) equivalent of an astropy WCS for fast, batched
+    pixel to sky conversions.
+
+    Only gnomonic (TAN) projections of equatorial coordinates, with optional
+    SIP distortions, and the default LONPOLE are supported.
+
+    Parameters
+    ----------
+    wcs : `astropy.wcs.WCS`
+        The WCS to convert.
+
+    Returns
+    -------
+    tan_wcs : `kbmod.search.TanWCS` or `None`
+        The native WCS or ``None`` if the WCS is not supported natively, in
+        which case the caller should fall back to astropy.
+    """
+    if wcs is None or not isinstance(wcs, astropy.wcs.WCS) or wcs.naxis != 2:
+        return None
+
+    ctype = [ct.upper() for ct in wcs.wcs.ctype]
+    if not (ctype[0].startswith("RA---TAN") and ctype[1].startswith("DEC--TAN")):
+        return None
+    if any(ct not in ("RA---TAN", "DEC--TAN", "RA---TAN-SIP", "DEC--TAN-SIP") for ct in ctype):
+        return None
+
+    # Make sure the derived values (e.g. the default LONPOLE) are computed. Astropy
+    # does the same before every transformation.
+    try:
+        wcs.wcs.set()
+    except Exception:
+        return None
+
+    # Lookup table distortions are not supported.
+    if any(d is not None for d in [wcs.cpdis1, wcs.cpdis2, wcs.det2im1, wcs.det2im2]):
+        return None
+    if not numpy.isclose(wcs.wcs.lonpole, 180.0):
+        return None
+    if any(str(unit) not in ("deg", "") for unit in wcs.wcs.cunit):
+        return None
+
+    tan_wcs = TanWCS(
+        wcs.wcs.crpix[0],
+        wcs.wcs.crpix[1],
+        wcs.wcs.crval[0],
+        wcs.wcs.crval[1],
+        wcs.pixel_scale_matrix,
+    )
+    if wcs.sip is not None:
+        tan_wcs.set_sip(*_pad_sip_matrices(wcs.sip.a, wcs.sip.b))
+        if wcs.sip.ap is not None and wcs.sip.bp is not None:
+            tan_wcs.set_inverse_sip(*_pad_sip_matrices(wcs.sip.ap, wcs.sip.bp))
+    return tan_wcs
@@ -1,3 +1,7 @@
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
+from functools import partial
+import io
 import math
 
 from astropy.io import fits
@@ -329,7 +333,7 @@ class WorkUnit:
 
         return WorkUnit.from_dict(yaml_dict)
 
-    def to_fits(self, filename, overwrite=False):
+    def to_fits(self, filename, overwrite=False, num_threads=1, compress=False):
         """Write the WorkUnit to a single FITS file.
 
         Uses the following extensions:
@@ -340,61 +344,92 @@ class WorkUnit:
                 variance layer ("VAR_i"), mask layer ("MSK_i"), and
                 PSF ("PSF_i") of each image.
 
+        The image extensions are encoded (header construction, data conversion,
+        and optional compression) by a pool of worker threads and streamed to
+        disk in order. Only a bounded number of encoded extensions are held in
+        memory at any time, so the writer never keeps a second full copy of the
+        image stack.
+
         Parameters
         ----------
         filename : `str`
             The file to which to write the data.
         overwrite : bool
             Indicates whether to overwrite an existing file.
+        num_threads : `int`
+            The number of worker threads to use for encoding the extensions.
+            Default: 1
+        compress : `bool`
+            Write the image layers as (lossless) tile compressed extensions.
+            Default: False
         """
         if Path(filename).is_file() and not overwrite:
             # are you sure you did not want to raise an error here?
             logger.error(f"Warning: WorkUnit file {filename} already exists.")
             return
+        if num_threads < 1:
+            raise ValueError(f"Invalid number of threads {num_threads}")
 
-        # Set up the initial HDU list, including the primary header
-        # the metadata (empty), and the configuration.
-        hdul = fits.HDUList()
+        # Set up the primary header.
         pri = fits.PrimaryHDU()
         pri.header["NUMIMG"] = self.im_stack.img_count()
+        pri.header["EXTEND"] = True
 
         # If the global WCS exists, append the corresponding keys.
         if self.wcs is not None:
             append_wcs_to_hdu_header(self.wcs, pri.header)
 
-        hdul.append(pri)
+        with open(filename, "wb") as file_obj:
+            pri.writeto(file_obj)
+            write_hdus_in_order(file_obj, self._fits_extension_builders(compress), num_threads)
 
-        meta_hdu = fits.BinTableHDU()
-        meta_hdu.name = "metadata"
-        hdul.append(meta_hdu)
+    def _fits_extension_builders(self, compress=False):
+        """Generate the functions that build each of the WorkUnit's FITS extensions
+        (everything except the primary HDU) in the order they are written.
 
-        config_hdu = self.config.to_hdu()
-        config_hdu.name = "kbmod_config"
-        hdul.append(config_hdu)
+        Parameters
+        ----------
+        compress : `bool`
+            Use tile compressed extensions for the image layers.
 
-        for i in range(self.im_stack.img_count()):
-            layered = self.im_stack.get_single_image(i)
+        Returns
+        -------
+        builder : generator of callables
+            Each callable takes no arguments and returns a single named HDU.
+        """
 
-            img_wcs = self.get_wcs(i)
-            sci_hdu = raw_image_to_hdu(layered.get_science(), img_wcs)
-            sci_hdu.name = f"SCI_{i}"
-            hdul.append(sci_hdu)
+        def _make_meta_hdu():
+            meta_hdu = fits.BinTableHDU()
+            meta_hdu.name = "metadata"
+            return meta_hdu
 
-            var_hdu = raw_image_to_hdu(layered.get_variance())
-            var_hdu.name = f"VAR_{i}"
-            hdul.append(var_hdu)
+        def _make_config_hdu():
+            config_hdu = self.config.to_hdu()
+            config_hdu.name = "kbmod_config"
+            return config_hdu
 
-            msk_hdu = raw_image_to_hdu(layered.get_mask())
-            msk_hdu.name = f"MSK_{i}"
-            hdul.append(msk_hdu)
+        def _make_layer_hdu(img, name, wcs=None):
+            hdu = raw_image_to_hdu(img, wcs, compress=compress)
+            hdu.name = name
+            return hdu
 
-            p = layered.get_psf()
+        def _make_psf_hdu(p, name):
             psf_array = np.array(p.get_kernel()).reshape((p.get_dim(), p.get_dim()))
             psf_hdu = fits.hdu.image.ImageHDU(psf_array)
-            psf_hdu.name = f"PSF_{i}"
-            hdul.append(psf_hdu)
+            psf_hdu.name = name
+            return psf_hdu
+
+        yield _make_meta_hdu
+        yield _make_config_hdu
+
+        for i in range(self.im_stack.img_count()):
+            layered = self.im_stack.get_single_image(i)
+            img_wcs = self.get_wcs(i)
 
-        hdul.writeto(filename)
+            yield partial(_make_layer_hdu, layered.get_science(), f"SCI_{i}", img_wcs)
+            yield partial(_make_layer_hdu, layered.get_variance(), f"VAR_{i}")
+            yield partial(_make_layer_hdu, layered.get_mask(), f"MSK_{i}")
+            yield partial(_make_psf_hdu, layered.get_psf(), f"PSF_{i}")
 
     def to_yaml(self):
         """Serialize the WorkUnit as a YAML string.
@@ -441,7 +476,7 @@ class WorkUnit:
         return dump(workunit_dict)
 
 
-def raw_image_to_hdu(img, wcs=None):
+def raw_image_to_hdu(img, wcs=None, compress=False):
     """Helper function that creates a HDU out of RawImage.
 
     Parameters
@@ -450,13 +485,20 @@ def raw_image_to_hdu(img, wcs=None):
         The RawImage to convert.
     wcs : `astropy.wcs.WCS`
         An optional WCS to include in the header.
+    compress : `bool`
+        Create a (lossless) tile compressed extension instead of a plain one.
+        Default: False
 
     Returns
     -------
-    hdu : `astropy.io.fits.hdu.image.ImageHDU`
+    hdu : `astropy.io.fits.hdu.image.ImageHDU` or `astropy.io.fits.CompImageHDU`
         The image extension.
     """
-    hdu = fits.hdu.image.ImageHDU(img.image)
+    if compress:
+        # Disable quantization so the floating point data is stored losslessly.
+        hdu = fits.CompImageHDU(img.image, compression_type="GZIP_2", quantize_level=0.0)
+    else:
+        hdu = fits.hdu.image.ImageHDU(img.image)
 
     # If the WCS is given, copy each entry into the header.
     if wcs is not None:
@@ -481,10 +523,67 @@ def hdu_to_raw_image(hdu):
         The RawImage if there is valid data and None otherwise.
     """
     img = None
-    if isinstance(hdu, fits.hdu.image.ImageHDU):
+    if isinstance(hdu, (fits.hdu.image.ImageHDU, fits.CompImageHDU)):
         # This will be a copy whenever dtype != np.single including when
         # endianness doesn't match the native float.
         img = RawImage(hdu.data.astype(np.single))
         if "MJD" in hdu.header:
             img.obstime = hdu.header["MJD"]
     return img
+
+
+def encode_extension_hdu(hdu):
+    """Serialize a single extension HDU into the bytes that appear in a FITS
+    file, including the header, the (possibly compressed) data, and padding.
+
+    Parameters
+    ----------
+    hdu : `astropy.io.fits.hdu.base.ExtensionHDU`
+        The extension to encode.
+
+    Returns
+    -------
+    data : `bytes`
+        The encoded extension.
+    """
+    # Astropy only writes full HDU lists, so we write the extension behind an
+    # empty primary header and strip the primary's bytes off the front.
+    buffer = io.BytesIO()
+    hdul = fits.HDUList([fits.PrimaryHDU(), hdu])
+    hdul.writeto(buffer)
+    return buffer.getvalue()[len(hdul[0].header.tostring()) :]
+
+
+def write_hdus_in_order(file_obj, builders, num_threads=1, max_pending=None):
+    """Build and encode extension HDUs in parallel and write them to an open
+    file in the order given.
+
+    Parameters
+    ----------
+    file_obj : file-like object
+        The binary file to which to write. It must already contain a primary HDU.
+    builders : iterable of callables
+        Each callable takes no arguments and returns a single extension HDU.
+        The callables are consumed lazily, so the HDUs (and the copies of the
+        data they hold) only exist while they are being encoded.
+    num_threads : `int`
+        The number of worker threads. Default: 1
+    max_pending : `int`, optional
+        The maximum number of extensions being encoded or waiting to be written
+        at any time. Bounds the memory used. Defaults to twice ``num_threads``.
+    """
+    if num_threads <= 1:
+        for builder in builders:
+            file_obj.write(encode_extension_hdu(builder()))
+        return
+
+    if max_pending is None:
+        max_pending = 2 * num_threads
+    pending = deque()
+    with ThreadPoolExecutor(max_workers=num_threads) as executor:
+        for builder in builders:
+            pending.append(executor.submit(lambda b: encode_extension_hdu(b()), builder))
+            if len(pending) >= max_pending:
+                file_obj.write(pending.popleft().result())
+        while pending:
+            file_obj.write(pending.popleft().result())
@@ -1,5 +1,6 @@
 import math
 import numpy as np
+import pickle
 import unittest
 
 from kbmod.search import Trajectory, pixel_value_valid
@@ -23,6 +24,20 @@ class test_common(unittest.TestCase):
         self.assertEqual(trj.get_x_pos(2.0), 9.0)
         self.assertEqual(trj.get_y_pos(2.0), 8.0)
 
+    def test_trajectory_pickle(self):
+        trj = make_trajectory(x=5, y=10, vx=2.0, vy=-1.0, flux=3.0, lh=4.0, obs_count=7)
+        trj.psf_index = 2
+        trj2 = pickle.loads(pickle.dumps(trj))
+        self.assertEqual((trj2.x, trj2.y, trj2.vx, trj2.vy), (5, 10, 2.0, -1.0))
+        self.assertEqual((trj2.flux, trj2.lh, trj2.obs_count), (3.0, 4.0, 7))
+        self.assertEqual(trj2.psf_index, 2)
+
+        # States from before psf_index have 8 entries.
+        trj3 = Trajectory.__new__(Trajectory)
+        trj3.__setstate__((2.0, -1.0, 4.0, 3.0, 5, 10, 7, True))
+        self.assertEqual(trj3.psf_index, 0)
+        self.assertEqual(trj3.obs_count, 7)
+
     def test_trajectory_is_close(self):
         trj = make_trajectory(x=5, y=10, vx=2.0, vy=-1.0)
 
@@ -0,0 +1,59 @@
+import unittest
+
+from kbmod.search import HugePages, PsiPhiArray, RawImage, fill_psi_phi_array
+
+
+class test_huge_pages(unittest.TestCase):
+    def setUp(self):
+        self.original_enabled = HugePages.get_enabled()
+
+    def tearDown(self):
+        HugePages.set_enabled(self.original_enabled)
+
+    @staticmethod
+    def _huge_bytes(report):
+        return report["hugetlb_bytes"] + report["transparent_bytes"]
+
+    def _fill_array(self, width, height):
+        psi = [RawImage(width, height, 1.0, obs_time=float(i)) for i in range(2)]
+        phi = [RawImage(width, height, 0.5, obs_time=float(i)) for i in range(2)]
+        arr = PsiPhiArray()
+        fill_psi_phi_array(arr, 4, psi, phi, [0.0, 1.0], False)
+        return arr
+
+    def test_large_buffer(self):
+        HugePages.set_enabled(True)
+        arr = self._fill_array(1024, 1024)
+        self.assertTrue(arr.cpu_array_allocated)
+        self.assertAlmostEqual(arr.read_psi_phi(1, 1023, 1023).psi, 1.0)
+
+        # Whether the kernel grants huge pages depends on the machine.
+        self.assertLessEqual(arr.cpu_huge_page_bytes, arr.total_array_size)
+        report = HugePages.get_report()
+        self.assertGreaterEqual(report["num_buffers"], 1)
+        self.assertGreaterEqual(self._huge_bytes(report), arr.total_array_size)
+        self.assertLessEqual(report["huge_page_bytes"], report["bytes"])
+
+        # Clearing frees only the array's buffer. The threads' arenas keep
+        # their blocks, which also come from HugePages.
+        array_size = arr.total_array_size
+        arr.clear()
+        cleared = HugePages.get_report()
+        self.assertEqual(cleared["num_buffers"], report["num_buffers"] - 1)
+        self.assertGreaterEqual(self._huge_bytes(report) - self._huge_bytes(cleared), array_size)
+
+    def test_disabled(self):
+        HugePages.set_enabled(False)
+        before = HugePages.get_report()
+        arr = self._fill_array(1024, 1024)
+        self.assertAlmostEqual(arr.read_psi_phi(0, 10, 10).phi, 0.5)
+
+        # Arena blocks allocated by earlier tests may still be on huge pages,
+        # but nothing new is.
+        report = HugePages.get_report()
+        self.assertFalse(report["enabled"])
+        self.assertLessEqual(self._huge_bytes(report), self._huge_bytes(before))
+
+
+if __name__ == "__main__":
+    unittest.main()
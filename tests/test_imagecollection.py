@@ -121,6 +121,24 @@ class TestImageCollection(unittest.TestCase):
         # cleanup resources
         shutil.rmtree(tmpdir)
 
+    def test_parallel_standardization(self):
+        """Test parallel standardization preserves the ordering and results."""
+        hduls = self.fitsFactory.get_n(5, spoof_data=True)
+        ic = ImageCollection.fromTargets(hduls)
+        ic2 = ImageCollection.fromTargets(hduls, num_workers=3)
+        self.assertEqual(ic, ic2)
+        self.assertRaises(ValueError, ImageCollection.fromTargets, hduls, num_workers=0)
+
+        stack = ic.toImageStack()
+        stack2 = ic2.toImageStack(num_workers=3)
+        self.assertEqual(stack.img_count(), stack2.img_count())
+        for i in range(stack.img_count()):
+            img = stack.get_single_image(i)
+            img2 = stack2.get_single_image(i)
+            self.assertEqual(img.get_obstime(), img2.get_obstime())
+            self.assertTrue(np.allclose(img.get_science().image, img2.get_science().image, equal_nan=True))
+            self.assertTrue(np.array_equal(img.get_mask().image, img2.get_mask().image))
+
 
 if __name__ == "__main__":
     unittest.main()
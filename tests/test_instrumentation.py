@@ -0,0 +1,165 @@
+import json
+import os
+import tempfile
+import unittest
+
+from kbmod.configuration import SearchConfiguration
+from kbmod.fake_data.fake_data_creator import make_fake_layered_image
+from kbmod.run_search import SearchRunner
+from kbmod.search import ImageStack, Instrumentation, Logging, PerfCounters, RawImage, PSF, ScopedTimer
+
+
+class _FailingGenerator:
+    """A trajectory generator that fails as soon as the search starts."""
+
+    def to_native(self):
+        raise RuntimeError("Search failed")
+
+
+class test_instrumentation(unittest.TestCase):
+    def setUp(self):
+        Instrumentation.set_enabled(True)
+        Instrumentation.reset()
+
+    def test_nested_timers(self):
+        with ScopedTimer("outer") as outer:
+            self.assertEqual(outer.path, "outer")
+            with ScopedTimer("inner") as inner:
+                self.assertEqual(inner.path, "outer/inner")
+            with ScopedTimer("inner"):
+                pass
+
+            # C++ phases are nested under the Python ones.
+            img = RawImage(20, 20)
+            img.convolve_gpu(PSF(1.0))
+
+        report = Instrumentation.get_report()
+        phases = report["phases"]
+        self.assertEqual(phases["outer"]["calls"], 1)
+        self.assertEqual(phases["outer/inner"]["calls"], 2)
+        self.assertIn("outer/convolve", phases)
+        self.assertGreaterEqual(phases["outer"]["total_seconds"], phases["outer/inner"]["total_seconds"])
+        self.assertLessEqual(phases["outer/inner"]["min_seconds"], phases["outer/inner"]["max_seconds"])
+
+    def test_timer_read_and_stop(self):
+        timer = ScopedTimer("phase")
+        timer.stop()
+        time1 = timer.read()
+        timer.stop()
+        self.assertAlmostEqual(time1, timer.read())
+        self.assertEqual(Instrumentation.get_report()["phases"]["phase"]["calls"], 1)
+
+    def test_timers_stopped_out_of_order(self):
+        outer = ScopedTimer("outer")
+        inner = ScopedTimer("inner")
+        outer.stop()
+
+        # Stopping the outer timer first leaves the inner phase active.
+        with ScopedTimer("next") as timer:
+            self.assertEqual(timer.path, "outer/inner/next")
+        inner.stop()
+        with ScopedTimer("next") as timer:
+            self.assertEqual(timer.path, "next")
+
+    def test_reset_clears_active_phases(self):
+        timer = ScopedTimer("abandoned")
+        Instrumentation.reset()
+        with ScopedTimer("phase") as phase:
+            self.assertEqual(phase.path, "phase")
+            timer.stop()
+            with ScopedTimer("inner") as inner:
+                self.assertEqual(inner.path, "phase/inner")
+
+    def test_counters(self):
+        Instrumentation.add_counter("items", 5)
+        Instrumentation.add_counter("items", 7)
+        Instrumentation.add_counter("other", 1)
+        counters = Instrumentation.get_report()["counters"]
+        self.assertEqual(counters["items"], 12)
+        self.assertEqual(counters["other"], 1)
+
+        Instrumentation.reset()
+        self.assertEqual(len(Instrumentation.get_report()["counters"]), 0)
+
+    def test_trace(self):
+        # Nothing is recorded until tracing is turned on.
+        with ScopedTimer("untraced"):
+            pass
+        self.assertEqual(Instrumentation.num_trace_events(), 0)
+
+        Instrumentation.set_tracing(True)
+        self.assertTrue(Instrumentation.is_tracing())
+        with ScopedTimer("outer"):
+            with ScopedTimer("inner"):
+                pass
+        Instrumentation.set_tracing(False)
+        self.assertEqual(Instrumentation.num_trace_events(), 2)
+
+        with tempfile.TemporaryDirectory() as dir_name:
+            filename = os.path.join(dir_name, "trace.json")
+            Instrumentation.write_trace(filename)
+            with open(filename) as f:
+                trace = json.load(f)
+
+        events = [evt for evt in trace["traceEvents"] if evt["ph"] == "X"]
+        self.assertEqual(len(events), 2)
+        by_name = {evt["name"]: evt for evt in events}
+        self.assertEqual(by_name["inner"]["args"]["path"], "outer/inner")
+        self.assertLessEqual(by_name["outer"]["ts"], by_name["inner"]["ts"])
+        self.assertGreaterEqual(by_name["outer"]["dur"], by_name["inner"]["dur"])
+
+    def test_perf_counters(self):
+        # The counters are opt-in and silently unavailable on some hosts.
+        self.assertFalse(PerfCounters.is_enabled())
+        enabled = PerfCounters.set_enabled(True)
+        self.assertEqual(enabled, PerfCounters.is_available())
+
+        img = RawImage(50, 50)
+        img.convolve_gpu(PSF(1.0))
+        PerfCounters.set_enabled(False)
+
+        hardware = Instrumentation.get_report()["hardware"]
+        if enabled:
+            self.assertIn("convolve", hardware)
+            self.assertGreater(hardware["convolve"]["cycles"], 0)
+            self.assertGreater(hardware["convolve"]["instructions"], 0)
+        else:
+            self.assertEqual(len(hardware), 0)
+
+    def test_disabled(self):
+        Instrumentation.set_enabled(False)
+        self.assertFalse(Instrumentation.is_enabled())
+        with ScopedTimer("phase"):
+            Instrumentation.add_counter("items", 5)
+        Instrumentation.set_enabled(True)
+
+        report = Instrumentation.get_report()
+        self.assertEqual(len(report["phases"]), 0)
+        self.assertEqual(len(report["counters"]), 0)
+
+    def test_failed_run(self):
+        images = [make_fake_layered_image(20, 20, 2.0, 4.0, i / 5, PSF(1.0), seed=i) for i in range(5)]
+        stack = ImageStack(images)
+
+        with tempfile.TemporaryDirectory() as dir_name:
+            trace_file = os.path.join(dir_name, "trace.json")
+            config = SearchConfiguration()
+            config.set("do_mask", False)
+            config.set("trace_file", trace_file)
+            config.set("perf_counters", True)
+            config.set("async_logging", True)
+            self.assertRaises(RuntimeError, SearchRunner().run_search, config, stack, _FailingGenerator())
+
+            # The run's phase ended and the events so far were written out.
+            self.assertFalse(Instrumentation.is_tracing())
+            self.assertFalse(PerfCounters.is_enabled())
+            self.assertFalse(Logging.get_async())
+            with ScopedTimer("next") as timer:
+                self.assertEqual(timer.path, "next")
+            with open(trace_file) as file:
+                events = json.load(file)["traceEvents"]
+            self.assertIn("run_search", [evt["name"] for evt in events])
+
+
+if __name__ == "__main__":
+    unittest.main()
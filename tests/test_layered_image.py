@@ -170,6 +170,27 @@ class test_LayeredImage(unittest.TestCase):
         science_pixel_psf2 = self.image.get_science().get_pixel(50, 50)
         self.assertLess(science_pixel_psf1, science_pixel_psf2)
 
+    def test_psf_grid(self):
+        self.assertFalse(self.image.has_psf_grid())
+        psi_single = self.image.generate_psi_image().image
+
+        # A grid of one cell with a different PSF replaces the image's PSF.
+        p2 = PSF(2.0)
+        self.image.set_psf_grid(PSFGrid(60, 80, 1, 1, [p2]))
+        self.assertTrue(self.image.has_psf_grid())
+        self.assertEqual(self.image.get_psf_grid().get_grid_cols(), 1)
+
+        img_b = LayeredImage(self.image.get_science(), self.image.get_variance(), self.image.get_mask(), p2)
+        self.assertTrue(np.allclose(self.image.generate_psi_image().image, img_b.generate_psi_image().image))
+        self.assertTrue(np.allclose(self.image.generate_phi_image().image, img_b.generate_phi_image().image))
+
+        self.image.clear_psf_grid()
+        self.assertFalse(self.image.has_psf_grid())
+        self.assertTrue(np.allclose(self.image.generate_psi_image().image, psi_single))
+
+        # The grid must match the image's size.
+        self.assertRaises(RuntimeError, self.image.set_psf_grid, PSFGrid(80, 60, 1, 1, [p2]))
+
     def test_mask_pixel(self):
         self.image.mask_pixel(10, 15)
         for y in range(self.image.get_height()):
@@ -0,0 +1,45 @@
+import logging
+import unittest
+
+from kbmod.search import DebugTimer, Logging
+
+
+class test_logging(unittest.TestCase):
+    def setUp(self):
+        self.logger = Logging.getLogger("kbmod.test_logging")
+        self.logger.setLevel(logging.DEBUG)
+
+    def tearDown(self):
+        Logging.set_async(False)
+
+    def test_filtered_levels(self):
+        records = []
+        handler = logging.Handler(level=logging.DEBUG)
+        handler.emit = records.append
+        self.logger.addHandler(handler)
+        self.logger.setLevel(logging.INFO)
+        try:
+            timer = DebugTimer("filtered", "kbmod.test_logging")
+            timer.stop()
+        finally:
+            self.logger.removeHandler(handler)
+        self.assertEqual(len(records), 0)
+
+    def test_async(self):
+        self.assertFalse(Logging.get_async())
+        with self.assertLogs("kbmod.test_logging", level="DEBUG") as logs:
+            Logging.set_async(True)
+            self.assertTrue(Logging.get_async())
+            timer = DebugTimer("async", "kbmod.test_logging")
+            timer.stop()
+
+            # Stopping writes the queued messages.
+            Logging.set_async(False)
+            self.assertFalse(Logging.get_async())
+        self.assertEqual(len(logs.records), 2)
+        self.assertIn("Starting async timer.", logs.output[0])
+        self.assertEqual(Logging.get_num_dropped(), 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,150 @@
+import unittest
+from unittest import mock
+
+import kbmod.search as kb
+from kbmod.configuration import SearchConfiguration
+from kbmod.fake_data.fake_data_creator import make_fake_layered_image
+from kbmod.memory_planner import (
+    GB,
+    PY_TRAJECTORY_BYTES,
+    SearchMemoryPlan,
+    get_search_bounds,
+    plan_search_memory,
+)
+from kbmod.run_search import SearchRunner, _keep_best_per_pixel
+from kbmod.trajectory_generator import RandomVelocitySearch
+
+
+class test_memory_planner(unittest.TestCase):
+    def test_search_bounds(self):
+        config = SearchConfiguration()
+        self.assertEqual(get_search_bounds(config, 100, 50), (0, 100, 0, 50))
+
+        config.set("x_pixel_buffer", 10)
+        config.set("y_pixel_bounds", [5, 20])
+        self.assertEqual(get_search_bounds(config, 100, 50), (-10, 110, 5, 20))
+
+    def test_large_budget(self):
+        # Everything fits in a single pass at full precision.
+        plan = plan_search_memory(16 * GB, 20, 1000, 1000, (0, 1000, 0, 1000), num_trajectories=10000)
+        self.assertEqual(plan.encode_num_bytes, -1)
+        self.assertEqual(plan.y_ranges, [(0, 1000)])
+        self.assertIsNone(plan.velocity_chunk_size)
+        self.assertEqual(plan.chunk_size, 500000)
+        self.assertLessEqual(plan.peak_bytes, 16 * GB)
+
+    def test_encoding(self):
+        # 20 images of 2000 x 2000 take 0.9 GB as a stack and 0.6 GB as float psi/phi
+        # images, so the float array (0.6 GB) does not fit in 2 GB.
+        plan = plan_search_memory(2 * GB, 20, 2000, 2000, (0, 2000, 0, 2000), num_trajectories=100)
+        self.assertEqual(plan.encode_num_bytes, 2)
+        self.assertLessEqual(plan.peak_bytes, 2 * GB)
+
+        # The requested encoding is the most precise allowed.
+        plan = plan_search_memory(16 * GB, 20, 100, 100, (0, 100, 0, 100), encode_num_bytes=1)
+        self.assertEqual(plan.encode_num_bytes, 1)
+
+    def test_spatial_chunks(self):
+        budget = int(0.25 * GB)
+        plan = plan_search_memory(budget, 5, 1000, 1000, (-10, 1010, 0, 1000), num_trajectories=100)
+        self.assertGreater(len(plan.y_ranges), 1)
+        self.assertLessEqual(plan.peak_bytes, budget)
+
+        # The chunks cover the rows exactly once.
+        self.assertEqual(plan.y_ranges[0][0], 0)
+        self.assertEqual(plan.y_ranges[-1][1], 1000)
+        for prev, curr in zip(plan.y_ranges[:-1], plan.y_ranges[1:]):
+            self.assertEqual(prev[1], curr[0])
+
+        # Each chunk's results fit in the estimate.
+        rows = max(y_max - y_min for y_min, y_max in plan.y_ranges)
+        self.assertEqual(plan.estimates["results"], rows * 1020 * kb.RESULTS_PER_PIXEL * kb.TRAJECTORY_BYTES)
+
+    def test_velocity_chunks(self):
+        budget = int(0.05 * GB)
+        plan = plan_search_memory(budget, 5, 100, 100, (0, 100, 0, 100), num_trajectories=10**8)
+        self.assertIsNotNone(plan.velocity_chunk_size)
+        self.assertLess(plan.velocity_chunk_size, 10**8)
+        self.assertLessEqual(plan.peak_bytes, budget)
+
+        # An unknown number of Python candidates is always chunked.
+        plan = plan_search_memory(budget, 5, 100, 100, (0, 100, 0, 100), native_candidates=False)
+        self.assertIsNotNone(plan.velocity_chunk_size)
+
+        # Chunks of native candidates are searched as Python lists.
+        plan = plan_search_memory(budget, 5, 100, 100, (0, 100, 0, 100), num_trajectories=10**8)
+        bytes_per_candidate = kb.TRAJECTORY_BYTES + PY_TRAJECTORY_BYTES
+        self.assertEqual(plan.estimates["candidates"], plan.velocity_chunk_size * bytes_per_candidate)
+
+    def _chunked_search(self, trj_generator, velocity_chunk_size):
+        """Search a small stack in two chunks of rows with the given velocity chunking."""
+        psf = kb.PSF(1.0)
+        images = [make_fake_layered_image(20, 20, 2.0, 4.0, i / 5, psf, seed=i) for i in range(5)]
+        stack = kb.ImageStack(images)
+
+        config = SearchConfiguration()
+        config.set("num_obs", 1)
+        config.set("lh_level", 0.0)
+
+        plan = SearchMemoryPlan(GB)
+        plan.y_ranges = [(0, 10), (10, 20)]
+        plan.velocity_chunk_size = velocity_chunk_size
+        plan.chunk_size = 100000
+        return SearchRunner().do_gpu_search(config, stack, trj_generator, plan)
+
+    def test_chunked_search_random_candidates(self):
+        # Every chunk of rows is searched with the same candidates, even though
+        # the random generator can only be iterated once.
+        for velocity_chunk_size in [None, 4]:
+            trj_generator = RandomVelocitySearch(-1.0, 1.0, -1.0, 1.0, max_samples=10)
+            keep = self._chunked_search(trj_generator, velocity_chunk_size)
+
+            rows = [row.trajectory.y for row in keep.results]
+            self.assertTrue(any(y < 10 for y in rows))
+            self.assertTrue(any(y >= 10 for y in rows))
+
+            velocities = set((row.trajectory.vx, row.trajectory.vy) for row in keep.results)
+            self.assertLessEqual(len(velocities), 10)
+
+    def test_chunked_search_bounded_results(self):
+        # The results are pruned to the best for each starting pixel after every
+        # chunk of velocities, so smaller chunks do not grow the kept results.
+        max_results = 20 * 20 * kb.RESULTS_PER_PIXEL
+        for velocity_chunk_size in [None, 5, 2, 1]:
+            sizes = []
+
+            def record_and_prune(result_list, max_per_pixel):
+                sizes.append(len(result_list))
+                _keep_best_per_pixel(result_list, max_per_pixel)
+
+            trj_generator = RandomVelocitySearch(-1.0, 1.0, -1.0, 1.0, max_samples=10)
+            with mock.patch("kbmod.run_search._keep_best_per_pixel", side_effect=record_and_prune):
+                keep = self._chunked_search(trj_generator, velocity_chunk_size)
+
+            num_chunks = 1 if velocity_chunk_size is None else 10 // velocity_chunk_size
+            self.assertEqual(len(sizes), num_chunks - 1)
+            self.assertLessEqual(len(keep), max_results)
+
+            # Before each pruning there is at most one pruned set plus one new chunk.
+            for size in sizes:
+                self.assertLessEqual(size, 2 * max_results)
+
+    def test_stamp_chunks(self):
+        plan = plan_search_memory(int(0.05 * GB), 5, 100, 100, (0, 100, 0, 100), stamp_radius=25)
+        self.assertLess(plan.stamp_chunk_size, 1000000)
+        self.assertLessEqual(plan.estimates["stamps"], 0.05 * GB)
+
+    def test_does_not_fit(self):
+        # The stack alone is too large.
+        self.assertRaises(ValueError, plan_search_memory, GB, 100, 2000, 2000, (0, 2000, 0, 2000))
+
+        # The psi/phi data does not fit even with the smallest encoding.
+        self.assertRaises(ValueError, plan_search_memory, GB, 40, 2000, 2000, (0, 2000, 0, 2000))
+
+        # Invalid budgets and bounds.
+        self.assertRaises(ValueError, plan_search_memory, 0, 5, 100, 100, (0, 100, 0, 100))
+        self.assertRaises(ValueError, plan_search_memory, GB, 5, 100, 100, (10, 0, 0, 100))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,74 @@
+import unittest
+
+from kbmod.fake_data.fake_data_creator import make_fake_layered_image
+from kbmod.search import PSF, MemoryStage, MemoryTracker, RawImage, TrajectoryList
+
+
+def current_bytes(category):
+    return MemoryTracker.get_report()["categories"][category]["current_bytes"]
+
+
+class test_memory_tracker(unittest.TestCase):
+    def setUp(self):
+        MemoryTracker.reset()
+
+    def test_raw_image(self):
+        start = current_bytes("raw_image")
+        img = RawImage(100, 50)
+        self.assertEqual(current_bytes("raw_image"), start + 100 * 50 * 4)
+
+        img2 = RawImage(img)
+        self.assertEqual(current_bytes("raw_image"), start + 2 * 100 * 50 * 4)
+
+        del img
+        del img2
+        self.assertEqual(current_bytes("raw_image"), start)
+
+        # The peak survives the release.
+        peak = MemoryTracker.get_report()["categories"]["raw_image"]["peak_bytes"]
+        self.assertGreaterEqual(peak, start + 2 * 100 * 50 * 4)
+
+    def test_stamps(self):
+        img = RawImage(50, 50)
+        start = current_bytes("stamps")
+        stamp = img.create_stamp(25.0, 25.0, 3, True)
+        self.assertEqual(current_bytes("stamps"), start + 7 * 7 * 4)
+        del stamp
+        self.assertEqual(current_bytes("stamps"), start)
+
+    def test_trajectory_list(self):
+        start = current_bytes("trajectory_list")
+        trjs = TrajectoryList(100)
+        self.assertGreater(current_bytes("trajectory_list"), start)
+        trjs.resize(1000)
+        self.assertGreater(current_bytes("trajectory_list"), start)
+        del trjs
+        self.assertEqual(current_bytes("trajectory_list"), start)
+
+    def test_arena(self):
+        # Convolving the variance uses the thread's scratch arena, which is kept
+        # for reuse afterward.
+        img = make_fake_layered_image(20, 10, 2.0, 4.0, 10.0, PSF(1.0))
+        img.convolve_psf()
+        self.assertGreater(current_bytes("arena"), 0)
+
+    def test_stages(self):
+        with MemoryStage("outer"):
+            with MemoryStage("inner"):
+                pass
+        report = MemoryTracker.get_report()
+        stages = report["stage_peak_rss_bytes"]
+        self.assertIn("outer", stages)
+        self.assertIn("inner", stages)
+
+        # The RSS is only available on Linux.
+        if report["rss_bytes"] > 0:
+            self.assertGreater(stages["inner"], 0)
+            self.assertGreaterEqual(stages["outer"], stages["inner"])
+
+        MemoryTracker.reset()
+        self.assertEqual(len(MemoryTracker.get_report()["stage_peak_rss_bytes"]), 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,100 @@
+import unittest
+
+import numpy as np
+
+from kbmod.fake_data.fake_data_creator import add_fake_object, make_fake_layered_image
+from kbmod.search import (
+    HAS_GPU,
+    PSF,
+    RESULTS_PER_PIXEL,
+    ImageStack,
+    StackSearch,
+    ThreadPool,
+    VelocityGridGenerator,
+    search_stacks,
+)
+from kbmod.trajectory_utils import make_trajectory
+
+
+def _make_stack(width, height, num_times, x0, y0, vx, vy, seed):
+    """Make a stack with a single bright object moving from (x0, y0) at (vx, vy)."""
+    psf = PSF(1.0)
+    images = []
+    for i in range(num_times):
+        time = i / num_times
+        im = make_fake_layered_image(width, height, 2.0, 4.0, time, psf, seed=seed + i)
+        add_fake_object(im, x0 + time * vx + 0.5, y0 + time * vy + 0.5, 200.0, psf)
+        images.append(im)
+    return ImageStack(images)
+
+
+class test_multi_stack_search(unittest.TestCase):
+    def setUp(self):
+        self.stacks = [
+            _make_stack(30, 25, 10, 5, 4, 12.0, 8.0, 100),
+            _make_stack(8, 40, 10, 3, 5, 0.0, 20.0, 200),
+            _make_stack(45, 6, 10, 4, 2, 24.0, 0.0, 300),
+        ]
+        self.candidates = [
+            make_trajectory(0, 0, vx, vy) for vx in [0.0, 12.0, 24.0] for vy in [0.0, 8.0, 20.0]
+        ]
+
+    def _num_results(self, search):
+        return search.get_image_width() * search.get_image_height() * RESULTS_PER_PIXEL
+
+    @unittest.skipIf(HAS_GPU, "Compared against the CPU search")
+    def test_matches_single_searches(self):
+        original_threads = ThreadPool.get_num_threads()
+        for num_threads in [1, 4]:
+            ThreadPool.set_num_threads(num_threads)
+            searches = [StackSearch(stack) for stack in self.stacks]
+            searches[2].enable_gpu_encoding(2)
+            search_stacks(searches, self.candidates, 5)
+
+            for stack, search in zip(self.stacks, searches):
+                single = StackSearch(stack)
+                if search is searches[2]:
+                    single.enable_gpu_encoding(2)
+                single.search(self.candidates, 5)
+
+                num_results = self._num_results(search)
+                multi_results = search.get_results(0, num_results)
+                single_results = single.get_results(0, num_results)
+                self.assertEqual(len(multi_results), num_results)
+                for a, b in zip(multi_results, single_results):
+                    self.assertEqual((a.x, a.y, a.vx, a.vy, a.obs_count), (b.x, b.y, b.vx, b.vy, b.obs_count))
+                    self.assertTrue(a.lh == b.lh or (np.isnan(a.lh) and np.isnan(b.lh)))
+        ThreadPool.set_num_threads(original_threads)
+
+    def test_finds_objects(self):
+        searches = [StackSearch(stack) for stack in self.stacks]
+        search_stacks(searches, self.candidates, 5)
+
+        expected = [(5, 4, 12.0, 8.0), (3, 5, 0.0, 20.0), (4, 2, 24.0, 0.0)]
+        for search, (x, y, vx, vy) in zip(searches, expected):
+            best = search.get_results(0, 1)[0]
+            self.assertEqual((best.x, best.y), (x, y))
+            self.assertAlmostEqual(best.vx, vx)
+            self.assertAlmostEqual(best.vy, vy)
+
+    def test_start_bounds_and_generator(self):
+        searches = [StackSearch(stack) for stack in self.stacks]
+        searches[0].set_start_bounds_x(2, 10)
+        searches[0].set_start_bounds_y(3, 6)
+        gen = VelocityGridGenerator(3, 0.0, 24.0, 2, 0.0, 20.0)
+        search_stacks(searches, gen, 5)
+
+        # Only the starting pixels in the bounds are searched.
+        results = searches[0].get_results(0, 1000)
+        self.assertEqual(len(results), 8 * 3 * RESULTS_PER_PIXEL)
+        for trj in results:
+            self.assertTrue(2 <= trj.x < 10)
+            self.assertTrue(3 <= trj.y < 6)
+
+    def test_duplicate_search(self):
+        search = StackSearch(self.stacks[0])
+        self.assertRaises(RuntimeError, search_stacks, [search, search], self.candidates, 5)
+
+
+if __name__ == "__main__":
+    unittest.main()
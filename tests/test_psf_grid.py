@@ -0,0 +1,106 @@
+import numpy as np
+import unittest
+
+from kbmod.search import PSF, PSFGrid, RawImage
+
+
+class test_PSFGrid(unittest.TestCase):
+    def setUp(self):
+        self.width = 200
+        self.height = 150
+        rng = np.random.default_rng(100)
+        self.array = rng.normal(size=(self.height, self.width)).astype(np.float32)
+        self.array[5, 7] = np.nan
+        self.psfs = [PSF(1.0), PSF(2.0), PSF(0.7), PSF(1.0)]
+
+    def convolved(self, psf):
+        img = RawImage(self.array.copy())
+        img.convolve_cpu(psf)
+        return img.image
+
+    def test_create(self):
+        grid = PSFGrid(self.width, self.height, 2, 2, self.psfs)
+        self.assertFalse(grid.empty())
+        self.assertEqual(grid.get_width(), self.width)
+        self.assertEqual(grid.get_height(), self.height)
+        self.assertEqual(grid.get_grid_cols(), 2)
+        self.assertEqual(grid.get_grid_rows(), 2)
+        self.assertTrue(grid.get_interpolate())
+        self.assertEqual(grid.get_max_radius(), self.psfs[1].get_radius())
+        self.assertAlmostEqual(grid.get_psf(0, 1).get_std(), 0.7, places=5)
+        self.assertTrue(PSFGrid().empty())
+
+        # The tiles are at most 64 pixels and stop at the cell boundaries.
+        bounds = grid.get_tile_bounds_x()
+        self.assertEqual(bounds[0], 0)
+        self.assertEqual(bounds[-1], self.width)
+        self.assertIn(100, bounds)
+        self.assertTrue(np.all(np.diff(bounds) <= 64))
+
+    def test_create_invalid(self):
+        # One PSF per cell.
+        self.assertRaises(RuntimeError, PSFGrid, self.width, self.height, 2, 1, self.psfs)
+        self.assertRaises(RuntimeError, PSFGrid, self.width, self.height, 0, 1, [])
+
+        grid = PSFGrid(self.width, self.height, 2, 2, self.psfs)
+        self.assertRaises(RuntimeError, grid.get_psf, 2, 0)
+
+    def test_psf_at(self):
+        grid = PSFGrid(self.width, self.height, 2, 2, self.psfs)
+
+        # The corners of the image are outside the cell centers and use the
+        # corner cell's PSF.
+        corner = grid.get_psf_at(0, 0)
+        self.assertTrue(np.allclose(np.array(corner), np.array(self.psfs[0])))
+
+        # Halfway between the first two cell centers the PSF is their mean.
+        mid = grid.get_psf_at(99.5, 37.0)
+        self.assertEqual(mid.get_radius(), self.psfs[1].get_radius())
+        offset = self.psfs[1].get_radius() - self.psfs[0].get_radius()
+        expected = 0.5 * np.array(self.psfs[1])
+        dim0 = self.psfs[0].get_dim()
+        expected[offset : offset + dim0, offset : offset + dim0] += 0.5 * np.array(self.psfs[0])
+        self.assertTrue(np.allclose(np.array(mid), expected, atol=1e-6))
+
+        # Without interpolation the PSF is the cell's.
+        grid.set_interpolate(False)
+        self.assertFalse(grid.get_interpolate())
+        self.assertTrue(np.allclose(np.array(grid.get_psf_at(99.5, 37.0)), np.array(self.psfs[0])))
+        self.assertTrue(np.allclose(np.array(grid.get_psf_at(100.0, 37.0)), np.array(self.psfs[1])))
+
+    def test_convolve_single_cell(self):
+        # A grid of one cell gives the same result as the PSF.
+        psf = PSF(1.5)
+        grid = PSFGrid(self.width, self.height, 1, 1, [psf])
+        img = RawImage(self.array.copy())
+        img.convolve_psf_grid(grid)
+        self.assertTrue(np.allclose(img.image, self.convolved(psf), equal_nan=True))
+
+        psf_sq = PSF(psf)
+        psf_sq.square_psf()
+        img = RawImage(self.array.copy())
+        img.convolve_psf_grid_squared(grid)
+        self.assertTrue(np.allclose(img.image, self.convolved(psf_sq), equal_nan=True))
+
+    def test_convolve_nearest(self):
+        # Every cell matches the convolution with its own PSF, including the
+        # pixels next to the other cells.
+        grid = PSFGrid(self.width, self.height, 2, 2, self.psfs, interpolate=False)
+        img = RawImage(self.array.copy())
+        img.convolve_psf_grid(grid)
+
+        for row in range(2):
+            for col in range(2):
+                expected = self.convolved(self.psfs[row * 2 + col])
+                y0, y1 = row * 75, (row + 1) * 75
+                x0, x1 = col * 100, (col + 1) * 100
+                self.assertTrue(np.allclose(img.image[y0:y1, x0:x1], expected[y0:y1, x0:x1], equal_nan=True))
+
+    def test_convolve_wrong_size(self):
+        grid = PSFGrid(self.width + 1, self.height, 1, 1, [PSF(1.0)])
+        img = RawImage(self.array.copy())
+        self.assertRaises(RuntimeError, img.convolve_psf_grid, grid)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -87,6 +87,7 @@ class test_result_data_row(unittest.TestCase):
         self.assertTrue(np.allclose(lh, [1.5, 0.0, 0.6, 2.2], atol=1e-5))
 
     def test_to_from_yaml(self):
+        self.rdr.trajectory.psf_index = 3
         yaml_str = self.rdr.to_yaml()
         self.assertGreater(len(yaml_str), 0)
 
@@ -95,6 +96,7 @@ class test_result_data_row(unittest.TestCase):
         self.assertEqual(row2.valid_indices, [0, 1, 2, 3])
         self.assertEqual(row2.valid_times(self.times), [1.0, 2.0, 3.0, 4.0])
         self.assertEqual(row2.trajectory.obs_count, 4)
+        self.assertEqual(row2.trajectory.psf_index, 3)
         self.assertIsNone(row2.stamp)
         self.assertIsNone(row2.pred_ra)
         self.assertIsNone(row2.pred_dec)
@@ -115,6 +117,7 @@ class test_result_data_row(unittest.TestCase):
             "trajectory_vx": [],
             "trajectory_vy": [],
             "obs_count": [],
+            "psf_index": [],
             "flux": [],
             "likelihood": [],
             "stamp": [],
@@ -127,7 +130,7 @@ class test_result_data_row(unittest.TestCase):
         }
         self.rdr.append_to_dict(test_dict, expand_trajectory=True)
 
-        trjB = make_trajectory(0, 1, 2.0, -3.0, 10.0, 21.0, 3)
+        trjB = make_trajectory(0, 1, 2.0, -3.0, 10.0, 21.0, 3, psf_index=2)
         rowB = ResultRow(trjB, 4)
         rowB.append_to_dict(test_dict, expand_trajectory=True)
 
@@ -150,6 +153,11 @@ class test_result_data_row(unittest.TestCase):
         del test_dict["all_stamps"]
         self.assertIsNotNone(ResultRow.from_table_row(data[0], 4))
 
+        # Tables from before the PSF variants use the images' PSFs.
+        self.assertEqual(ResultRow.from_table_row(data[1], 4).trajectory.psf_index, 2)
+        data.remove_column("psf_index")
+        self.assertEqual(ResultRow.from_table_row(data[1], 4).trajectory.psf_index, 0)
+
     def test_compute_predicted_skypos(self):
         self.assertIsNone(self.rdr.pred_ra)
         self.assertIsNone(self.rdr.pred_dec)
@@ -420,13 +428,19 @@ class test_result_list(unittest.TestCase):
         rs = ResultList(self.times, track_filtered=True)
         for i in range(5):
             trj = make_trajectory(x=49 + i, y=49 + i, vx=2 * i, vy=-3 * i, obs_count=self.num_times - i)
+            rs.append_result(ResultRow(trj, self.num_times))
 
         # Check that we have computed a position for each row and time.
         rs.compute_predicted_skypos(self.my_wcs)
+        self.assertEqual(rs.num_results(), 5)
         for row in rs.results:
             self.assertEqual(len(row.pred_ra), len(self.times))
             self.assertEqual(len(row.pred_dec), len(self.times))
 
+        # Every row needs one entry per time.
+        rs.append_result(ResultRow(make_trajectory(x=49, y=49), self.num_times - 1))
+        self.assertRaises(ValueError, rs.compute_predicted_skypos, self.my_wcs)
+
     def test_to_from_yaml(self):
         rs = ResultList(self.times, track_filtered=True)
         for i in range(10):
@@ -472,7 +486,9 @@ class test_result_list(unittest.TestCase):
         rs = ResultList(self.times, track_filtered=True)
         for i in range(10):
             # Flux and likelihood will be auto calculated during set_psi_phi()
-            trj = make_trajectory(x=i, y=2 * i, vx=100.0 - i, vy=-i, obs_count=self.num_times - i)
+            trj = make_trajectory(
+                x=i, y=2 * i, vx=100.0 - i, vy=-i, obs_count=self.num_times - i, psf_index=i % 3
+            )
             row = ResultRow(trj, self.num_times)
             row.set_psi_phi(np.array([i] * self.num_times), np.array([0.01 * i] * self.num_times))
             row.stamp = np.ones((10, 10))
@@ -488,6 +504,7 @@ class test_result_list(unittest.TestCase):
             self.assertEqual(table["trajectory_vx"][i], 100.0 - i)
             self.assertEqual(table["trajectory_vy"][i], -i)
             self.assertEqual(table["obs_count"][i], self.num_times - i)
+            self.assertEqual(table["psf_index"][i], i % 3)
             self.assertAlmostEqual(table["flux"][i], rs.results[i].trajectory.flux, delta=1e-5)
             self.assertAlmostEqual(table["likelihood"][i], rs.results[i].trajectory.lh, delta=1e-5)
             self.assertEqual(table["stamp"][i].shape, (10, 10))
@@ -535,7 +552,9 @@ class test_result_list(unittest.TestCase):
         rs = ResultList(self.times, track_filtered=False)
         for i in range(10):
             # Flux and likelihood will be auto calculated during set_psi_phi()
-            trj = make_trajectory(x=i, y=2 * i, vx=100.0 - i, vy=-i, obs_count=self.num_times - i)
+            trj = make_trajectory(
+                x=i, y=2 * i, vx=100.0 - i, vy=-i, obs_count=self.num_times - i, psf_index=i % 3
+            )
             row = ResultRow(trj, self.num_times)
             row.set_psi_phi(np.array([i] * self.num_times), np.array([0.01 * i] * self.num_times))
             row.stamp = np.ones((10, 10))
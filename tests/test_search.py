@@ -4,6 +4,7 @@ import numpy as np
 
 from kbmod.configuration import SearchConfiguration
 from kbmod.fake_data.fake_data_creator import add_fake_object, make_fake_layered_image, FakeDataSet
+from kbmod.result_list import ResultList
 from kbmod.run_search import SearchRunner
 from kbmod.search import *
 from kbmod.trajectory_generator import KBMODV1Search
@@ -178,7 +179,6 @@ class test_search(unittest.TestCase):
         self.assertEqual(results.results[0].trajectory.y, 30)
         self.assertEqual(results.results[1].trajectory.y, 40)
 
-    @unittest.skipIf(not HAS_GPU, "Skipping test (no GPU detected)")
     def test_evaluate_single_trajectory(self):
         test_trj = make_trajectory(
             x=self.start_x,
@@ -193,7 +193,6 @@ class test_search(unittest.TestCase):
         self.assertGreater(test_trj.flux, 0.0)
         self.assertGreater(test_trj.lh, 0.0)
 
-    @unittest.skipIf(not HAS_GPU, "Skipping test (no GPU detected)")
     def test_search_linear_trajectory(self):
         test_trj = self.search.search_linear_trajectory(
             self.start_x,
@@ -207,6 +206,118 @@ class test_search(unittest.TestCase):
         self.assertGreater(test_trj.flux, 0.0)
         self.assertGreater(test_trj.lh, 0.0)
 
+    def test_evaluate_trajectories(self):
+        values = np.array(
+            [
+                [self.start_x, self.start_y, self.vxel, self.vyel],
+                [5, 5, 0.0, 0.0],
+                [self.start_x, self.start_y, -self.vxel, self.vyel],
+            ]
+        )
+        original_threads = ThreadPool.get_num_threads()
+        for num_threads in [1, 4]:
+            ThreadPool.set_num_threads(num_threads)
+            lh, flux, obs_count = self.search.evaluate_trajectories(values)
+            self.assertEqual(len(lh), 3)
+            self.assertEqual(len(flux), 3)
+            self.assertEqual(len(obs_count), 3)
+
+            # The scores match those of single evaluations.
+            for i in range(3):
+                trj = make_trajectory(int(values[i, 0]), int(values[i, 1]), values[i, 2], values[i, 3])
+                self.search.evaluate_single_trajectory(trj)
+                self.assertEqual(lh[i], trj.lh)
+                self.assertEqual(flux[i], trj.flux)
+                self.assertEqual(obs_count[i], trj.obs_count)
+            self.assertGreater(lh[0], lh[1])
+            self.assertGreater(lh[0], lh[2])
+        ThreadPool.set_num_threads(original_threads)
+
+        # Lists of tuples and of Trajectory objects work too.
+        lh2, _, _ = self.search.evaluate_trajectories([tuple(row) for row in values])
+        self.assertTrue(np.array_equal(lh, lh2))
+        trjs = self.search.evaluate_trajectories([make_trajectory(5, 5, 0.0, 0.0)])
+        self.assertEqual(trjs[0].lh, lh[1])
+        self.assertRaises(RuntimeError, self.search.evaluate_trajectories, np.zeros((2, 3)))
+
+    def test_psf_variants(self):
+        self.assertEqual(self.search.get_num_psf_variants(), 0)
+        self.search.set_psf_variants([PSF(0.5), PSF(1.0), PSF(2.5)])
+        self.assertEqual(self.search.get_num_psf_variants(), 3)
+
+        # The images were made with a PSF of 1.0, so the matching variant scores best.
+        trjs = []
+        for psf_index in range(3):
+            trj = make_trajectory(self.start_x, self.start_y, self.vxel, self.vyel)
+            trj.psf_index = psf_index
+            trjs.append(trj)
+        scored = self.search.evaluate_trajectories(trjs)
+        self.assertGreater(scored[1].lh, scored[0].lh)
+        self.assertGreater(scored[1].lh, scored[2].lh)
+
+        # The search scores every variant and reports the best.
+        deltas = [-2.0, 0.0, 2.0]
+        candidates = [make_trajectory(0, 0, self.vxel + dx, self.vyel + dy) for dx in deltas for dy in deltas]
+        self.search.set_start_bounds_x(self.start_x - 2, self.start_x + 3)
+        self.search.set_start_bounds_y(self.start_y - 2, self.start_y + 3)
+        self.search.search(candidates, int(self.img_count / 2))
+        best = self.search.get_results(0, 1)[0]
+        self.assertEqual((best.x, best.y), (self.start_x, self.start_y))
+        self.assertEqual(best.psf_index, 1)
+        self.assertAlmostEqual(best.lh, scored[1].lh, delta=1e-3)
+
+        # The curves use the result's variant.
+        self.assertEqual(len(self.search.get_psi_curves(best)), self.img_count)
+
+        # The variant is kept when the results are loaded and serialized.
+        config = SearchConfiguration()
+        config.set_multiple({"lh_level": best.lh / 2.0, "max_lh": 1e10, "num_obs": int(self.img_count / 2)})
+        results = SearchRunner().load_and_filter_results(self.search, config)
+        row = max(results.results, key=lambda row: row.final_likelihood)
+        self.assertEqual((row.trajectory.x, row.trajectory.y), (self.start_x, self.start_y))
+        self.assertEqual(row.trajectory.psf_index, 1)
+
+        table = results.to_table(append_times=True)
+        self.assertTrue(np.array_equal(table["psf_index"], [r.trajectory.psf_index for r in results.results]))
+        self.assertEqual(ResultList.from_table(table), results)
+        self.assertEqual(ResultList.from_yaml(results.to_yaml()), results)
+
+        # Back to the images' own PSFs.
+        self.search.set_psf_variants([])
+        self.assertEqual(self.search.get_num_psf_variants(), 0)
+        self.search.search(candidates, int(self.img_count / 2))
+        self.assertEqual(self.search.get_results(0, 1)[0].psf_index, 0)
+
+    def test_refine_results(self):
+        # Start from perturbed versions of the true trajectory and a noise-only one.
+        starts = [
+            make_trajectory(self.start_x, self.start_y, self.vxel + 1.5, self.vyel - 1.0),
+            make_trajectory(self.start_x + 1, self.start_y, self.vxel - 0.8, self.vyel + 0.6),
+            make_trajectory(5, 70, 0.0, 0.0),
+        ]
+        starts = self.search.evaluate_trajectories(starts)
+        self.search.set_results(starts)
+
+        # Refine the first two only.
+        self.search.refine_results(2, velocity_step=1.0, min_velocity_step=0.05)
+        refined = self.search.get_results(0, 3)
+
+        truth = self.search.evaluate_trajectories([self.trj])[0]
+        for trj in refined[0:2]:
+            self.assertAlmostEqual(trj.vx, self.vxel, delta=self.velocity_error * self.vxel)
+            self.assertAlmostEqual(trj.vy, self.vyel, delta=self.velocity_error * self.vyel)
+            self.assertGreaterEqual(trj.lh, truth.lh - 1e-3)
+            self.assertGreater(trj.lh, max(starts[0].lh, starts[1].lh))
+
+        # The unrefined result is unchanged and sorted last.
+        self.assertEqual(refined[2].x, 5)
+        self.assertEqual(refined[2].y, 70)
+        self.assertEqual(refined[2].lh, starts[2].lh)
+
+        # Refining no results does nothing.
+        self.search.refine_results(0)
+        self.assertEqual(self.search.get_results(0, 3)[0].lh, refined[0].lh)
+
     @unittest.skipIf(not HAS_GPU, "Skipping test (no GPU detected)")
     def test_results(self):
         candidates = [trj for trj in self.trj_gen]
@@ -264,6 +375,22 @@ class test_search(unittest.TestCase):
         self.assertRaises(RuntimeError, self.search.enable_gpu_sigmag_filter, [0.75, 1.10], 0.5, 1.0)
         self.assertRaises(RuntimeError, self.search.enable_gpu_sigmag_filter, [0.25, 0.75], -0.5, 1.0)
 
+    def test_evaluate_off_image_sigmag(self):
+        self.search.enable_gpu_sigmag_filter([0.25, 0.75], 0.7413, 0.0)
+        self.search.set_min_obs(0)
+
+        # A trajectory that never lands on the images has no light curve to filter.
+        trj = make_trajectory(x=-100, y=-100, vx=0.0, vy=0.0)
+        self.search.evaluate_single_trajectory(trj)
+        self.assertEqual(trj.obs_count, 0)
+        self.assertFalse(np.isfinite(trj.lh))
+
+        values = np.array([[-100, -100, 0.0, 0.0], [5, 5, 0.0, 0.0]])
+        lh, _, obs_count = self.search.evaluate_trajectories(values)
+        self.assertEqual(obs_count[0], 0)
+        self.assertFalse(np.isfinite(lh[0]))
+        self.assertGreater(obs_count[1], 0)
+
     @unittest.skipIf(not HAS_GPU, "Skipping test (no GPU detected)")
     def test_results_off_chip(self):
         trj = make_trajectory(x=-3, y=12, vx=25.0, vy=10.0)
@@ -0,0 +1,103 @@
+import os
+import tempfile
+import threading
+import unittest
+
+import numpy as np
+
+from kbmod.fake_data.fake_data_creator import FakeDataSet
+from kbmod.search_service import SearchService, SearchServiceClient
+from kbmod.trajectory_explorer import TrajectoryExplorer
+from kbmod.trajectory_utils import make_trajectory
+
+
+class test_search_service(unittest.TestCase):
+    def setUp(self):
+        self.img_count = 10
+        self.trj = make_trajectory(27, 50, 21.0, -5.0, flux=500.0)
+
+        fake_times = [i / self.img_count for i in range(self.img_count)]
+        fake_ds = FakeDataSet(60, 70, fake_times, noise_level=2.0, psf_val=1.0, use_seed=True)
+        fake_ds.insert_object(self.trj)
+        self.stack = fake_ds.stack
+        self.service = SearchService(self.stack)
+
+        self.temp_dir = tempfile.TemporaryDirectory()
+        self.address = os.path.join(self.temp_dir.name, "kbmod.sock")
+        self.thread = threading.Thread(target=self.service.serve, args=(self.address,))
+        self.thread.start()
+        self.client = SearchServiceClient(self.address, timeout=30.0)
+
+    def tearDown(self):
+        self.client.shutdown()
+        self.thread.join()
+        self.temp_dir.cleanup()
+
+    def test_info(self):
+        self.assertTrue(self.client.ping())
+        info = self.client.info()
+        self.assertEqual(info["num_times"], self.img_count)
+        self.assertEqual(info["width"], 60)
+        self.assertEqual(info["height"], 70)
+        self.assertEqual(len(info["zeroed_times"]), self.img_count)
+
+        # The socket is only accessible to its owner.
+        self.assertEqual(os.stat(self.address).st_mode & 0o077, 0)
+
+    def test_errors(self):
+        self.assertRaises(RuntimeError, self.client.request, "not_an_op")
+        self.assertRaises(ValueError, self.client.get_psi_phi_curves, [(1, 2, 3)])
+        self.assertIn("error", self.service.handle({"op": "psi_phi", "trajectories": [(1, 2)]}))
+
+        # The service keeps answering after a failed request.
+        self.assertTrue(self.client.ping())
+
+    def test_psi_phi_and_stamps(self):
+        trjs = np.array([[27, 50, 21.0, -5.0], [10, 10, 0.0, 0.0]])
+        curves = self.client.get_psi_phi_curves(trjs)
+        self.assertEqual(curves["psi"].shape, (2, self.img_count))
+        self.assertEqual(curves["phi"].shape, (2, self.img_count))
+
+        # The curves match those of a local search.
+        local = TrajectoryExplorer(self.stack)
+        local.initialize_data()
+        trj = make_trajectory(27, 50, 21.0, -5.0)
+        self.assertTrue(np.allclose(curves["psi"][0], local.search.get_psi_curves(trj)))
+        self.assertTrue(np.allclose(curves["phi"][0], local.search.get_phi_curves(trj)))
+
+        stamps = self.client.get_stamps(trjs, radius=3)
+        self.assertEqual(stamps.shape, (2, self.img_count, 7, 7))
+        self.assertGreater(stamps[0, 0, 3, 3], stamps[1, 0, 3, 3])
+
+    def test_evaluate(self):
+        scores = self.client.evaluate([(27, 50, 21.0, -5.0), (10, 10, 0.0, 0.0)])
+        self.assertEqual(len(scores["lh"]), 2)
+        self.assertGreater(scores["lh"][0], scores["lh"][1])
+        self.assertEqual(scores["obs_count"][0], self.img_count)
+
+        # A combined request answers the same as the separate ones.
+        trjs = [(27, 50, 21.0, -5.0)]
+        data = self.client.evaluate_full(trjs, radius=3)
+        self.assertEqual(data["lh"][0], scores["lh"][0])
+        self.assertTrue(np.array_equal(data["psi"], self.client.get_psi_phi_curves(trjs)["psi"]))
+        self.assertTrue(np.array_equal(data["stamps"], self.client.get_stamps(trjs, radius=3)))
+
+        explorer = TrajectoryExplorer(None, service=self.client)
+        num_requests = self.service.num_requests
+        result = explorer.evaluate_linear_trajectory(27, 50, 21.0, -5.0)
+        self.assertEqual(self.service.num_requests, num_requests + 1)
+        self.assertEqual(result.trajectory.x, 27)
+        self.assertGreater(result.trajectory.lh, 50.0)
+        self.assertEqual(result.all_stamps.shape[0], self.img_count)
+
+    def test_serve_keeps_other_files(self):
+        # Only a socket left by an earlier service is replaced.
+        file_path = os.path.join(self.temp_dir.name, "data.txt")
+        with open(file_path, "w") as file:
+            file.write("data")
+        self.assertRaises(FileExistsError, SearchService(self.stack).serve, file_path)
+        self.assertTrue(os.path.isfile(file_path))
+
+
+if __name__ == "__main__":
+    unittest.main()
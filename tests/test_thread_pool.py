@@ -0,0 +1,104 @@
+import unittest
+
+import numpy as np
+
+from kbmod.search import (
+    RawImage,
+    ThreadPool,
+    TrajectoryList,
+    compute_scale_params_from_image_vect,
+    create_mean_image,
+    create_summed_image,
+)
+from kbmod.trajectory_utils import make_trajectory
+
+
+class test_thread_pool(unittest.TestCase):
+    def setUp(self):
+        self.original_threads = ThreadPool.get_num_threads()
+        self.original_deterministic = ThreadPool.get_deterministic()
+
+    def tearDown(self):
+        ThreadPool.set_num_threads(self.original_threads)
+        ThreadPool.set_deterministic(self.original_deterministic)
+
+    def test_set_num_threads(self):
+        ThreadPool.set_num_threads(3)
+        self.assertEqual(ThreadPool.get_num_threads(), 3)
+        ThreadPool.set_num_threads(1)
+        self.assertEqual(ThreadPool.get_num_threads(), 1)
+        self.assertRaises(RuntimeError, ThreadPool.set_num_threads, 0)
+
+    def test_bind_threads(self):
+        self.assertGreaterEqual(ThreadPool.get_num_numa_nodes(), 1)
+
+        original = ThreadPool.get_bind_threads()
+        ThreadPool.set_num_threads(2)
+        ThreadPool.set_bind_threads(not original)
+        self.assertEqual(ThreadPool.get_bind_threads(), not original)
+        ThreadPool.set_bind_threads(original)
+        self.assertEqual(ThreadPool.get_bind_threads(), original)
+
+    def test_parallel_sort(self):
+        num_trjs = 20000
+        for num_threads in [1, 4]:
+            ThreadPool.set_num_threads(num_threads)
+            trjs = TrajectoryList(num_trjs)
+            for i in range(num_trjs):
+                trjs.set_trajectory(i, make_trajectory(x=i, lh=float((i * 7919) % num_trjs)))
+            trjs.sort_by_likelihood()
+
+            likelihoods = [trjs.get_trajectory(i).lh for i in range(num_trjs)]
+            self.assertEqual(likelihoods, sorted(likelihoods, reverse=True))
+
+    def test_deterministic_reductions(self):
+        self.assertTrue(ThreadPool.get_deterministic())
+
+        rng = np.random.default_rng(100)
+        pixels = rng.normal(0.0, 10.0, size=(300, 400)).astype(np.float32)
+        pixels[10, 20] = np.nan
+        img = RawImage(img=pixels)
+
+        bounds = []
+        for num_threads in [1, 3, 4]:
+            ThreadPool.set_num_threads(num_threads)
+            bounds.append(img.compute_bounds())
+        self.assertEqual(bounds[0], bounds[1])
+        self.assertEqual(bounds[0], bounds[2])
+        self.assertEqual(bounds[0][0], np.nanmin(pixels))
+        self.assertEqual(bounds[0][1], np.nanmax(pixels))
+
+        ThreadPool.set_deterministic(False)
+        self.assertFalse(ThreadPool.get_deterministic())
+        self.assertEqual(img.compute_bounds(), bounds[0])
+
+    def test_deterministic_coadds(self):
+        rng = np.random.default_rng(101)
+        layers = rng.normal(5.0, 10.0, size=(5, 200, 300)).astype(np.float32)
+        layers[2, 10, 20] = np.nan
+        imgs = [RawImage(img=layer) for layer in layers]
+
+        results = []
+        for num_threads in [1, 3, 4, 7]:
+            ThreadPool.set_num_threads(num_threads)
+            results.append(
+                (
+                    create_summed_image(imgs).image,
+                    create_mean_image(imgs).image,
+                    compute_scale_params_from_image_vect(imgs, 1),
+                )
+            )
+        for summed, mean, scale_params in results[1:]:
+            self.assertTrue(np.array_equal(summed, results[0][0]))
+            self.assertTrue(np.array_equal(mean, results[0][1]))
+            self.assertEqual(scale_params, results[0][2])
+
+        summed, mean, scale_params = results[0]
+        self.assertTrue(np.allclose(summed, np.nansum(layers, axis=0), atol=1e-3))
+        self.assertTrue(np.allclose(mean, np.nanmean(layers, axis=0), atol=1e-4))
+        self.assertEqual(scale_params[0], np.nanmin(layers))
+        self.assertEqual(scale_params[1], np.nanmax(layers))
+
+
+if __name__ == "__main__":
+    unittest.main()
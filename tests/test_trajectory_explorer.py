@@ -3,7 +3,6 @@ import unittest
 import numpy as np
 
 from kbmod.fake_data.fake_data_creator import FakeDataSet
-from kbmod.search import HAS_GPU
 from kbmod.trajectory_explorer import TrajectoryExplorer
 from kbmod.trajectory_utils import make_trajectory
 
@@ -44,7 +43,6 @@ class test_trajectory_explorer(unittest.TestCase):
 
         self.explorer = TrajectoryExplorer(fake_ds.stack)
 
-    @unittest.skipIf(not HAS_GPU, "Skipping test (no GPU detected)")
     def test_evaluate_trajectory(self):
         result = self.explorer.evaluate_linear_trajectory(self.x0, self.y0, self.vx, self.vy)
 
@@ -73,6 +73,34 @@ class test_trajectory_generator(unittest.TestCase):
         gen2.reset_sample_count(20)
         self.assertEqual(len([trj for trj in gen2]), 20)
 
+    def test_native_generators(self):
+        # The native grids match the Python generators exactly and in order.
+        for gen in [
+            VelocityGridSearch(3, 0.0, 2.0, 4, -0.25, 0.25),
+            KBMODV1Search(5, 0.5, 3.0, 7, -0.25, 0.25),
+        ]:
+            trjs = [trj for trj in gen]
+            native = gen.to_native()
+            self.assertEqual(len(native), len(trjs))
+
+            native_trjs = native.generate()
+            for trj, native_trj in zip(trjs, native_trjs):
+                self.assertEqual(trj.vx, native_trj.vx)
+                self.assertEqual(trj.vy, native_trj.vy)
+
+        # The random samples are within bounds and reproducible given a seed.
+        gen = RandomVelocitySearch(0.0, 2.0, -0.25, 0.25, max_samples=100, seed=101)
+        native_trjs = gen.to_native().generate()
+        self.assertEqual(len(native_trjs), 100)
+        for trj in native_trjs:
+            self.assertTrue(0.0 <= trj.vx <= 2.0)
+            self.assertTrue(-0.25 <= trj.vy <= 0.25)
+        native_trjs2 = gen.to_native().generate()
+        self.assertTrue(all(a.vx == b.vx and a.vy == b.vy for a, b in zip(native_trjs, native_trjs2)))
+
+        # Strategies without a native counterpart fall back to None.
+        self.assertIsNone(SingleVelocitySearch(10.0, 5.0).to_native())
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -97,6 +97,31 @@ class test_trajectory_list(unittest.TestCase):
         for i in range(5):
             self.assertEqual(trjs.get_trajectory(i).x, obs_order[i])
 
+    def test_sort_by_endpoint_locality(self):
+        vx = [1.0, 0.0, 0.5, 0.0, 1.0]
+        vy = [1.0, 0.0, 0.5, 1.0, 0.0]
+        expected = [1, 2, 4, 3, 0]
+
+        trjs = TrajectoryList(5)
+        for i in range(5):
+            trjs.set_trajectory(i, make_trajectory(x=i, vx=vx[i], vy=vy[i]))
+
+        # With a time span of 2.0 the endpoint offsets are (2, 2), (0, 0), (1, 1),
+        # (0, 2), and (2, 0). The Z-order curve visits (0, 0), (1, 1), (2, 0), (0, 2), (2, 2).
+        trjs.sort_by_endpoint_locality(2.0)
+        for i in range(5):
+            self.assertEqual(trjs.get_trajectory(i).x, expected[i])
+
+        # Endpoints around zero are ordered relative to the smallest one, so
+        # shifting all of them by (-1, -1) does not change the order.
+        for i in range(5):
+            trjs.set_trajectory(i, make_trajectory(x=i, vx=vx[i] - 0.5, vy=vy[i] - 0.5))
+        trjs.sort_by_endpoint_locality(2.0)
+        for i in range(5):
+            self.assertEqual(trjs.get_trajectory(i).x, expected[i])
+
+        self.assertRaises(RuntimeError, trjs.sort_by_endpoint_locality, -1.0)
+
     def test_filter_on_lh(self):
         lh = [100.0, 110.0, 90.0, 120.0, 125.0, 121.0, 10.0]
         trjs = TrajectoryList(len(lh))
@@ -3,6 +3,7 @@ import unittest
 from astropy.wcs import WCS
 
 from kbmod.trajectory_utils import *
+from kbmod.wcs_utils import make_native_tan_wcs
 from kbmod.search import *
 
 
@@ -17,19 +18,20 @@ class test_trajectory_utils(unittest.TestCase):
         self.assertEqual(trj.lh, 6.0)
         self.assertEqual(trj.obs_count, 7)
 
-    def test_predict_skypos(self):
-        # Create a fake WCS with a known pointing.
+    def test_make_trajectory_from_ra_dec(self):
+        # Create a fake WCS with a known pointing. TAN WCSs use the native conversion.
         my_wcs = WCS(naxis=2)
         my_wcs.wcs.crpix = [10.0, 10.0]  # Reference point on the image (1-indexed)
         my_wcs.wcs.crval = [45.0, -15.0]  # Reference pointing on the sky
         my_wcs.wcs.cdelt = [0.1, 0.1]  # Pixel step size
         my_wcs.wcs.ctype = ["RA---TAN-SIP", "DEC--TAN-SIP"]
+        self.assertIsNotNone(make_native_tan_wcs(my_wcs))
 
-        trj = make_trajectory_from_ra_dec(45.0, -15.0, 1.0, 0.5)
-        self.assertAlmostEqual(trj.x, 9.0)
-        self.assertAlmostEqual(trj.y, 9.0)
-        self.assertAlmostEqual(trj.vx, 9.9190138, delta=1e-6)
-        self.assertAlmostEqual(trj.vy, 4.97896903, delta=1e-6)
+        trj = make_trajectory_from_ra_dec(45.0, -15.0, 1.0, 0.5, my_wcs)
+        self.assertEqual(trj.x, 9)
+        self.assertEqual(trj.y, 9)
+        self.assertAlmostEqual(trj.vx, 9.6827327, delta=1e-5)
+        self.assertAlmostEqual(trj.vy, 4.9789690, delta=1e-5)
 
     def test_predict_skypos(self):
         # Create a fake WCS with a known pointing.
@@ -54,6 +56,26 @@ class test_trajectory_utils(unittest.TestCase):
         self.assertAlmostEqual(my_sky.ra[1].deg, 45.2, delta=0.01)
         self.assertAlmostEqual(my_sky.dec[1].deg, -15.5, delta=0.01)
 
+    def test_trajectories_predict_skypos(self):
+        my_wcs = WCS(naxis=2)
+        my_wcs.wcs.crpix = [10.0, 10.0]
+        my_wcs.wcs.crval = [45.0, -15.0]
+        my_wcs.wcs.cdelt = [0.1, 0.1]
+        my_wcs.wcs.ctype = ["RA---TAN-SIP", "DEC--TAN-SIP"]
+
+        times = [10.0, 10.5, 11.0, 12.5]
+        trjs = [make_trajectory(x=9 + i, y=9 - i, vx=2.0 * i, vy=-5.0 + i) for i in range(5)]
+
+        # The batch predictions match the per-trajectory astropy predictions.
+        ra, dec = trajectories_predict_skypos(trjs, my_wcs, times)
+        self.assertEqual(ra.shape, (5, 4))
+        self.assertEqual(dec.shape, (5, 4))
+        dt = np.array(times) - times[0]
+        for i, trj in enumerate(trjs):
+            expected = my_wcs.pixel_to_world(trj.x + trj.vx * dt, trj.y + trj.vy * dt)
+            self.assertTrue(np.allclose(ra[i], expected.ra.deg, rtol=0.0, atol=1e-9))
+            self.assertTrue(np.allclose(dec[i], expected.dec.deg, rtol=0.0, atol=1e-9))
+
     def test_trajectory_from_np_object(self):
         np_obj = np.array(
             [(300.0, 750.0, 106.0, 44.0, 9.52, -0.5, 10.0)],
@@ -96,10 +118,14 @@ class test_trajectory_utils(unittest.TestCase):
         self.assertEqual(trj.flux, 5.0)
         self.assertEqual(trj.lh, 6.0)
         self.assertEqual(trj.obs_count, 7)
+        self.assertEqual(trj.psf_index, 0)
+
+        trj_dict["psf_index"] = 2
+        self.assertEqual(trajectory_from_dict(trj_dict).psf_index, 2)
 
     def test_trajectory_yaml(self):
         """Test serializing and then deserializing the Trajectory to a YAML."""
-        org_trj = make_trajectory(x=1, y=2, vx=3.0, vy=4.0, flux=5.0, lh=6.0, obs_count=7)
+        org_trj = make_trajectory(x=1, y=2, vx=3.0, vy=4.0, flux=5.0, lh=6.0, obs_count=7, psf_index=2)
         yaml_str = trajectory_to_yaml(org_trj)
         self.assertGreater(len(yaml_str), 0)
 
@@ -111,6 +137,7 @@ class test_trajectory_utils(unittest.TestCase):
         self.assertEqual(new_trj.flux, 5.0)
         self.assertEqual(new_trj.lh, 6.0)
         self.assertEqual(new_trj.obs_count, 7)
+        self.assertEqual(new_trj.psf_index, 2)
 
 
 if __name__ == "__main__":
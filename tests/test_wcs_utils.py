@@ -4,6 +4,7 @@ import astropy.coordinates
 import astropy.units
 from astropy.wcs import WCS
 from astropy.io import fits
+import numpy as np
 
 from kbmod.wcs_utils import *
 
@@ -107,6 +108,48 @@ class test_wcs_conversion(unittest.TestCase):
         self.assertAlmostEqual(pos.ra.degree, 25.01, delta=0.01)
         self.assertAlmostEqual(pos.dec.degree, -10.0, delta=0.01)
 
+    def test_make_native_tan_wcs(self):
+        sip_dict = {
+            "CTYPE1": "RA---TAN-SIP",
+            "CTYPE2": "DEC--TAN-SIP",
+            "CRVAL1": 200.614997245422,
+            "CRVAL2": -7.78878863332778,
+            "CRPIX1": 1033.934327,
+            "CRPIX2": 2043.548284,
+            "CD1_1": -1.13926485986789e-07,
+            "CD1_2": 7.31839748843125e-05,
+            "CD2_1": -7.30064978350695e-05,
+            "CD2_2": -1.27520156332774e-07,
+            "A_ORDER": 3,
+            "A_2_0": 3.0e-6,
+            "A_1_1": -1.0e-6,
+            "A_3_0": 1.0e-9,
+            "B_ORDER": 3,
+            "B_0_2": -2.0e-6,
+            "B_2_1": 2.0e-10,
+        }
+        for wcs in [WCS(sip_dict), self.wcs, WCS(make_fake_wcs_info(25.0, -10.0, 200, 100, 0.01))]:
+            tan_wcs = make_native_tan_wcs(wcs)
+            self.assertIsNotNone(tan_wcs)
+
+            # The native WCS matches astropy in both directions.
+            x = np.array([0.0, 10.5, 1000.0, 2047.0, -50.0])
+            y = np.array([0.0, 3000.2, 17.0, 4095.0, 20.0])
+            ra, dec = tan_wcs.pixels_to_sky(x, y)
+            expected = wcs.pixel_to_world(x, y)
+            self.assertTrue(np.allclose(ra, expected.ra.degree, rtol=0.0, atol=1e-9))
+            self.assertTrue(np.allclose(dec, expected.dec.degree, rtol=0.0, atol=1e-9))
+
+            x2, y2 = tan_wcs.sky_to_pixels(ra, dec)
+            self.assertTrue(np.allclose(x2, x, rtol=0.0, atol=1e-6))
+            self.assertTrue(np.allclose(y2, y, rtol=0.0, atol=1e-6))
+
+        # Unsupported projections fall back to None.
+        tpv = WCS(naxis=2)
+        tpv.wcs.ctype = ["RA---TPV", "DEC--TPV"]
+        self.assertIsNone(make_native_tan_wcs(tpv))
+        self.assertIsNone(make_native_tan_wcs(None))
+
 
 class test_construct_wcs_tangent_projection(unittest.TestCase):
     def test_requires_parameters(self):
@@ -229,6 +229,31 @@ class test_work_unit(unittest.TestCase):
             self.assertDictEqual(work2.config["mask_bits_dict"], {"A": 1, "B": 2})
             self.assertIsNone(work2.config["repeated_flag_keys"])
 
+    def test_save_and_load_fits_parallel_compressed(self):
+        with tempfile.TemporaryDirectory() as dir_name:
+            file_path = os.path.join(dir_name, "test_workunit.fits")
+
+            # Write the WorkUnit with multiple encoding threads and compressed layers.
+            work = WorkUnit(self.im_stack, self.config, None, self.diff_wcs)
+            work.to_fits(file_path, num_threads=2, compress=True)
+            self.assertTrue(Path(file_path).is_file())
+
+            # Invalid thread counts are rejected.
+            self.assertRaises(ValueError, work.to_fits, file_path, True, 0)
+
+            # The compression is lossless and the extensions are written in order.
+            work2 = WorkUnit.from_fits(file_path)
+            self.assertEqual(work2.im_stack.img_count(), self.num_images)
+            for i in range(self.num_images):
+                li = work2.im_stack.get_single_image(i)
+                li_org = self.im_stack.get_single_image(i)
+                self.assertEqual(li.get_obstime(), li_org.get_obstime())
+                self.assertTrue(np.array_equal(li.get_science().image, li_org.get_science().image))
+                self.assertTrue(np.array_equal(li.get_variance().image, li_org.get_variance().image))
+                self.assertTrue(np.array_equal(li.get_mask().image, li_org.get_mask().image))
+                self.assertTrue(wcs_fits_equal(work2.get_wcs(i), self.diff_wcs[i]))
+            self.assertEqual(work2.config["im_filepath"], "Here")
+
     def test_save_and_load_fits_global_wcs(self):
         """This check only confirms that we can read and write the global WCS. The other
         values are tested in test_save_and_load_fits()."""